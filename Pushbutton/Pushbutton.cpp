@@ -1,4 +1,16 @@
 #include "Pushbutton.h"
+#include <avr/interrupt.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+// debounce time: the button must hold a new state this long to be accepted
+#define DEBOUNCE_MILLIS 15
+
+Pushbutton *Pushbutton::interruptButtons[PUSHBUTTON_MAX_INTERRUPT_BUTTONS];
+
+// defined by PUSHBUTTON_PCINT_HANDLER() in the sketch, if at all
+void pushbuttonPinChangeHandler() __attribute__((weak));
 
 // constructor; takes arguments specifying whether to enable internal pull-up
 // and the default state of the pin that the button is connected to
@@ -12,6 +24,10 @@ Pushbutton::Pushbutton(unsigned char pin, unsigned char pullUp, unsigned char de
   gsdpPrevTimeMillis = 0;
   gsdrPrevTimeMillis = 0;
   initialized = false;
+  _pinRegister = 0;
+  _edgePending = false;
+  _eventHead = 0;
+  _eventTail = 0;
 }
 
 // wait for button to be pressed
@@ -47,6 +63,75 @@ void Pushbutton::waitForButton()
   waitForRelease();
 }
 
+// wait for button to be pressed, sleeping while waiting
+void Pushbutton::waitForPressSleep(unsigned char sleepMode)
+{
+  init(); // initialize if necessary
+
+  do
+  {
+    sleepUntilLevel(true, sleepMode); // wait for button to be pressed
+    delay(10);                        // debounce the button press
+  }
+  while (!_isPressed());               // if button isn't still pressed, loop
+}
+
+// wait for button to be released, sleeping while waiting
+void Pushbutton::waitForReleaseSleep(unsigned char sleepMode)
+{
+  init(); // initialize if necessary
+
+  do
+  {
+    sleepUntilLevel(false, sleepMode); // wait for button to be released
+    delay(10);                         // debounce the button release
+  }
+  while (_isPressed());                 // if button isn't still released, loop
+}
+
+// wait for button to be pressed, then released, sleeping while waiting
+void Pushbutton::waitForButtonSleep(unsigned char sleepMode)
+{
+  waitForPressSleep(sleepMode);
+  waitForReleaseSleep(sleepMode);
+}
+
+// Puts the MCU to sleep until the button reads the given level.  The
+// pin-change interrupt is enabled for the duration of the wait (if it was not
+// already) so that it can wake the MCU from power-down mode.
+void Pushbutton::sleepUntilLevel(unsigned char level, unsigned char sleepMode)
+{
+#ifdef __AVR__
+  boolean wasEnabled = (_pinRegister != 0);
+
+  if (!enableInterrupt())
+    sleepMode = PUSHBUTTON_SLEEP_IDLE; // only a timer interrupt can wake us
+
+  set_sleep_mode(sleepMode == PUSHBUTTON_SLEEP_POWER_DOWN ? SLEEP_MODE_PWR_DOWN : SLEEP_MODE_IDLE);
+
+  while (1)
+  {
+    // check the pin with interrupts disabled so that an edge between the
+    // check and the sleep instruction cannot be missed (the instruction after
+    // sei() always executes before any pending interrupt is serviced)
+    cli();
+    if (_isPressed() == level)
+      break;
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+
+  if (!wasEnabled)
+    disableInterrupt();
+#else
+  (void)sleepMode;
+  while (_isPressed() != level);
+#endif
+}
+
 // indicates whether button is pressed
 boolean Pushbutton::isPressed()
 {
@@ -112,7 +197,7 @@ boolean Pushbutton::getSingleDebouncedPress()
 // should be called repeatedly in a loop.
 boolean Pushbutton::getSingleDebouncedRelease()
 {
-  unsigned int timeMillis = millis();
+  unsigned long timeMillis = millis();
 
   init(); // initialize if necessary
 
@@ -155,6 +240,151 @@ boolean Pushbutton::getSingleDebouncedRelease()
   return false;
 }
 
+// Enables interrupt-driven event detection.  The pin-change interrupt
+// timestamps every edge on the button pin; an edge that arrives at least 15 ms
+// after the previous one confirms that the level before it was stable, and the
+// final level is confirmed by getEvent() once the pin has been quiet for 15 ms.
+// Each confirmed change of the debounced state is queued as a press or release
+// event, so events are not lost even if getEvent() is called infrequently.
+boolean Pushbutton::enableInterrupt()
+{
+#ifdef digitalPinToPCICR
+  init(); // initialize if necessary
+
+  if (_pinRegister != 0)
+    return true; // already enabled
+
+  if (!pushbuttonPinChangeHandler)
+    return false; // the sketch has no PCINT interrupt service routines
+
+  volatile unsigned char *pcicr = digitalPinToPCICR(_pin);
+  if (pcicr == 0)
+    return false; // no pin-change interrupt on this pin
+
+  unsigned char i;
+  for (i = 0; i < PUSHBUTTON_MAX_INTERRUPT_BUTTONS; i++)
+  {
+    if (interruptButtons[i] == 0)
+      break;
+  }
+  if (i == PUSHBUTTON_MAX_INTERRUPT_BUTTONS)
+    return false; // no free slots
+
+  _pinRegister = portInputRegister(digitalPinToPort(_pin));
+  _pinMask = digitalPinToBitMask(_pin);
+
+  unsigned char oldSREG = SREG;
+  cli();
+  _lastLevel = _debouncedLevel = _isPressedFast();
+  _lastEdgeMillis = millis();
+  _edgePending = false;
+  _eventHead = _eventTail = 0;
+  interruptButtons[i] = this;
+  *digitalPinToPCMSK(_pin) |= (1 << digitalPinToPCMSKbit(_pin));
+  *pcicr |= (1 << digitalPinToPCICRbit(_pin));
+  SREG = oldSREG;
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Disables interrupt-driven event detection and discards any queued events.
+void Pushbutton::disableInterrupt()
+{
+#ifdef digitalPinToPCICR
+  if (_pinRegister == 0)
+    return;
+
+  unsigned char oldSREG = SREG;
+  cli();
+  *digitalPinToPCMSK(_pin) &= ~(1 << digitalPinToPCMSKbit(_pin));
+  for (unsigned char i = 0; i < PUSHBUTTON_MAX_INTERRUPT_BUTTONS; i++)
+  {
+    if (interruptButtons[i] == this)
+      interruptButtons[i] = 0;
+  }
+  _pinRegister = 0;
+  _edgePending = false;
+  _eventHead = _eventTail = 0;
+  SREG = oldSREG;
+#endif
+}
+
+// Returns the oldest queued debounced event, or PUSHBUTTON_EVENT_NONE.
+unsigned char Pushbutton::getEvent()
+{
+  if (_edgePending)
+  {
+    unsigned char oldSREG = SREG;
+    cli();
+    // the last edge is confirmed once the pin has been quiet long enough
+    if (_edgePending && (millis() - _lastEdgeMillis >= DEBOUNCE_MILLIS))
+    {
+      confirmLevel(_lastLevel);
+      _edgePending = false;
+    }
+    SREG = oldSREG;
+  }
+
+  if (_eventHead == _eventTail)
+    return PUSHBUTTON_EVENT_NONE;
+
+  unsigned char event = _eventQueue[_eventTail];
+  _eventTail = (_eventTail + 1) & (PUSHBUTTON_EVENT_QUEUE_SIZE - 1);
+  return event;
+}
+
+// Dispatches a pin-change interrupt to every button using interrupts (the
+// interrupt is shared by all pins on a port, so each button checks whether
+// its own pin changed).
+void Pushbutton::handlePinChangeInterrupt()
+{
+  for (unsigned char i = 0; i < PUSHBUTTON_MAX_INTERRUPT_BUTTONS; i++)
+  {
+    if (interruptButtons[i] != 0)
+      interruptButtons[i]->pinChanged();
+  }
+}
+
+// Timestamps an edge on the button pin (called with interrupts disabled).
+void Pushbutton::pinChanged()
+{
+  unsigned char level = _isPressedFast();
+
+  if (level == _lastLevel)
+    return; // a different pin on this port changed
+
+  unsigned long timeMillis = millis();
+
+  // if the previous level was held long enough, it was a real state
+  if (timeMillis - _lastEdgeMillis >= DEBOUNCE_MILLIS)
+    confirmLevel(_lastLevel);
+
+  _lastLevel = level;
+  _lastEdgeMillis = timeMillis;
+  _edgePending = true;
+}
+
+// Queues an event if the given stable level differs from the debounced state
+// (called with interrupts disabled).  If the queue is full, the event is
+// dropped.
+void Pushbutton::confirmLevel(unsigned char level)
+{
+  if (level == _debouncedLevel)
+    return;
+
+  _debouncedLevel = level;
+
+  unsigned char next = (_eventHead + 1) & (PUSHBUTTON_EVENT_QUEUE_SIZE - 1);
+  if (next != _eventTail)
+  {
+    _eventQueue[_eventHead] = level ? PUSHBUTTON_EVENT_PRESS : PUSHBUTTON_EVENT_RELEASE;
+    _eventHead = next;
+  }
+}
+
 // initializes I/O pin for use as button inputs
 void Pushbutton::init2()
 {
@@ -170,4 +400,136 @@ void Pushbutton::init2()
 inline boolean Pushbutton::_isPressed()
 {
   return (digitalRead(_pin) == LOW) ^ (_defaultState == DEFAULT_STATE_LOW);
-}
\ No newline at end of file
+}
+
+
+// PushbuttonGroup
+
+// constructor; takes an array of pins on the same port and the settings to
+// use for all of them
+PushbuttonGroup::PushbuttonGroup(const unsigned char *pins, unsigned char numButtons,
+  unsigned char pullUp, unsigned char defaultState, unsigned char tickMillis)
+{
+  if (numButtons > 8)
+    numButtons = 8;
+  for (unsigned char i = 0; i < numButtons; i++)
+    _pins[i] = pins[i];
+  _numButtons = numButtons;
+  _pullUp = pullUp;
+  _defaultState = defaultState;
+  _tickMillis = tickMillis;
+  _lastTickMillis = 0;
+  initialized = false;
+  _state = _count0 = _count1 = 0;
+  _pressed = _released = _changed = 0;
+}
+
+// initializes the pins and works out which port bit belongs to each button
+void PushbuttonGroup::init2()
+{
+  unsigned char port = digitalPinToPort(_pins[0]);
+  _pinRegister = portInputRegister(port);
+  _portMask = 0;
+
+  for (unsigned char i = 0; i < _numButtons; i++)
+  {
+    if (digitalPinToPort(_pins[i]) != port)
+    {
+      _masks[i] = 0; // not on the same port, so ignore it
+      continue;
+    }
+
+    if (_pullUp == PULL_UP_ENABLED)
+      pinMode(_pins[i], INPUT_PULLUP);
+    else
+      pinMode(_pins[i], INPUT); // high impedance
+
+    _masks[i] = digitalPinToBitMask(_pins[i]);
+    _portMask |= _masks[i];
+  }
+
+  delayMicroseconds(5); // give pull-ups time to stabilize
+}
+
+// samples and debounces the buttons if a tick period has elapsed
+boolean PushbuttonGroup::update()
+{
+  unsigned long timeMillis = millis();
+
+  if (initialized && (timeMillis - _lastTickMillis < _tickMillis))
+    return false;
+
+  _lastTickMillis = timeMillis;
+  return tick();
+}
+
+// Reads the port once and advances every button's debounce counter.  Each
+// button has a 2-bit counter (one bit in _count0 and one in _count1) that
+// counts consecutive samples disagreeing with its debounced state and resets
+// whenever a sample agrees; when the counter wraps from 3 back to 0, the
+// debounced state toggles.
+boolean PushbuttonGroup::tick()
+{
+  init(); // initialize if necessary
+
+  unsigned char sample = *_pinRegister;
+  if (_defaultState == DEFAULT_STATE_HIGH)
+    sample = ~sample; // pressed buttons read low
+  sample &= _portMask;
+
+  unsigned char delta = sample ^ _state;
+  _count1 = (_count1 ^ _count0) & delta;
+  _count0 = ~_count0 & delta;
+  unsigned char toggle = delta & ~(_count0 | _count1);
+
+  if (toggle == 0)
+    return false;
+
+  _state ^= toggle;
+  _changed |= toggle;
+  _pressed |= toggle & _state;
+  _released |= toggle & ~_state;
+  return true;
+}
+
+// converts a mask in port bit order to button index order
+unsigned char PushbuttonGroup::toButtonMask(unsigned char portBits)
+{
+  unsigned char buttons = 0;
+
+  if (portBits == 0)
+    return 0;
+
+  for (unsigned char i = 0; i < _numButtons; i++)
+  {
+    if (portBits & _masks[i])
+      buttons |= (1 << i);
+  }
+  return buttons;
+}
+
+unsigned char PushbuttonGroup::getState()
+{
+  return toButtonMask(_state);
+}
+
+unsigned char PushbuttonGroup::getPressed()
+{
+  unsigned char buttons = toButtonMask(_pressed);
+  _pressed = 0;
+  return buttons;
+}
+
+unsigned char PushbuttonGroup::getReleased()
+{
+  unsigned char buttons = toButtonMask(_released);
+  _released = 0;
+  return buttons;
+}
+
+unsigned char PushbuttonGroup::getChanged()
+{
+  unsigned char buttons = toButtonMask(_changed);
+  _changed = 0;
+  return buttons;
+}
@@ -20,6 +20,21 @@
 #define DEFAULT_STATE_LOW   0
 #define DEFAULT_STATE_HIGH  1
 
+#define PUSHBUTTON_SLEEP_IDLE        0
+#define PUSHBUTTON_SLEEP_POWER_DOWN  1
+
+#define PUSHBUTTON_EVENT_NONE     0
+#define PUSHBUTTON_EVENT_PRESS    1
+#define PUSHBUTTON_EVENT_RELEASE  2
+
+// number of buttons that can use pin-change interrupts at the same time
+#ifndef PUSHBUTTON_MAX_INTERRUPT_BUTTONS
+#define PUSHBUTTON_MAX_INTERRUPT_BUTTONS  4
+#endif
+
+// number of debounced events each button can queue (must be a power of 2)
+#define PUSHBUTTON_EVENT_QUEUE_SIZE  4
+
 class Pushbutton
 {
   public:
@@ -33,6 +48,21 @@ class Pushbutton
     void waitForRelease();
     void waitForButton();
 
+    // Same as above, but the MCU sleeps while waiting instead of polling the
+    // pin continuously.  With PUSHBUTTON_SLEEP_IDLE, only the CPU stops: all
+    // timers (including millis() and the ZumoBuzzer timer interrupts) keep
+    // running, and the MCU wakes briefly on each of their interrupts.  With
+    // PUSHBUTTON_SLEEP_POWER_DOWN, the clocks stop entirely until the button's
+    // pin-change interrupt wakes the MCU, so millis() does not advance, any
+    // note being played by ZumoBuzzer is frozen, and Serial and USB
+    // communication stop.  If the pin has no pin-change interrupt, or the
+    // sketch has not defined the interrupt service routines with
+    // PUSHBUTTON_PCINT_ISR() (see below), idle mode is used instead; on
+    // non-AVR boards, these just poll the pin.
+    void waitForPressSleep(unsigned char sleepMode = PUSHBUTTON_SLEEP_IDLE);
+    void waitForReleaseSleep(unsigned char sleepMode = PUSHBUTTON_SLEEP_IDLE);
+    void waitForButtonSleep(unsigned char sleepMode = PUSHBUTTON_SLEEP_IDLE);
+
     // indicates whether button is currently pressed
     boolean isPressed();
 
@@ -41,6 +71,26 @@ class Pushbutton
     boolean getSingleDebouncedPress();
     boolean getSingleDebouncedRelease();
 
+    // Enables interrupt-driven event detection using the pin-change interrupt
+    // (PCINT) for the button's pin, which must be capable of generating one
+    // (on the Arduino Uno, pin 12 is PCINT4; on the Leonardo, pin 12 has no
+    // pin-change interrupt).  Returns true on success or false if the pin
+    // cannot be used, too many buttons already use interrupts, or the sketch
+    // has not defined the PCINT interrupt service routines with
+    // PUSHBUTTON_PCINT_ISR() or PUSHBUTTON_PCINT_HANDLER() (see below).
+    boolean enableInterrupt();
+    void disableInterrupt();
+
+    // Returns the oldest queued debounced event (PUSHBUTTON_EVENT_PRESS or
+    // PUSHBUTTON_EVENT_RELEASE), or PUSHBUTTON_EVENT_NONE if there are none.
+    // Only available after enableInterrupt() succeeds; when nothing has
+    // happened, this costs only a couple of flag checks.
+    unsigned char getEvent();
+
+    // called from the pin-change interrupt service routines (see
+    // PUSHBUTTON_PCINT_ISR() below)
+    static void handlePinChangeInterrupt();
+
   private:
 
     unsigned char _pin;
@@ -48,10 +98,23 @@ class Pushbutton
     unsigned char _defaultState;
     unsigned char gsdpState;
     unsigned char gsdrState;
-    unsigned int gsdpPrevTimeMillis;
-    unsigned int gsdrPrevTimeMillis;
+    unsigned long gsdpPrevTimeMillis;
+    unsigned long gsdrPrevTimeMillis;
     boolean initialized;
 
+    // interrupt-driven event detection state (written by the ISR)
+    volatile unsigned char *_pinRegister;
+    unsigned char _pinMask;
+    volatile boolean _edgePending;
+    volatile unsigned char _lastLevel;
+    volatile unsigned char _debouncedLevel;
+    volatile unsigned long _lastEdgeMillis;
+    volatile unsigned char _eventQueue[PUSHBUTTON_EVENT_QUEUE_SIZE];
+    volatile unsigned char _eventHead;
+    volatile unsigned char _eventTail;
+
+    static Pushbutton *interruptButtons[PUSHBUTTON_MAX_INTERRUPT_BUTTONS];
+
     inline void init()
     {
       if (!initialized)
@@ -65,6 +128,131 @@ class Pushbutton
     void init2();
 
     boolean _isPressed();
+
+    // reads the button state directly from the port input register
+    inline unsigned char _isPressedFast()
+    {
+      return ((*_pinRegister & _pinMask) == 0) ^ (_defaultState == DEFAULT_STATE_LOW);
+    }
+
+    void sleepUntilLevel(unsigned char level, unsigned char sleepMode);
+    void pinChanged();
+    void confirmLevel(unsigned char level);
+};
+
+// Debounces a group of up to 8 buttons connected to the same I/O port.  Each
+// tick reads the port once and advances a 2-bit "vertical counter" for every
+// button in parallel using bitwise operations, so the cost of debouncing does
+// not grow with the number of buttons.  A button's debounced state changes
+// after it reads the new state on four consecutive ticks (16 ms with the
+// default tick period of 4 ms).  Results are reported as bitmasks in which
+// bit i corresponds to pins[i].
+class PushbuttonGroup
+{
+  public:
+
+    // constructor; takes an array of pins (which must all be on the same
+    // port; pins on other ports are ignored) and the same pull-up and
+    // default state settings as Pushbutton, which apply to all buttons
+    PushbuttonGroup(const unsigned char *pins, unsigned char numButtons,
+      unsigned char pullUp = PULL_UP_ENABLED,
+      unsigned char defaultState = DEFAULT_STATE_HIGH,
+      unsigned char tickMillis = 4);
+
+    // samples and debounces the buttons if at least one tick period has
+    // elapsed since the last sample; returns true if any debounced state
+    // changed
+    boolean update();
+
+    // samples and debounces the buttons unconditionally; use this instead of
+    // update() if you call it at a fixed rate yourself
+    boolean tick();
+
+    // bitmask of buttons that are currently pressed (debounced)
+    unsigned char getState();
+
+    // bitmasks of buttons that were pressed, released, or either, since the
+    // previous call to the same function (each call clears its mask)
+    unsigned char getPressed();
+    unsigned char getReleased();
+    unsigned char getChanged();
+
+  private:
+
+    unsigned char _pins[8];
+    unsigned char _numButtons;
+    unsigned char _pullUp;
+    unsigned char _defaultState;
+    unsigned char _tickMillis;
+    unsigned long _lastTickMillis;
+    boolean initialized;
+
+    // port bit for each button, and all of them combined
+    unsigned char _masks[8];
+    unsigned char _portMask;
+    volatile unsigned char *_pinRegister;
+
+    // debouncer state, in port bit order
+    unsigned char _state;
+    unsigned char _count0;
+    unsigned char _count1;
+    unsigned char _pressed;
+    unsigned char _released;
+    unsigned char _changed;
+
+    inline void init()
+    {
+      if (!initialized)
+      {
+        initialized = true;
+        init2();
+      }
+    }
+
+    // initializes I/O pins for use as button inputs
+    void init2();
+
+    // converts a mask in port bit order to button index order
+    unsigned char toButtonMask(unsigned char portBits);
 };
 
+// The library does not define the pin-change interrupt service routines
+// itself, so that it does not take the PCINT vectors away from other
+// libraries that need them (such as SoftwareSerial).  A sketch that uses
+// enableInterrupt() or PUSHBUTTON_SLEEP_POWER_DOWN expands
+//
+//   PUSHBUTTON_PCINT_ISR()
+//
+// once, outside of any function, to define all of them.  A sketch that
+// defines its own PCINT interrupt service routines instead expands
+// PUSHBUTTON_PCINT_HANDLER() and calls Pushbutton::handlePinChangeInterrupt()
+// from each of them.  Until one of these is expanded, enableInterrupt()
+// returns false and the sleeping waits use idle mode.
+#define PUSHBUTTON_PCINT_HANDLER() \
+  void pushbuttonPinChangeHandler() { Pushbutton::handlePinChangeInterrupt(); }
+
+#if defined(digitalPinToPCICR) && defined(PCINT0_vect)
+#define PUSHBUTTON_PCINT0_ISR ISR(PCINT0_vect) { Pushbutton::handlePinChangeInterrupt(); }
+#else
+#define PUSHBUTTON_PCINT0_ISR
+#endif
+
+#if defined(digitalPinToPCICR) && defined(PCINT1_vect)
+#define PUSHBUTTON_PCINT1_ISR ISR(PCINT1_vect) { Pushbutton::handlePinChangeInterrupt(); }
+#else
+#define PUSHBUTTON_PCINT1_ISR
+#endif
+
+#if defined(digitalPinToPCICR) && defined(PCINT2_vect)
+#define PUSHBUTTON_PCINT2_ISR ISR(PCINT2_vect) { Pushbutton::handlePinChangeInterrupt(); }
+#else
+#define PUSHBUTTON_PCINT2_ISR
+#endif
+
+#define PUSHBUTTON_PCINT_ISR() \
+  PUSHBUTTON_PCINT_HANDLER() \
+  PUSHBUTTON_PCINT0_ISR \
+  PUSHBUTTON_PCINT1_ISR \
+  PUSHBUTTON_PCINT2_ISR
+
 #endif
\ No newline at end of file
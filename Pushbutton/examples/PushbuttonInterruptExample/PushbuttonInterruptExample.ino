@@ -0,0 +1,59 @@
+#include <Pushbutton.h>
+
+/*
+ * This example uses the Pushbutton library's interrupt-driven mode to detect
+ * presses and releases of the Zumo user button without polling the pin. A
+ * pin-change interrupt timestamps every edge, and getEvent() returns the
+ * debounced press and release events in the order they happened. The yellow
+ * user LED turns on while the button is pressed, and the loop keeps running
+ * at full speed the rest of the time.
+ *
+ * Pin-change interrupts are available on pin 12 of the Arduino Uno and other
+ * ATmega328P/168 boards, but not on the Leonardo; if enableInterrupt() fails,
+ * the LED blinks rapidly.
+ *
+ * The Pushbutton library leaves the pin-change interrupt service routines to
+ * the sketch, so that it does not conflict with other libraries that use
+ * them; PUSHBUTTON_PCINT_ISR() below defines them.
+ */
+
+#define LED_PIN 13
+
+Pushbutton button(ZUMO_BUTTON);
+
+PUSHBUTTON_PCINT_ISR()
+
+void setup()
+{
+  pinMode(LED_PIN, OUTPUT);
+
+  if (!button.enableInterrupt())
+  {
+    // this pin has no pin-change interrupt
+    while (1)
+    {
+      digitalWrite(LED_PIN, HIGH);
+      delay(100);
+      digitalWrite(LED_PIN, LOW);
+      delay(100);
+    }
+  }
+}
+
+void loop()
+{
+  switch (button.getEvent())
+  {
+    case PUSHBUTTON_EVENT_PRESS:
+      digitalWrite(LED_PIN, HIGH);
+      break;
+
+    case PUSHBUTTON_EVENT_RELEASE:
+      digitalWrite(LED_PIN, LOW);
+      break;
+
+    default:
+      // nothing happened; do other work here
+      break;
+  }
+}
@@ -5,6 +5,7 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include "ZumoBuzzer.h"
+#include "ZumoBuzzerParser.h"
 
 #ifdef __AVR_ATmega32U4__
 
@@ -32,56 +33,367 @@ static const unsigned int cs2_divider[] = {0, 1, 8, 32, 64, 128, 256, 1024};
 
 #endif
 
+// Note timer settings
+//
+// playNote() looks up the timer settings for each note in noteTable instead
+// of computing them with long divisions.  The table entries are constant
+// expressions of F_CPU, so the compiler evaluates them all at build time for
+// whichever timer the target uses.
+//
+// note = key + octave * 12, where 0 <= key < 12
+// example: A4 = A + 4 * 12, where A = 9 (so A4 = 57)
+// Notes 16 (E1, 41.2 Hz) to 111 (D#9, 9.96 kHz) are allowed; the table is
+// indexed by note - 16.  The frequency of the 12 lowest notes is given in
+// tenths of a Hz, and it doubles every 12 notes after that.
+
+#define NOTE_BASE_FREQ10(key) \
+  ((key) ==  0 ? 412UL :  /* E1 = 41.2 Hz */ \
+   (key) ==  1 ? 437UL :  /* F1 = 43.7 Hz */ \
+   (key) ==  2 ? 463UL :  /* F#1 = 46.3 Hz */ \
+   (key) ==  3 ? 490UL :  /* G1 = 49.0 Hz */ \
+   (key) ==  4 ? 519UL :  /* G#1 = 51.9 Hz */ \
+   (key) ==  5 ? 550UL :  /* A1 = 55.0 Hz */ \
+   (key) ==  6 ? 583UL :  /* A#1 = 58.3 Hz */ \
+   (key) ==  7 ? 617UL :  /* B1 = 61.7 Hz */ \
+   (key) ==  8 ? 654UL :  /* C2 = 65.4 Hz */ \
+   (key) ==  9 ? 693UL :  /* C#2 = 69.3 Hz */ \
+   (key) == 10 ? 734UL :  /* D2 = 73.4 Hz */ \
+                 778UL)   /* D#2 = 77.8 Hz */
+
+// frequency of table entry i, in tenths of a Hz
+#define NOTE_FREQ10(i)  (NOTE_BASE_FREQ10((i) % 12) << ((i) / 12))
+
+#ifdef __AVR_ATmega32U4__
+
+// timer 4 TOP for a frequency with a clock divider of 2^e (phase and
+// frequency correct PWM counts up and down, so the period is 2 * TOP)
+#define NOTE_TOP_E(f10, e)  ((((F_CPU/2 >> (e)) * 10) + (f10)/2) / (f10))
+
+// smallest divider exponent that makes TOP fit in 10 bits
+#define NOTE_EXPONENT(f10) \
+  (NOTE_TOP_E(f10, 0) <= 1023 ? 0 : NOTE_TOP_E(f10, 1) <= 1023 ? 1 : \
+   NOTE_TOP_E(f10, 2) <= 1023 ? 2 : NOTE_TOP_E(f10, 3) <= 1023 ? 3 : \
+   NOTE_TOP_E(f10, 4) <= 1023 ? 4 : NOTE_TOP_E(f10, 5) <= 1023 ? 5 : \
+   NOTE_TOP_E(f10, 6) <= 1023 ? 6 : NOTE_TOP_E(f10, 7) <= 1023 ? 7 : \
+   NOTE_TOP_E(f10, 8) <= 1023 ? 8 : NOTE_TOP_E(f10, 9) <= 1023 ? 9 : \
+   NOTE_TOP_E(f10, 10) <= 1023 ? 10 : NOTE_TOP_E(f10, 11) <= 1023 ? 11 : \
+   NOTE_TOP_E(f10, 12) <= 1023 ? 12 : NOTE_TOP_E(f10, 13) <= 1023 ? 13 : 14)
+
+// timer 4 clock prescaler: divider = 2^n if CS4 = n+1
+#define NOTE_PRESCALER(f10)  (NOTE_EXPONENT(f10) + 1)
+#define NOTE_TOP(f10)        NOTE_TOP_E(f10, NOTE_EXPONENT(f10))
+
+#else
+
+// timer 2 TOP for a frequency with the given clock divider (phase correct
+// PWM counts up and down, so the period is 2 * TOP)
+#define NOTE_TOP_DIV(f10, div)  ((((F_CPU/2/(div)) * 10) + (f10)/2) / (f10))
+
+// timer 2 clock prescaler: the smallest divider of at least 8 (minimum
+// necessary for 10 kHz) that makes TOP fit in 8 bits
+#define NOTE_PRESCALER(f10) \
+  (NOTE_TOP_DIV(f10, 8) <= 255 ? 2 : NOTE_TOP_DIV(f10, 32) <= 255 ? 3 : \
+   NOTE_TOP_DIV(f10, 64) <= 255 ? 4 : NOTE_TOP_DIV(f10, 128) <= 255 ? 5 : \
+   NOTE_TOP_DIV(f10, 256) <= 255 ? 6 : 7)
+
+#define NOTE_DIVIDER(cs) \
+  ((cs) == 2 ? 8 : (cs) == 3 ? 32 : (cs) == 4 ? 64 : \
+   (cs) == 5 ? 128 : (cs) == 6 ? 256 : 1024)
+
+#define NOTE_TOP(f10)  NOTE_TOP_DIV(f10, NOTE_DIVIDER(NOTE_PRESCALER(f10)))
+
+#endif
+
+// Timer overflows per ms (the note frequency in kHz) as a Q4.12 fixed-point
+// number, so that the timeout for a duration in ms is (dur * rate) >> 12,
+// rounded.
+#define NOTE_RATE(f10)  (((f10) * 4096UL + 5000) / 10000)
+
+#define NOTE_ENTRY(i) \
+  { NOTE_PRESCALER(NOTE_FREQ10(i)), NOTE_TOP(NOTE_FREQ10(i)), \
+    NOTE_RATE(NOTE_FREQ10(i)) }
+
+#define NOTE_OCTAVE(o) \
+  NOTE_ENTRY((o)*12 + 0), NOTE_ENTRY((o)*12 + 1), NOTE_ENTRY((o)*12 + 2), \
+  NOTE_ENTRY((o)*12 + 3), NOTE_ENTRY((o)*12 + 4), NOTE_ENTRY((o)*12 + 5), \
+  NOTE_ENTRY((o)*12 + 6), NOTE_ENTRY((o)*12 + 7), NOTE_ENTRY((o)*12 + 8), \
+  NOTE_ENTRY((o)*12 + 9), NOTE_ENTRY((o)*12 + 10), NOTE_ENTRY((o)*12 + 11)
+
+struct NoteTiming
+{
+  unsigned char prescaler;      // timer clock select bits
+  unsigned int top;             // timer TOP (pwm frequency)
+  unsigned int rate;            // timer overflows per ms, Q4.12
+};
+
+static const NoteTiming noteTable[96] PROGMEM =
+{
+  NOTE_OCTAVE(0), NOTE_OCTAVE(1), NOTE_OCTAVE(2), NOTE_OCTAVE(3),
+  NOTE_OCTAVE(4), NOTE_OCTAVE(5), NOTE_OCTAVE(6), NOTE_OCTAVE(7)
+};
+
+// silent notes play at 1 kHz (one overflow per ms) with a 0% duty cycle
+#define SILENT_PRESCALER  NOTE_PRESCALER(10000UL)
+#define SILENT_TOP        NOTE_TOP(10000UL)
+
 unsigned char buzzerInitialized = 0;
 volatile unsigned char buzzerFinished = 1;  // flag: 0 while playing
-const char *buzzerSequence = 0;
 
 // declaring these globals as static means they won't conflict
 // with globals in other .cpp files that share the same name
+// The time limit is counted in timer overflows.  Long notes at high
+// frequencies can need more than 65536 overflows, so the count is split:
+// the interrupt decrements the low 16 bits on every overflow and only
+// touches the high byte when they wrap around.
 static volatile unsigned int buzzerTimeout = 0;    // tracks buzzer time limit
+static volatile unsigned char buzzerTimeoutHigh = 0; // multiples of 65536
 static char play_mode_setting = PLAY_AUTOMATIC;
 
 extern volatile unsigned char buzzerFinished;  // flag: 0 while playing
-extern const char *buzzerSequence;
 
+// parser used by play() and playFromProgramSpace()
+static ZumoBuzzerParser player = {0, 0, 4, 2000, 4, 500, 15, 0, 0};
+
+// compiled sequence being played by playCompiled(), if any
+static const ZumoBuzzerEvent *compiledEvents;
+static volatile unsigned int compiledRemaining = 0;
+static unsigned char compiledProgramSpace;
+
+// The note after the one currently playing, parsed ahead of time so the timer
+// overflow interrupt only has to write it to the timer registers when the
+// current note ends.  lookaheadBusy is set while the parser is running so that
+// it is never re-entered from the interrupt.
+static ZumoBuzzerEvent lookahead;
+static volatile unsigned char lookaheadReady = 0;
+static volatile unsigned char lookaheadBusy = 0;
+
+// A melody waiting in the playQueued() queue.  A preempted melody keeps its
+// parser state and the note that had already been parsed ahead, or the rest
+// of its compiled events, so it can resume exactly where it left off.
+struct BuzzerRequest
+{
+  ZumoBuzzerParser parser;
+  ZumoBuzzerEvent pending;      // the lookahead note, if hasPending is set
+  unsigned char hasPending;
+  unsigned char priority;
+  const ZumoBuzzerEvent *compiledEvents;  // compiled events still to play, if
+  unsigned int compiledRemaining;         //   compiledRemaining is not 0
+  unsigned char compiledProgramSpace;
+};
+
+// Requests are kept in the order they should be played when priorities are
+// equal.  The melody in player has priority playerPriority, which is at least
+// as high as that of every queued request.
+static BuzzerRequest requestQueue[ZUMO_BUZZER_QUEUE_SIZE];
+static volatile unsigned char requestCount = 0;
+static unsigned char playerPriority = 0;
+
+#ifdef ZUMO_BUZZER_INSTRUMENTATION
+
+#include <Arduino.h>
+
+// Timer 0 is set up by the Arduino core to count at F_CPU/64 for millis().
+#define CYCLES_PER_TIMER0_TICK  64
+
+static unsigned long statsStartMillis = 0;
+static volatile unsigned long overflowCount = 0;
+static unsigned char isrMinTicks = 0xFF;
+static unsigned char isrMaxTicks = 0;
+static unsigned long isrTickSum = 0;
+static unsigned long parseCount = 0;
+static unsigned long parseMinMicros = 0xFFFFFFFF;
+static unsigned long parseMaxMicros = 0;
+static unsigned long parseMicrosSum = 0;
+
+// called once at the end of every timer overflow interrupt
+static inline void recordIsrTime(unsigned char ticks)
+{
+  overflowCount++;
+  isrTickSum += ticks;
+  if (ticks < isrMinTicks)
+    isrMinTicks = ticks;
+  if (ticks > isrMaxTicks)
+    isrMaxTicks = ticks;
+}
+
+// called after each note is parsed; never re-entered since parsing isn't
+static inline void recordParseTime(unsigned long us)
+{
+  parseCount++;
+  parseMicrosSum += us;
+  if (us < parseMinMicros)
+    parseMinMicros = us;
+  if (us > parseMaxMicros)
+    parseMaxMicros = us;
+}
 
-static unsigned char use_program_space; // boolean: true if we should
-                    // use program space
+#define ISR_TIMING_START()    unsigned char isrStartTicks = TCNT0
+#define ISR_TIMING_STOP()     recordIsrTime(TCNT0 - isrStartTicks)
+#define PARSE_TIMING_START()  unsigned long parseStartMicros = micros()
+#define PARSE_TIMING_STOP()   recordParseTime(micros() - parseStartMicros)
 
-// music settings and defaults
-static unsigned char octave = 4;        // the current octave
-static unsigned int whole_note_duration = 2000;  // the duration of a whole note
-static unsigned int note_type = 4;              // 4 for quarter, etc
-static unsigned int duration = 500;        // the duration of a note in ms
-static unsigned int volume = 15;        // the note volume
-static unsigned char staccato = 0;       // true if playing staccato
+#else
 
-// staccato handling
-static unsigned char staccato_rest_duration;  // duration of a staccato
-                        //  rest, or zero if it is time
-                        //  to play a note
+#define ISR_TIMING_START()
+#define ISR_TIMING_STOP()
+#define PARSE_TIMING_START()
+#define PARSE_TIMING_STOP()
+
+#endif
 
 static void nextNote();
+static void fillLookahead();
+static void computeFrequency(unsigned int freq, unsigned int dur,
+                             unsigned char volume, ZumoBuzzerEvent *event);
+static void computeNote(unsigned char note, unsigned int dur,
+                        unsigned char volume, ZumoBuzzerEvent *event);
+static unsigned int compileSequence(ZumoBuzzerParser *p,
+                                    ZumoBuzzerEvent *events,
+                                    unsigned int maxEvents);
+
+// Writes the timer registers for an event and starts it playing.  This is all
+// the work needed to start a compiled note, so it is cheap enough to call from
+// the timer overflow interrupt.
+static inline void startEvent(const ZumoBuzzerEvent *event)
+{
+  DISABLE_TIMER_INTERRUPT();      // disable interrupts while writing to registers
+
+#ifdef __AVR_ATmega32U4__
+  TCCR4B = (TCCR4B & 0xF0) | event->prescaler;      // select timer 4 clock prescaler
+  TC4H = event->top >> 8;                           // set timer 4 pwm frequency: top 2 bits...
+  OCR4C = event->top;                               // and bottom 8 bits
+  TC4H = event->width >> 8;                         // set duty cycle (volume): top 2 bits...
+  OCR4D = event->width;                             // and bottom 8 bits
+  buzzerTimeout = event->timeout;                   // set buzzer duration:
+  buzzerTimeoutHigh = event->timeout >> 16;         //   low 16 bits and high byte
+
+  TIFR4 |= 0xFF;  // clear any pending t4 overflow int.
+#else
+  TCCR2B = (TCCR2B & 0xF8) | event->prescaler;      // select timer 2 clock prescaler
+  OCR2A = event->top;                               // set timer 2 pwm frequency
+  OCR2B = event->width;                             // set duty cycle (volume)
+  buzzerTimeout = event->timeout;                   // set buzzer duration:
+  buzzerTimeoutHigh = event->timeout >> 16;         //   low 16 bits and high byte
+
+  TIFR2 |= 0xFF;  // clear any pending t2 overflow int.
+#endif
+
+  ENABLE_TIMER_INTERRUPT();
+}
+
+// Loads the next event of the compiled sequence and starts it playing.
+static inline void nextCompiledEvent()
+{
+  ZumoBuzzerEvent event;
+
+  if (compiledProgramSpace)
+  {
+    event.prescaler = pgm_read_byte(&compiledEvents->prescaler);
+    event.top = pgm_read_word(&compiledEvents->top);
+    event.width = pgm_read_word(&compiledEvents->width);
+    event.timeout = pgm_read_dword(&compiledEvents->timeout);
+  }
+  else
+    event = *compiledEvents;
+
+  compiledEvents++;
+  compiledRemaining--;
+  startEvent(&event);
+}
+
+// Disables the timer overflow interrupt, makes the buzzer silent (1 kHz at a
+// 0% duty cycle), and marks it finished.
+static inline void silenceBuzzer()
+{
+  DISABLE_TIMER_INTERRUPT();
+
+#ifdef __AVR_ATmega32U4__
+  TCCR4B = (TCCR4B & 0xF0) | TIMER4_CLK_8;  // select IO clock
+  unsigned int top = (F_CPU/16) / 1000;     // set TOP for freq = 1 kHz: 
+  TC4H = top >> 8;                          // top 2 bits... (TC4H temporarily stores top 2 bits of 10-bit accesses)
+  OCR4C = top;                              // and bottom 8 bits
+  TC4H = 0;                                 // 0% duty cycle: top 2 bits...
+  OCR4D = 0;                                // and bottom 8 bits
+#else
+  TCCR2B = (TCCR2B & 0xF8) | TIMER2_CLK_32; // select IO clock
+  OCR2A = (F_CPU/64) / 1000;                // set TOP for freq = 1 kHz
+  OCR2B = 0;                                // 0% duty cycle
+#endif
+
+  buzzerFinished = 1;
+}
+
+// Starts the note that was parsed ahead of time by fillLookahead().  Call this
+// only from the timer overflow interrupt or while the buzzer is finished (when
+// the interrupt is disabled).
+static inline void startLookahead()
+{
+  lookaheadReady = 0;
+  buzzerFinished = 0;
+  startEvent(&lookahead);
+}
+
+// Starts whatever fillLookahead() has made ready to play: the rest of a
+// compiled sequence resumed from the queue, or the lookahead note.  Call this
+// only while the buzzer is finished.
+static inline void startReady()
+{
+  if (compiledRemaining)
+  {
+    buzzerFinished = 0;
+    nextCompiledEvent();
+  }
+  else if (lookaheadReady)
+    startLookahead();
+}
+
+// In PLAY_AUTOMATIC mode, parses the note after the one that just started
+// so that it is ready when the current note ends.  This runs at the end of the
+// timer overflow interrupt, after the new note has been started, with global
+// interrupts re-enabled since the parser is slow.  If the current note ends
+// while the parser is still running, the nested interrupt just goes silent
+// (lookaheadBusy keeps it from parsing), and the new note is started here.
+static inline void refillLookahead()
+{
+  if ((!player.sequence && !requestCount) || lookaheadReady || lookaheadBusy)
+    return;
+
+  sei();
+  fillLookahead();
+  cli();
+
+  if (buzzerFinished)
+    startReady();
+}
 
 #ifdef __AVR_ATmega32U4__
 
 // Timer4 overflow interrupt
 ISR (TIMER4_OVF_vect)
 {
+  ISR_TIMING_START();
+
   if (buzzerTimeout-- == 0)
   {
-    DISABLE_TIMER_INTERRUPT();
-    sei();                                    // re-enable global interrupts (nextNote() is very slow)
-    TCCR4B = (TCCR4B & 0xF0) | TIMER4_CLK_8;  // select IO clock
-    unsigned int top = (F_CPU/16) / 1000;     // set TOP for freq = 1 kHz: 
-    TC4H = top >> 8;                          // top 2 bits... (TC4H temporarily stores top 2 bits of 10-bit accesses)
-    OCR4C = top;                              // and bottom 8 bits
-    TC4H = 0;                                 // 0% duty cycle: top 2 bits...
-    OCR4D = 0;                                // and bottom 8 bits
-    buzzerFinished = 1;
-    if (buzzerSequence && (play_mode_setting == PLAY_AUTOMATIC))
-      nextNote();
+    if (buzzerTimeoutHigh)
+      buzzerTimeoutHigh--;                    // 65536 more overflows to go
+    else if (compiledRemaining)
+      nextCompiledEvent();                    // a table load and register writes
+    else
+    {
+      if (lookaheadReady)
+        startLookahead();                     // the next note was parsed earlier; just start it
+      else
+        silenceBuzzer();
+
+      ISR_TIMING_STOP();
+      if (play_mode_setting == PLAY_AUTOMATIC)
+        refillLookahead();                    // timed separately, as parsing
+      return;
+    }
   }
+
+  ISR_TIMING_STOP();
 }
 
 #else
@@ -89,17 +401,29 @@ ISR (TIMER4_OVF_vect)
 // Timer2 overflow interrupt
 ISR (TIMER2_OVF_vect)
 {
+  ISR_TIMING_START();
+
   if (buzzerTimeout-- == 0)
   {
-    DISABLE_TIMER_INTERRUPT();
-    sei();                                    // re-enable global interrupts (nextNote() is very slow)
-    TCCR2B = (TCCR2B & 0xF8) | TIMER2_CLK_32; // select IO clock
-    OCR2A = (F_CPU/64) / 1000;                // set TOP for freq = 1 kHz
-    OCR2B = 0;                                // 0% duty cycle
-    buzzerFinished = 1;
-    if (buzzerSequence && (play_mode_setting == PLAY_AUTOMATIC))
-      nextNote();
+    if (buzzerTimeoutHigh)
+      buzzerTimeoutHigh--;                    // 65536 more overflows to go
+    else if (compiledRemaining)
+      nextCompiledEvent();                    // a table load and register writes
+    else
+    {
+      if (lookaheadReady)
+        startLookahead();                     // the next note was parsed earlier; just start it
+      else
+        silenceBuzzer();
+
+      ISR_TIMING_STOP();
+      if (play_mode_setting == PLAY_AUTOMATIC)
+        refillLookahead();                    // timed separately, as parsing
+      return;
+    }
   }
+
+  ISR_TIMING_STOP();
 }
 
 #endif
@@ -202,18 +526,26 @@ void ZumoBuzzer::init2()
 // Set up timer 1 to play the desired frequency (in Hz or .1 Hz) for the
 //   the desired duration (in ms). Allowed frequencies are 40 Hz to 10 kHz.
 //   volume controls buzzer volume, with 15 being loudest and 0 being quietest.
-// Note: frequency*duration/1000 must be less than 0xFFFF (65535).  This
-//   means that you can't use a max duration of 65535 ms for frequencies
-//   greater than 1 kHz.  For example, the max duration you can use for a
-//   frequency of 10 kHz is 6553 ms.  If you use a duration longer than this,
-//   you will cause an integer overflow that produces unexpected behavior.
+// Any duration up to 65535 ms can be used at any frequency.
 void ZumoBuzzer::playFrequency(unsigned int freq, unsigned int dur, 
                      unsigned char volume)
 {
+  ZumoBuzzerEvent event;
+
   init(); // initializes the buzzer if necessary
   buzzerFinished = 0;
-  
-  unsigned int timeout;
+
+  computeFrequency(freq, dur, volume, &event);
+  startEvent(&event);
+}
+
+// Calculates the timer settings needed to play the desired frequency (in Hz
+//   or .1 Hz) for the desired duration (in ms) at the desired volume, and
+//   stores them in event.  See playFrequency() for the allowed ranges.
+static void computeFrequency(unsigned int freq, unsigned int dur,
+                             unsigned char volume, ZumoBuzzerEvent *event)
+{
+  unsigned long timeout;
   unsigned char multiplier = 1;
   
   if (freq & DIV_BY_10) // if frequency's DIV_BY_10 bit is set
@@ -262,147 +594,78 @@ void ZumoBuzzer::playFrequency(unsigned int freq, unsigned int dur,
   if (freq == 1000)
     timeout = dur;  // duration for silent notes is exact
   else
-    timeout = (unsigned int)((long)dur * freq / 1000);
+    timeout = (unsigned long)dur * freq / 1000;  // at most 655350
   
   if (volume > 15)
     volume = 15;
 
-  DISABLE_TIMER_INTERRUPT();      // disable interrupts while writing to registers 
-  
 #ifdef __AVR_ATmega32U4__
-  TCCR4B = (TCCR4B & 0xF0) | (dividerExponent + 1); // select timer 4 clock prescaler: divider = 2^n if CS4 = n+1
-  TC4H = top >> 8;                                  // set timer 1 pwm frequency: top 2 bits...
-  OCR4C = top;                                      // and bottom 8 bits
-  unsigned int width = top >> (16 - volume);        // set duty cycle (volume):
-  TC4H = width >> 8;                                // top 2 bits...
-  OCR4D = width;                                    // and bottom 8 bits
-  buzzerTimeout = timeout;                          // set buzzer duration
-  
-  TIFR4 |= 0xFF;  // clear any pending t4 overflow int.      
+  event->prescaler = dividerExponent + 1;           // timer 4 clock prescaler: divider = 2^n if CS4 = n+1
 #else
-  TCCR2B = (TCCR2B & 0xF8) | newCS2;  // select timer 2 clock prescaler
-  OCR2A = top;                        // set timer 2 pwm frequency
-  OCR2B = top >> (16 - volume);       // set duty cycle (volume)
-  buzzerTimeout = timeout;            // set buzzer duration
-
-  TIFR2 |= 0xFF;  // clear any pending t2 overflow int.     
+  event->prescaler = newCS2;                        // timer 2 clock prescaler
 #endif
-
-  ENABLE_TIMER_INTERRUPT();  
+  event->top = top;                                 // pwm frequency
+  event->width = top >> (16 - volume);              // duty cycle (volume)
+  event->timeout = timeout;                         // duration
 }
 
 
 
-// Determine the frequency for the specified note, then play that note
+// Look up the timer settings for the specified note, then play that note
 //  for the desired duration (in ms).  This is done without using floats
-//  and without having to loop.  volume controls buzzer volume, with 15 being
+//  or divisions.  volume controls buzzer volume, with 15 being
 //  loudest and 0 being quietest.
-// Note: frequency*duration/1000 must be less than 0xFFFF (65535).  This
-//  means that you can't use a max duration of 65535 ms for frequencies
-//  greater than 1 kHz.  For example, the max duration you can use for a
-//  frequency of 10 kHz is 6553 ms.  If you use a duration longer than this,
-//  you will cause an integer overflow that produces unexpected behavior.
+// Any duration up to 65535 ms can be used at any frequency.
 void ZumoBuzzer::playNote(unsigned char note, unsigned int dur,
                  unsigned char volume)
 {
-  // note = key + octave * 12, where 0 <= key < 12
-  // example: A4 = A + 4 * 12, where A = 9 (so A4 = 57)
-  // A note is converted to a frequency by the formula:
-  //   Freq(n) = Freq(0) * a^n
-  // where
-  //   Freq(0) is chosen as A4, which is 440 Hz
-  // and
-  //   a = 2 ^ (1/12)
-  // n is the number of notes you are away from A4.
-  // One can see that the frequency will double every 12 notes.
-  // This function exploits this property by defining the frequencies of the
-  // 12 lowest notes allowed and then doubling the appropriate frequency
-  // the appropriate number of times to get the frequency for the specified
-  // note.
+  ZumoBuzzerEvent event;
+
+  init(); // initializes the buzzer if necessary
+  buzzerFinished = 0;
 
+  computeNote(note, dur, volume, &event);
+  startEvent(&event);
+}
+
+// Calculates the timer settings needed to play the specified note for the
+//  desired duration (in ms) at the desired volume, and stores them in event.
+//  The settings come from noteTable, so this does not need any divisions.
+static void computeNote(unsigned char note, unsigned int dur,
+                        unsigned char volume, ZumoBuzzerEvent *event)
+{
   // if note = 16, freq = 41.2 Hz (E1 - lower limit as freq must be >40 Hz)
   // if note = 57, freq = 440 Hz (A4 - central value of ET Scale)
   // if note = 111, freq = 9.96 kHz (D#9 - upper limit, freq must be <10 kHz)
   // if note = 255, freq = 1 kHz and buzzer is silent (silent note)
 
-  // The most significant bit of freq is the "divide by 10" bit.  If set,
-  // the units for frequency are .1 Hz, not Hz, and freq must be divided
-  // by 10 to get the true frequency in Hz.  This allows for an extra digit
-  // of resolution for low frequencies without the need for using floats.
-
-  unsigned int freq = 0;
-  unsigned char offset_note = note - 16;
-
   if (note == SILENT_NOTE || volume == 0)
   {
-    freq = 1000;  // silent notes => use 1kHz freq (for cycle counter)
-    playFrequency(freq, dur, 0);
+    event->prescaler = SILENT_PRESCALER;
+    event->top = SILENT_TOP;
+    event->width = 0;
+    event->timeout = dur;  // duration for silent notes is exact
     return;
   }
 
+  unsigned char offset_note = note - 16;
+
   if (note <= 16)
     offset_note = 0;
   else if (offset_note > 95)
     offset_note = 95;
 
-  unsigned char exponent = offset_note / 12;
-
-  // frequency table for the lowest 12 allowed notes
-  //   frequencies are specified in tenths of a Hertz for added resolution
-  switch (offset_note - exponent * 12)  // equivalent to (offset_note % 12)
-  {
-    case 0:        // note E1 = 41.2 Hz
-      freq = 412;
-      break;
-    case 1:        // note F1 = 43.7 Hz
-      freq = 437;
-      break;
-    case 2:        // note F#1 = 46.3 Hz
-      freq = 463;
-      break;
-    case 3:        // note G1 = 49.0 Hz
-      freq = 490;
-      break;
-    case 4:        // note G#1 = 51.9 Hz
-      freq = 519;
-      break;
-    case 5:        // note A1 = 55.0 Hz
-      freq = 550;
-      break;
-    case 6:        // note A#1 = 58.3 Hz
-      freq = 583;
-      break;
-    case 7:        // note B1 = 61.7 Hz
-      freq = 617;
-      break;
-    case 8:        // note C2 = 65.4 Hz
-      freq = 654;
-      break;
-    case 9:        // note C#2 = 69.3 Hz
-      freq = 693;
-      break;
-    case 10:      // note D2 = 73.4 Hz
-      freq = 734;
-      break;
-    case 11:      // note D#2 = 77.8 Hz
-      freq = 778;
-      break;
-  }
-
-  if (exponent < 7)
-  {
-    freq = freq << exponent;  // frequency *= 2 ^ exponent
-    if (exponent > 1)      // if the frequency is greater than 160 Hz
-      freq = (freq + 5) / 10;  //   we don't need the extra resolution
-    else
-      freq += DIV_BY_10;    // else keep the added digit of resolution
-  }
-  else
-    freq = (freq * 64 + 2) / 5;  // == freq * 2^7 / 10 without int overflow
-
   if (volume > 15)
     volume = 15;
-  playFrequency(freq, dur, volume);  // set buzzer this freq/duration
+
+  const NoteTiming *timing = &noteTable[offset_note];
+  unsigned int top = pgm_read_word(&timing->top);
+  unsigned int rate = pgm_read_word(&timing->rate);
+
+  event->prescaler = pgm_read_byte(&timing->prescaler);
+  event->top = top;                                 // pwm frequency
+  event->width = top >> (16 - volume);              // duty cycle (volume)
+  event->timeout = ((unsigned long)dur * rate + 2048) >> 12; // duration
 }
 
 
@@ -410,16 +673,17 @@ void ZumoBuzzer::playNote(unsigned char note, unsigned int dur,
 // Returns 1 if the buzzer is currently playing, otherwise it returns 0
 unsigned char ZumoBuzzer::isPlaying()
 {
-  return !buzzerFinished || buzzerSequence != 0;
+  return !buzzerFinished || player.sequence != 0 || lookaheadReady ||
+    requestCount;
 }
 
 
 // Plays the specified sequence of notes.  If the play mode is 
 // PLAY_AUTOMATIC, the sequence of notes will play with no further
 // action required by the user.  If the play mode is PLAY_CHECK,
-// the user will need to call playCheck() in the main loop to initiate
-// the playing of each new note in the sequence.  The play mode can
-// be changed while the sequence is playing.  
+// the user will need to call playCheck() in the main loop to parse
+// each new note in the sequence before the previous one ends.  The play
+// mode can be changed while the sequence is playing.  
 // This is modeled after the PLAY commands in GW-BASIC, with just a
 // few differences.
 //
@@ -474,243 +738,298 @@ unsigned char ZumoBuzzer::isPlaying()
 void ZumoBuzzer::play(const char *notes)
 {
   DISABLE_TIMER_INTERRUPT();  // prevent this from being interrupted
-  buzzerSequence = notes;
-  use_program_space = 0;
-  staccato_rest_duration = 0;
+  compiledRemaining = 0;
+  lookaheadReady = 0;
+  playerPriority = 0;
+  player.sequence = notes;
+  player.use_program_space = 0;
+  player.staccato_rest_duration = 0;
   nextNote();          // this re-enables the timer1 interrupt
+  fillLookahead();     // parse the second note now so it can start on time
+
+  // if the first note ended while the second was being parsed (or there was
+  // no first note), the interrupt has gone silent, so start the second here
+  if (buzzerFinished)
+    startReady();
 }
 
 void ZumoBuzzer::playFromProgramSpace(const char *notes_p)
 {
   DISABLE_TIMER_INTERRUPT();  // prevent this from being interrupted
-  buzzerSequence = notes_p;
-  use_program_space = 1;
-  staccato_rest_duration = 0;
+  compiledRemaining = 0;
+  lookaheadReady = 0;
+  playerPriority = 0;
+  player.sequence = notes_p;
+  player.use_program_space = 1;
+  player.staccato_rest_duration = 0;
   nextNote();          // this re-enables the timer1 interrupt
-}
+  fillLookahead();     // parse the second note now so it can start on time
 
+  // if the first note ended while the second was being parsed (or there was
+  // no first note), the interrupt has gone silent, so start the second here
+  if (buzzerFinished)
+    startReady();
+}
 
-// stop all sound playback immediately
-void ZumoBuzzer::stopPlaying()
+// Queues a sequence of notes to be played with the given priority (higher
+// numbers are more important).  If the priority is higher than that of the
+// sequence currently playing, the current note is cut short and that sequence
+// is put back in the queue to resume later.  This only updates the queue and
+// never parses anything; the new sequence is started by the timer interrupt
+// (or by playCheck() in PLAY_CHECK mode) at the next timer overflow.
+// Returns 0 if the queue is full.
+unsigned char ZumoBuzzer::playQueued(const char *notes, unsigned char priority)
 {
-  DISABLE_TIMER_INTERRUPT();          // disable interrupts
- 
-#ifdef __AVR_ATmega32U4__
-  TCCR4B = (TCCR4B & 0xF0) | TIMER4_CLK_8;  // select IO clock
-  unsigned int top = (F_CPU/16) / 1000;     // set TOP for freq = 1 kHz: 
-  TC4H = top >> 8;                          // top 2 bits... (TC4H temporarily stores top 2 bits of 10-bit accesses)
-  OCR4C = top;                              // and bottom 8 bits
-  TC4H = 0;                                 // 0% duty cycle: top 2 bits...
-  OCR4D = 0;                                // and bottom 8 bits
-#else 
-  TCCR2B = (TCCR2B & 0xF8) | TIMER2_CLK_32; // select IO clock
-  OCR2A = (F_CPU/64) / 1000;                // set TOP for freq = 1 kHz
-  OCR2B = 0;                                // 0% duty cycle
-#endif
+  return startQueued(notes, priority, 0);
+}
 
-  buzzerFinished = 1;
-  buzzerSequence = 0;
+unsigned char ZumoBuzzer::playQueuedFromProgramSpace(const char *notes_p,
+                                                     unsigned char priority)
+{
+  return startQueued(notes_p, priority, 1);
 }
 
-// Gets the current character, converting to lower-case and skipping
-// spaces.  For any spaces, this automatically increments sequence!
-static char currentCharacter()
+unsigned char ZumoBuzzer::startQueued(const char *sequence,
+                                      unsigned char priority,
+                                      unsigned char programSpace)
 {
-  char c = 0;
-  do
+  unsigned char i;
+
+  init(); // initializes the buzzer if necessary
+
+  DISABLE_TIMER_INTERRUPT();  // prevent this from being interrupted
+
+  unsigned char active = player.sequence != 0 || lookaheadReady ||
+    compiledRemaining;
+
+  if (requestCount == ZUMO_BUZZER_QUEUE_SIZE)
   {
-    if(use_program_space)
-      c = pgm_read_byte(buzzerSequence);
-    else
-      c = *buzzerSequence;
+    if (!buzzerFinished)
+      ENABLE_TIMER_INTERRUPT();
+    return 0;
+  }
 
-    if(c >= 'A' && c <= 'Z')
-      c += 'a'-'A';
-  } while(c == ' ' && (buzzerSequence ++));
+  if (priority <= playerPriority && (active || !buzzerFinished))
+  {
+    // wait behind the current sequence (or the last note of it)
+    BuzzerRequest *request = &requestQueue[requestCount++];
+    request->parser.begin(sequence, programSpace);
+    request->hasPending = 0;
+    request->priority = priority;
+    request->compiledRemaining = 0;
+
+    if (!buzzerFinished)
+      ENABLE_TIMER_INTERRUPT();
+    return 1;
+  }
 
-  return c;
+  if (active)
+  {
+    // put the current sequence at the front of the queue so it resumes
+    // before anything else with its priority
+    for (i = requestCount; i > 0; i--)
+      requestQueue[i] = requestQueue[i - 1];
+    requestCount++;
+    requestQueue[0].parser = player;
+    requestQueue[0].pending = lookahead;
+    requestQueue[0].hasPending = lookaheadReady;
+    requestQueue[0].priority = playerPriority;
+    requestQueue[0].compiledEvents = compiledEvents;
+    requestQueue[0].compiledRemaining = compiledRemaining;
+    requestQueue[0].compiledProgramSpace = compiledProgramSpace;
+  }
+
+  player.begin(sequence, programSpace);
+  playerPriority = priority;
+  lookaheadReady = 0;
+  compiledRemaining = 0;
+
+  // end the current note at the next timer overflow; the interrupt (or
+  // playCheck()) will then parse and start the new sequence
+  buzzerTimeout = 0;
+  buzzerTimeoutHigh = 0;
+  buzzerFinished = 0;
+  ENABLE_TIMER_INTERRUPT();
+  return 1;
 }
 
-// Returns the numerical argument specified at buzzerSequence[0] and
-// increments sequence to point to the character immediately after the
-// argument.
-static unsigned int getNumber()
+// Converts a sequence of notes into timer settings that playCompiled() can
+// play without any parsing.  The sequence is parsed starting from the default
+// settings (as if it began with '!'); the persistent settings used by play()
+// are not affected.  Returns the number of events stored, which is at most
+// maxEvents (a staccato note takes two events).
+unsigned int ZumoBuzzer::compile(const char *sequence, ZumoBuzzerEvent *events,
+                                 unsigned int maxEvents)
 {
-  unsigned int arg = 0;
+  ZumoBuzzerParser parser;
+  parser.begin(sequence, 0);
+  return compileSequence(&parser, events, maxEvents);
+}
 
-  // read all digits, one at a time
-  char c = currentCharacter();
-  while(c >= '0' && c <= '9')
-  {
-    arg *= 10;
-    arg += c-'0';
-    buzzerSequence ++;
-    c = currentCharacter();
-  }
+unsigned int ZumoBuzzer::compileFromProgramSpace(const char *sequence_p,
+                                                 ZumoBuzzerEvent *events,
+                                                 unsigned int maxEvents)
+{
+  ZumoBuzzerParser parser;
+  parser.begin(sequence_p, 1);
+  return compileSequence(&parser, events, maxEvents);
+}
 
-  return arg;
+// Parses notes until the sequence ends or maxEvents events have been stored.
+static unsigned int compileSequence(ZumoBuzzerParser *p,
+                                    ZumoBuzzerEvent *events,
+                                    unsigned int maxEvents)
+{
+  unsigned int count = 0;
+  unsigned char note, volume;
+  uint16_t dur;
+
+  while (count < maxEvents && p->parseNote(&note, &dur, &volume))
+    computeNote(note, dur, volume, &events[count++]);
+
+  return count;
 }
 
-static void nextNote()
+// Plays a compiled sequence of events.  When each event ends, the timer
+// overflow interrupt just loads the next one and writes it to the timer
+// registers, so this works the same way regardless of the play mode.
+void ZumoBuzzer::playCompiled(const ZumoBuzzerEvent *events, unsigned int count)
 {
-  unsigned char note = 0;
-  unsigned char rest = 0;
-  unsigned char tmp_octave = octave; // the octave for this note
-  unsigned int tmp_duration; // the duration of this note
-  unsigned int dot_add;
+  startCompiled(events, count, 0);
+}
 
-  char c; // temporary variable
+void ZumoBuzzer::playCompiledFromProgramSpace(const ZumoBuzzerEvent *events_p,
+                                              unsigned int count)
+{
+  startCompiled(events_p, count, 1);
+}
 
-  // if we are playing staccato, after every note we play a rest
-  if(staccato && staccato_rest_duration)
+void ZumoBuzzer::startCompiled(const ZumoBuzzerEvent *events, unsigned int count,
+                               unsigned char programSpace)
+{
+  if (count == 0)
   {
-    ZumoBuzzer::playNote(SILENT_NOTE, staccato_rest_duration, 0);
-    staccato_rest_duration = 0;
+    stopPlaying();
     return;
   }
 
- parse_character:
+  init(); // initializes the buzzer if necessary
 
-  // Get current character
-  c = currentCharacter();
-  buzzerSequence ++;
+  DISABLE_TIMER_INTERRUPT();  // prevent this from being interrupted
+  player.sequence = 0;
+  lookaheadReady = 0;
+  playerPriority = 0;
+  buzzerFinished = 0;
+  compiledEvents = events;
+  compiledRemaining = count;
+  compiledProgramSpace = programSpace;
+  nextCompiledEvent();        // this re-enables the timer interrupt
+}
 
-  // Interpret the character.
-  switch(c)
-  {
-  case '>':
-    // shift the octave temporarily up
-    tmp_octave ++;
-    goto parse_character;
-  case '<':
-    // shift the octave temporarily down
-    tmp_octave --;
-    goto parse_character;
-  case 'a':
-    note = NOTE_A(0);
-    break;
-  case 'b':
-    note = NOTE_B(0);
-    break;
-  case 'c':
-    note = NOTE_C(0);
-    break;
-  case 'd':
-    note = NOTE_D(0);
-    break;
-  case 'e':
-    note = NOTE_E(0);
-    break;
-  case 'f':
-    note = NOTE_F(0);
-    break;
-  case 'g':
-    note = NOTE_G(0);
-    break;
-  case 'l':
-    // set the default note duration
-    note_type = getNumber();
-    duration = whole_note_duration/note_type;
-    goto parse_character;
-  case 'm':
-    // set music staccato or legato
-    if(currentCharacter() == 'l')
-      staccato = false;
-    else
-    {
-      staccato = true;
-      staccato_rest_duration = 0;
-    }
-    buzzerSequence ++;
-    goto parse_character;
-  case 'o':
-    // set the octave permanently
-    octave = getNumber();
-    tmp_octave = octave;
-    goto parse_character;
-  case 'r':
-    // Rest - the note value doesn't matter.
-    rest = 1;
-    break;
-  case 't':
-    // set the tempo
-    whole_note_duration = 60*400/getNumber()*10;
-    duration = whole_note_duration/note_type;
-    goto parse_character;
-  case 'v':
-    // set the volume
-    volume = getNumber();
-    goto parse_character;
-  case '!':
-    // reset to defaults
-    octave = 4;
-    whole_note_duration = 2000;
-    note_type = 4;
-    duration = 500;
-    volume = 15;
-    staccato = 0;
-    // reset temp variables that depend on the defaults
-    tmp_octave = octave;
-    tmp_duration = duration;
-    goto parse_character;
-  default:
-    buzzerSequence = 0;
-    return;
-  }
 
-  note += tmp_octave*12;
+// stop all sound playback immediately
+void ZumoBuzzer::stopPlaying()
+{
+  silenceBuzzer();
+  player.sequence = 0;
+  lookaheadReady = 0;
+  requestCount = 0;
+  compiledRemaining = 0;
+}
 
-  // handle sharps and flats
-  c = currentCharacter();
-  while(c == '+' || c == '#')
-  {
-    buzzerSequence ++;
-    note ++;
-    c = currentCharacter();
-  }
-  while(c == '-')
+// Starts the next note of the sequence being played by play().  If the
+// sequence has no notes, the buzzer is silenced and marked finished instead.
+static void nextNote()
+{
+  unsigned char note, volume;
+  uint16_t dur;
+
+  PARSE_TIMING_START();
+  if (player.parseNote(&note, &dur, &volume))
   {
-    buzzerSequence ++;
-    note --;
-    c = currentCharacter();
+    PARSE_TIMING_STOP();
+
+    // this will re-enable the timer overflow interrupt
+    ZumoBuzzer::playNote(note, dur, volume);
   }
+  else if (buzzerInitialized)
+    silenceBuzzer();  // end any note left playing; the interrupt stays off
+}
 
-  // set the duration of just this note
-  tmp_duration = duration;
+// Moves the most important request in the queue into the player, restoring
+// its lookahead note or compiled events if it was preempted.  Returns 0 if the
+// queue is empty.
+static unsigned char popRequest()
+{
+  unsigned char best = 0;
+  unsigned char i;
 
-  // If the input is 'c16', make it a 16th note, etc.
-  if(c > '0' && c < '9')
-    tmp_duration = whole_note_duration/getNumber();
+  if (requestCount == 0)
+    return 0;
 
-  // Handle dotted notes - the first dot adds 50%, and each
-  // additional dot adds 50% of the previous dot.
-  dot_add = tmp_duration/2;
-  while(currentCharacter() == '.')
+  for (i = 1; i < requestCount; i++)
   {
-    buzzerSequence ++;
-    tmp_duration += dot_add;
-    dot_add /= 2;
+    if (requestQueue[i].priority > requestQueue[best].priority)
+      best = i;
   }
 
-  if(staccato)
+  player = requestQueue[best].parser;
+  playerPriority = requestQueue[best].priority;
+  if (requestQueue[best].hasPending)
   {
-    staccato_rest_duration = tmp_duration / 2;
-    tmp_duration -= staccato_rest_duration;
+    lookahead = requestQueue[best].pending;
+    lookaheadReady = 1;
   }
-  
-  // this will re-enable the timer1 overflow interrupt
-  ZumoBuzzer::playNote(rest ? SILENT_NOTE : note, tmp_duration, volume);
+  unsigned char oldSREG = SREG;
+  cli();  // the interrupt may be playing a note and reads these when it ends
+  compiledEvents = requestQueue[best].compiledEvents;
+  compiledProgramSpace = requestQueue[best].compiledProgramSpace;
+  compiledRemaining = requestQueue[best].compiledRemaining;
+  SREG = oldSREG;
+
+  requestCount--;
+  for (i = best; i < requestCount; i++)
+    requestQueue[i] = requestQueue[i + 1];
+
+  return 1;
+}
+
+// Parses the note after the one currently playing into the lookahead buffer,
+// if it is empty, moving on to the next queued sequence when the current one
+// ends.  A compiled sequence resumed from the queue needs no parsing, so it
+// stops there.  This is only ever run from the main program (play() and
+// playCheck()) or from refillLookahead() with interrupts enabled, never in
+// the time-critical part of the interrupt.
+static void fillLookahead()
+{
+  unsigned char note, volume;
+  uint16_t dur;
+
+  lookaheadBusy = 1;
+  while (!lookaheadReady && !compiledRemaining &&
+         (player.sequence || popRequest()))
+  {
+    PARSE_TIMING_START();
+    if (player.sequence && player.parseNote(&note, &dur, &volume))
+    {
+      computeNote(note, dur, volume, &lookahead);
+      PARSE_TIMING_STOP();
+      lookaheadReady = 1; // set last: the interrupt may start it right away
+    }
+  }
+  lookaheadBusy = 0;
 }
 
 
-// This puts play() into a mode where instead of advancing to the
-// next note in the sequence automatically, it waits until the
-// function playCheck() is called. The idea is that you can
-// put playCheck() in your main loop and avoid potential
-// delays due to the note sequence being checked in the middle of
-// a time sensitive calculation.  It is recommended that you use
-// this function if you are doing anything that can't tolerate
-// being interrupted for more than a few microseconds.
+// This puts play() into a mode where instead of parsing the next
+// note in the sequence automatically, it waits until the function
+// playCheck() is called. The idea is that you can put playCheck() in
+// your main loop and avoid potential delays due to the note sequence
+// being parsed in the middle of a time sensitive calculation.  In
+// either mode, the timer interrupt only starts notes that have already
+// been parsed; in this mode it never runs the parser at all.  It is
+// recommended that you use this function if you are doing anything that
+// can't tolerate being interrupted for more than a few microseconds.
 // Note that the play mode can be changed while a sequence is being
 // played.
 //
@@ -728,15 +1047,69 @@ void ZumoBuzzer::playMode(unsigned char mode)
 }
 
 
-// Checks whether it is time to start another note, and starts
-// it if so.  If it is not yet time to start the next note, this method
-// returns without doing anything.  Call this as often as possible 
-// in your main loop to avoid delays between notes in the sequence.
+// Parses the next note of the sequence if it has not been parsed yet,
+// and starts it if the previous note has already ended.  The timer
+// interrupt starts a parsed note as soon as the previous one ends, so
+// there are no gaps between notes as long as this is called at least
+// once during each note.
 //
 // Returns true if it is still playing.
 unsigned char ZumoBuzzer::playCheck()
 {
-  if(buzzerFinished && buzzerSequence != 0)
-    nextNote();
-  return buzzerSequence != 0;
+  fillLookahead();
+  if(buzzerFinished)
+    startReady();
+  return player.sequence != 0 || lookaheadReady || requestCount;
 }
+
+
+#ifdef ZUMO_BUZZER_INSTRUMENTATION
+
+// Copies the timing statistics into stats, converting them to cycles.
+void ZumoBuzzer::getStats(ZumoBuzzerStats *stats)
+{
+  unsigned char oldSREG = SREG;
+  cli();  // the interrupt updates these, so copy them all at once
+  unsigned long count = overflowCount;
+  unsigned char minTicks = isrMinTicks;
+  unsigned char maxTicks = isrMaxTicks;
+  unsigned long tickSum = isrTickSum;
+  SREG = oldSREG;
+
+  unsigned long elapsed = millis() - statsStartMillis;
+
+  stats->overflowCount = count;
+  stats->overflowsPerSecond = elapsed ? count / elapsed * 1000 +
+    count % elapsed * 1000 / elapsed : 0;
+  stats->isrMinCycles = count ? minTicks * CYCLES_PER_TIMER0_TICK : 0;
+  stats->isrMaxCycles = maxTicks * CYCLES_PER_TIMER0_TICK;
+  stats->isrMeanCycles = count ? tickSum * CYCLES_PER_TIMER0_TICK / count : 0;
+
+  // in PLAY_AUTOMATIC mode, the interrupt also parses notes and updates these
+  oldSREG = SREG;
+  cli();
+  stats->parseCount = parseCount;
+  stats->parseMinCycles = parseCount ? parseMinMicros * (F_CPU / 1000000) : 0;
+  stats->parseMaxCycles = parseMaxMicros * (F_CPU / 1000000);
+  stats->parseMeanCycles = parseCount ?
+    parseMicrosSum / parseCount * (F_CPU / 1000000) : 0;
+  SREG = oldSREG;
+}
+
+void ZumoBuzzer::resetStats()
+{
+  unsigned char oldSREG = SREG;
+  cli();
+  statsStartMillis = millis();
+  overflowCount = 0;
+  isrMinTicks = 0xFF;
+  isrMaxTicks = 0;
+  isrTickSum = 0;
+  parseCount = 0;
+  parseMinMicros = 0xFFFFFFFF;
+  parseMaxMicros = 0;
+  parseMicrosSum = 0;
+  SREG = oldSREG;
+}
+
+#endif
@@ -14,11 +14,16 @@
  * Note durations are timed using a timer overflow interrupt
  * (`TIMER2_OVF`/`TIMER4_OVF`), which will briefly interrupt execution of your
  * main program at the frequency of the sound being played. In most cases, the
- * interrupt-handling routine is very short (several microseconds). However,
- * when playing a sequence of notes in `PLAY_AUTOMATIC` mode (the default mode)
- * with the `play()` command, this interrupt takes much longer than normal
- * (perhaps several hundred microseconds) every time it starts a new note. It is
- * important to take this into account when writing timing-critical code.
+ * interrupt-handling routine is very short (several microseconds). When
+ * playing a sequence of notes with the `play()` command, each note is parsed
+ * ahead of time while the previous one is playing, so starting a new note from
+ * the interrupt only takes a few register writes. In `PLAY_AUTOMATIC` mode (the
+ * default mode), the interrupt then goes on to parse the note after that with
+ * global interrupts re-enabled, which takes much longer (perhaps several
+ * hundred microseconds) and delays the main program, though not other
+ * interrupts. In `PLAY_CHECK` mode, the parsing is done by `playCheck()`
+ * instead. It is important to take this into account when writing
+ * timing-critical code.
  *
  * The ZumoBuzzer library is fully compatible with the OrangutanBuzzer functions
  * in the [Pololu AVR C/C++ Library](http://www.pololu.com/docs/0J18), so any
@@ -32,6 +37,26 @@
 #define PLAY_AUTOMATIC 0
 #define PLAY_CHECK     1
 
+/*! \brief Number of melodies that can wait in the queue used by
+ *         `ZumoBuzzer::playQueued()`, including melodies that have been
+ *         preempted and are waiting to resume.
+ *
+ * Each entry takes about 30 bytes of RAM. Define this before including
+ * ZumoBuzzer.h (or pass it to the compiler) to change it.
+ */
+#ifndef ZUMO_BUZZER_QUEUE_SIZE
+#define ZUMO_BUZZER_QUEUE_SIZE 3
+#endif
+
+/*! \brief Uncomment this (or define it when compiling the library) to
+ *         record timing statistics for the buzzer interrupt; see
+ *         `ZumoBuzzer::getStats()`.
+ *
+ * The statistics add a little time to every timer overflow interrupt, so
+ * they are compiled out by default.
+ */
+//#define ZUMO_BUZZER_INSTRUMENTATION
+
 //                                             n
 // Equal Tempered Scale is given by f  = f  * a
 //                                   n    o
@@ -73,6 +98,76 @@
 #define DIV_BY_10     (1 << 15)
 /*! @} */
 
+/*! \brief A precomputed note: the timer settings needed to play it.
+ *
+ * A sequence of these events can be produced from a `play()`-style melody
+ * with `ZumoBuzzer::compile()` and played with `ZumoBuzzer::playCompiled()`.
+ * Since all of the parsing and frequency calculations have already been done,
+ * starting each event only requires loading it from the table and writing it
+ * to the timer registers.
+ *
+ * The values are specific to the timer being used (Timer 2 on the
+ * ATmega328/168, Timer 4 on the ATmega32U4) and to `F_CPU`, so a compiled
+ * table stored in program space should be generated on the same kind of
+ * board it will be played on.
+ */
+struct ZumoBuzzerEvent
+{
+  /*! \brief Timer clock select bits (CS2 on the ATmega328/168, CS4 on the
+   *         ATmega32U4). */
+  unsigned char prescaler;
+
+  /*! \brief Timer TOP value, which determines the frequency. */
+  unsigned int top;
+
+  /*! \brief Output compare value, which determines the volume. */
+  unsigned int width;
+
+  /*! \brief Duration in timer overflows (periods of the note). */
+  unsigned long timeout;
+};
+
+#ifdef ZUMO_BUZZER_INSTRUMENTATION
+
+/*! \brief Timing statistics for the buzzer, returned by
+ *         `ZumoBuzzer::getStats()`.
+ *
+ * Interrupt times are measured with Timer 0 (which the Arduino core runs at
+ * F_CPU/64 for `millis()`), so they have a resolution of 64 cycles and do not
+ * include the few dozen cycles the compiler spends saving and restoring
+ * registers. Parse times are measured with `micros()`, so they have a
+ * resolution of 4 us (64 cycles at 16 MHz).
+ */
+struct ZumoBuzzerStats
+{
+  /*! \brief Number of timer overflow interrupts. */
+  unsigned long overflowCount;
+
+  /*! \brief Average number of timer overflow interrupts per second since
+   *         the statistics were reset. */
+  unsigned int overflowsPerSecond;
+
+  /*! \brief Shortest, longest, and mean time spent in the timer overflow
+   *         interrupt, in cycles, not counting the parsing that the
+   *         interrupt does with global interrupts enabled in
+   *         `PLAY_AUTOMATIC` mode. */
+  unsigned int isrMinCycles;
+  unsigned int isrMaxCycles;
+  unsigned int isrMeanCycles;
+
+  /*! \brief Number of notes parsed from `play()` sequences, whether by the
+   *         interrupt, `play()`, or `playCheck()`. */
+  unsigned long parseCount;
+
+  /*! \brief Shortest, longest, and mean time spent parsing a note and
+   *         computing its timer settings, in cycles. */
+  unsigned long parseMinCycles;
+  unsigned long parseMaxCycles;
+  unsigned long parseMeanCycles;
+};
+
+#endif
+
 class ZumoBuzzer
 {
   public:
@@ -125,12 +220,7 @@ class ZumoBuzzer
    * buzzer.playFrequency(DIV_BY_10 | 445, 1000, 15);
    * ~~~
    *
-   * \warning \a frequency &times; \a duration / 1000 must be no greater than
-     0xFFFF (65535). This means you can't use a max duration of 65535 ms for
-     frequencies greater than 1 kHz. For example, the maximum duration you can
-     use for a frequency of 10 kHz is 6553 ms. If you use a duration longer than
-     this, you will produce an integer overflow that can result in unexpected
-     behavior.
+   * Any \a duration up to 65535 ms can be used at any frequency.
    */
   static void playFrequency(unsigned int freq, unsigned int duration,
                 unsigned char volume);
@@ -168,7 +258,8 @@ class ZumoBuzzer
    * If the play mode is `PLAY_AUTOMATIC` (default), the sequence of notes will
    * play with no further action required by the user. If the play mode is
    * `PLAY_CHECK`, the user will need to call `playCheck()` in the main loop to
-   * initiate the playing of each new note in the sequence. The play mode can be
+   * prepare each new note in the sequence before the previous one ends. The
+   * play mode can be
    * changed while the sequence is playing. The sequence syntax is modeled after
    * the PLAY commands in GW-BASIC, with just a few differences.
    *
@@ -277,6 +368,140 @@ class ZumoBuzzer
    */
   static void playFromProgramSpace(const char *sequence_p);
 
+  /*! \brief Queues a sequence of notes to be played with the specified
+   *         priority.
+   *
+   * \param sequence Char array containing a sequence of notes to play (see
+   *                 `play()`). The array must not change until the sequence
+   *                 has finished playing.
+   * \param priority Priority of the sequence; higher numbers are more
+   *                 important. Sequences started with `play()` have priority
+   *                 0.
+   *
+   * \return 1 if the sequence was queued, or 0 if the queue was full.
+   *
+   * This method only records the request, so it returns right away; the
+   * sequence is parsed and started by the timer interrupt (or by `playCheck()`
+   * in `PLAY_CHECK` mode) within one period of the note currently playing.
+   *
+   * If \a priority is higher than that of the sequence currently playing, the
+   * current note is cut short and the new sequence starts playing. The
+   * interrupted sequence goes back into the queue and resumes from its next
+   * note (with the same tempo, octave, and other settings), or from its next
+   * event if it was started by `playCompiled()`, once nothing more important
+   * is waiting. Otherwise, the new sequence waits in the queue and
+   * is played after everything with a higher priority, and after any queued
+   * sequences with the same priority, have finished.
+   *
+   * At most `ZUMO_BUZZER_QUEUE_SIZE` sequences can be waiting, including
+   * preempted ones. `stopPlaying()` clears the queue.
+   *
+   * ### Example ###
+   *
+   * ~~~{.ino}
+   * ZumoBuzzer buzzer;
+   *
+   * ...
+   *
+   * buzzer.playQueued("L16 V8 cdefgab>cbagfedc", 0);  // background tune
+   *
+   * ...
+   *
+   * buzzer.playQueued("T240 L32 >c>e>g", 1);  // interrupts the tune, which
+   *                                          // then resumes
+   * ~~~
+   */
+  static unsigned char playQueued(const char *sequence, unsigned char priority);
+
+  /*! \brief Queues a sequence of notes from program space to be played with
+   *         the specified priority.
+   *
+   * \param sequence_p Char array in program space containing a sequence of
+   *                   notes to play.
+   * \param priority Priority of the sequence; higher numbers are more
+   *                 important.
+   *
+   * \return 1 if the sequence was queued, or 0 if the queue was full.
+   *
+   * A version of `playQueued()` that takes a pointer to program space instead
+   * of RAM.
+   */
+  static unsigned char playQueuedFromProgramSpace(const char *sequence_p,
+                                                  unsigned char priority);
+
+  /*! \brief Converts a sequence of notes into precomputed events.
+   *
+   * \param sequence  Char array containing a sequence of notes (see `play()`).
+   * \param events    Array to store the events in.
+   * \param maxEvents Maximum number of events to store.
+   *
+   * \return The number of events stored.
+   *
+   * This function runs the same parser as `play()`, but instead of playing the
+   * notes, it calculates the timer settings for each one and stores them in
+   * \a events, to be played later with `playCompiled()`. The sequence is
+   * parsed starting from the default settings (as if it began with **!**),
+   * and the settings that persist between calls to `play()` are not affected.
+   * Each note takes one event, except that staccato notes take two (the note
+   * and the rest after it).
+   *
+   * Compiling can be done once in `setup()`, so that playing the melody
+   * later never has to run the parser from the timer interrupt. Each event
+   * takes 9 bytes of RAM; for long melodies, you can print the compiled events
+   * once and store them in program space instead (see the
+   * ZumoBuzzerCompiledExample sketch).
+   */
+  static unsigned int compile(const char *sequence, ZumoBuzzerEvent *events,
+                              unsigned int maxEvents);
+
+  /*! \brief Converts a sequence of notes in program space into precomputed
+   *         events.
+   *
+   * A version of `compile()` that takes a pointer to program space instead of
+   * RAM.
+   */
+  static unsigned int compileFromProgramSpace(const char *sequence_p,
+                                              ZumoBuzzerEvent *events,
+                                              unsigned int maxEvents);
+
+  /*! \brief Plays a sequence of precomputed events.
+   *
+   * \param events Array of events produced by `compile()`.
+   * \param count  Number of events in the array.
+   *
+   * The events are played in the background, like `play()`. When one event
+   * finishes, the timer overflow interrupt loads the next one from the array
+   * and writes it to the timer registers, which takes only a few microseconds,
+   * so unlike `play()`, this does not make the interrupt slow and works the
+   * same way in either play mode. The array must remain valid until the
+   * sequence is finished. The sequence has priority 0 for `playQueued()`; if
+   * a more important sequence preempts it, it resumes from its next event
+   * afterward.
+   */
+  static void playCompiled(const ZumoBuzzerEvent *events, unsigned int count);
+
+  /*! \brief Plays a sequence of precomputed events from program space.
+   *
+   * A version of `playCompiled()` that takes a pointer to program space
+   * instead of RAM.
+   *
+   * ### Example ###
+   *
+   * ~~~{.ino}
+   * #include <avr/pgmspace.h>
+   *
+   * ZumoBuzzer buzzer;
+   * // "a r" compiled for an Arduino Uno: A4 for 500 ms, then a 500 ms rest
+   * const ZumoBuzzerEvent beep[] PROGMEM = { {5, 142, 71, 220}, {3, 250, 0, 500} };
+   *
+   * ...
+   *
+   * buzzer.playCompiledFromProgramSpace(beep, 2);
+   * ~~~
+   */
+  static void playCompiledFromProgramSpace(const ZumoBuzzerEvent *events_p,
+                                           unsigned int count);
+
   /*! \brief Controls whether `play()` sequence is played automatically or
    *         must be driven with `playCheck()`.
    *
@@ -287,15 +512,17 @@ class ZumoBuzzer
    * `play_check()` method. If \a mode is `PLAY_AUTOMATIC`, the sequence will
    * play automatically in the background, driven by the timer overflow
    * interrupt. The interrupt will take a considerable amount of time to execute
-   * when it starts the next note in the sequence playing, so it is recommended
-   * that you do not use automatic-play if you cannot tolerate being interrupted
-   * for more than a few microseconds. If \a mode is `PLAY_CHECK`, you can
-   * control when the next note in the sequence is played by calling the
-   * `play_check()` method at acceptable points in your main loop. If your main
-   * loop has substantial delays, it is recommended that you use automatic-play
-   * mode rather than play-check mode. Note that the play mode can be changed
-   * while the sequence is being played. The mode is set to `PLAY_AUTOMATIC` by
-   * default.
+   * after it starts each note, since it parses the following note then, so it
+   * is recommended that you do not use automatic-play if you cannot tolerate
+   * being interrupted for more than a few microseconds. If \a mode is
+   * `PLAY_CHECK`, you can control when the notes in the sequence are parsed by
+   * calling the `play_check()` method at acceptable points in your main loop;
+   * the interrupt still starts each parsed note on time, so there are no gaps
+   * between notes as long as `playCheck()` is called at least once per note.
+   * If your main loop has substantial delays, it is recommended that you use
+   * automatic-play mode rather than play-check mode. Note that the play mode
+   * can be changed while the sequence is being played. The mode is set to
+   * `PLAY_AUTOMATIC` by default.
    */
   static void playMode(unsigned char mode);
 
@@ -305,11 +532,11 @@ class ZumoBuzzer
    *  \return 0 if sequence is complete, 1 otherwise.
    *
    * This method only needs to be called if you are in `PLAY_CHECK` mode. It
-   * checks to see whether it is time to start another note in the sequence
-   * initiated by `play()`, and starts it if so. If it is not yet time to start
-   * the next note, this method returns without doing anything. Call this as
-   * often as possible in your main loop to avoid delays between notes in the
-   * sequence. This method returns 0 (false) if the melody to be played is
+   * parses the next note in the sequence initiated by `play()` if that has not
+   * been done yet, and starts it if the previous note has already ended. If the
+   * next note is already parsed, this method returns without doing anything.
+   * Call this at least once per note in your main loop to avoid delays between
+   * notes in the sequence. This method returns 0 (false) if the melody to be played is
    * complete, otherwise it returns 1 (true).
    */
   static unsigned char playCheck();
@@ -320,8 +547,9 @@ class ZumoBuzzer
    *         0 otherwise.
    *
    * This method returns 1 (true) if the buzzer is currently playing a
-   * note/frequency or if it is still playing a sequence started by `play()`.
-   * Otherwise, it returns 0 (false). You can poll this method to determine when
+   * note/frequency, if it is still playing a sequence started by `play()`, or
+   * if any sequences are waiting in the `playQueued()` queue. Otherwise, it
+   * returns 0 (false). You can poll this method to determine when
    * it's time to play the next note in a sequence, or you can use it as the
    * argument to a delay loop to wait while the buzzer is busy.
    */
@@ -330,16 +558,40 @@ class ZumoBuzzer
   /*! \brief Stops any note, frequency, or melody being played.
    *
    * This method will immediately silence the buzzer and terminate any
-   * note/frequency/melody that is currently playing.
+   * note/frequency/melody that is currently playing. It also discards any
+   * sequences waiting in the `playQueued()` queue.
    */
   static void stopPlaying();
 
+#ifdef ZUMO_BUZZER_INSTRUMENTATION
+  /*! \brief Gets the timing statistics recorded since the last call to
+   *         `resetStats()`.
+   *
+   * \param stats Structure that the statistics are copied into.
+   *
+   * Only available if `ZUMO_BUZZER_INSTRUMENTATION` is defined. The
+   * interrupt statistics can be compared against the time taken by other
+   * code (for example, `QTRSensorsRC::read()`) to see how much of its
+   * variation comes from the buzzer.
+   */
+  static void getStats(ZumoBuzzerStats *stats);
+
+  /*! \brief Clears the timing statistics and restarts the overflow rate
+   *         measurement. */
+  static void resetStats();
+#endif
+
 
   private:
 
   // initializes timer for buzzer control
   static void init2();
   static void init();
+
+  static void startCompiled(const ZumoBuzzerEvent *events, unsigned int count,
+                            unsigned char programSpace);
+  static unsigned char startQueued(const char *sequence, unsigned char priority,
+                                   unsigned char programSpace);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "ZumoBuzzer.h"
+#include "ZumoBuzzerParser.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+// sequences are always in RAM on other platforms
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#endif
+
+// Starts parsing the specified sequence with the default settings.
+void ZumoBuzzerParser::begin(const char *sequence_in,
+                             unsigned char use_program_space_in)
+{
+  sequence = sequence_in;
+  use_program_space = use_program_space_in;
+  octave = 4;
+  whole_note_duration = 2000;
+  note_type = 4;
+  duration = 500;
+  volume = 15;
+  staccato = 0;
+  staccato_rest_duration = 0;
+}
+
+// Gets the current character, converting to lower-case and skipping
+// spaces.  For any spaces, this automatically increments sequence!
+static char currentCharacter(ZumoBuzzerParser *p)
+{
+  char c = 0;
+  do
+  {
+    if(p->use_program_space)
+      c = pgm_read_byte(p->sequence);
+    else
+      c = *p->sequence;
+
+    if(c >= 'A' && c <= 'Z')
+      c += 'a'-'A';
+  } while(c == ' ' && (p->sequence ++));
+
+  return c;
+}
+
+// Returns the numerical argument specified at p->sequence[0] and
+// increments sequence to point to the character immediately after the
+// argument.
+static uint16_t getNumber(ZumoBuzzerParser *p)
+{
+  uint16_t arg = 0;
+
+  // read all digits, one at a time
+  char c = currentCharacter(p);
+  while(c >= '0' && c <= '9')
+  {
+    arg *= 10;
+    arg += c-'0';
+    p->sequence ++;
+    c = currentCharacter(p);
+  }
+
+  return arg;
+}
+
+// Same as getNumber(), but returns 1 instead of 0 (for example, for "T0",
+// "L0", or a number that overflows to 0), since the result is used as a
+// divisor.
+static uint16_t getDivisor(ZumoBuzzerParser *p)
+{
+  uint16_t arg = getNumber(p);
+  return arg ? arg : 1;
+}
+
+// Parses the sequence up to and including the next note (or rest) and
+// returns it in note, dur, and volume.  Returns 0 (and sets sequence to 0)
+// when the end of the sequence is reached, or 1 otherwise.
+unsigned char ZumoBuzzerParser::parseNote(unsigned char *note_out,
+                                          uint16_t *dur_out,
+                                          unsigned char *volume_out)
+{
+  unsigned char note = 0;
+  unsigned char rest = 0;
+  unsigned char tmp_octave = octave; // the octave for this note
+  uint16_t tmp_duration; // the duration of this note
+  uint16_t dot_add;
+
+  char c; // temporary variable
+
+  // if we are playing staccato, after every note we play a rest
+  if(staccato && staccato_rest_duration)
+  {
+    *note_out = SILENT_NOTE;
+    *dur_out = staccato_rest_duration;
+    *volume_out = 0;
+    staccato_rest_duration = 0;
+    return 1;
+  }
+
+ parse_character:
+
+  // Get current character
+  c = currentCharacter(this);
+  sequence ++;
+
+  // Interpret the character.
+  switch(c)
+  {
+  case '>':
+    // shift the octave temporarily up
+    tmp_octave ++;
+    goto parse_character;
+  case '<':
+    // shift the octave temporarily down
+    tmp_octave --;
+    goto parse_character;
+  case 'a':
+    note = NOTE_A(0);
+    break;
+  case 'b':
+    note = NOTE_B(0);
+    break;
+  case 'c':
+    note = NOTE_C(0);
+    break;
+  case 'd':
+    note = NOTE_D(0);
+    break;
+  case 'e':
+    note = NOTE_E(0);
+    break;
+  case 'f':
+    note = NOTE_F(0);
+    break;
+  case 'g':
+    note = NOTE_G(0);
+    break;
+  case 'l':
+    // set the default note duration
+    note_type = getDivisor(this);
+    duration = whole_note_duration/note_type;
+    goto parse_character;
+  case 'm':
+    // set music staccato or legato
+    c = currentCharacter(this);
+    if(c == 'l')
+      staccato = false;
+    else
+    {
+      staccato = true;
+      staccato_rest_duration = 0;
+    }
+    if(c != 0)
+      sequence ++; // don't skip the end of a sequence ending in "M"
+    goto parse_character;
+  case 'o':
+    // set the octave permanently
+    octave = getNumber(this);
+    tmp_octave = octave;
+    goto parse_character;
+  case 'r':
+    // Rest - the note value doesn't matter.
+    rest = 1;
+    break;
+  case 't':
+    // set the tempo
+    whole_note_duration = 60*400/getDivisor(this)*10;
+    duration = whole_note_duration/note_type;
+    goto parse_character;
+  case 'v':
+    // set the volume
+    volume = getNumber(this);
+    goto parse_character;
+  case '!':
+    // reset to defaults
+    octave = 4;
+    whole_note_duration = 2000;
+    note_type = 4;
+    duration = 500;
+    volume = 15;
+    staccato = 0;
+    // reset temp variables that depend on the defaults
+    tmp_octave = octave;
+    tmp_duration = duration;
+    goto parse_character;
+  default:
+    sequence = 0;
+    return 0;
+  }
+
+  note += tmp_octave*12;
+
+  // handle sharps and flats
+  c = currentCharacter(this);
+  while(c == '+' || c == '#')
+  {
+    sequence ++;
+    note ++;
+    c = currentCharacter(this);
+  }
+  while(c == '-')
+  {
+    sequence ++;
+    note --;
+    c = currentCharacter(this);
+  }
+
+  // set the duration of just this note
+  tmp_duration = duration;
+
+  // If the input is 'c16', make it a 16th note, etc.
+  if(c > '0' && c < '9')
+    tmp_duration = whole_note_duration/getDivisor(this);
+
+  // Handle dotted notes - the first dot adds 50%, and each
+  // additional dot adds 50% of the previous dot.
+  dot_add = tmp_duration/2;
+  while(currentCharacter(this) == '.')
+  {
+    sequence ++;
+    tmp_duration += dot_add;
+    dot_add /= 2;
+  }
+
+  if(staccato)
+  {
+    staccato_rest_duration = tmp_duration / 2;
+    tmp_duration -= staccato_rest_duration;
+  }
+
+  *note_out = rest ? SILENT_NOTE : note;
+  *dur_out = tmp_duration;
+  *volume_out = volume;
+  return 1;
+}
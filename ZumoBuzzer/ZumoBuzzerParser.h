@@ -0,0 +1,81 @@
+/*! \file ZumoBuzzerParser.h
+ *
+ * \brief Parser for the note sequences played by `ZumoBuzzer::play()`.
+ *
+ * The parser turns a sequence into notes, durations, and volumes; it does not
+ * touch the buzzer timer or depend on the Arduino core. ZumoBuzzerParser.h and
+ * ZumoBuzzerParser.cpp can therefore also be compiled for a PC, for example to
+ * check how a melody will be interpreted:
+ *
+ * ~~~{.cpp}
+ * ZumoBuzzerParser parser;
+ * unsigned char note, volume;
+ * uint16_t duration;
+ *
+ * parser.begin("! T240 L8 a gafaeada", 0);
+ * while (parser.parseNote(&note, &duration, &volume))
+ *   printf("%d %d %d\n", note, duration, volume);
+ * ~~~
+ *
+ * The arithmetic is done with 16-bit types, so the results (including any
+ * overflow in tempo and duration calculations) are the same on every platform.
+ * Sequences in program space can only be read on the AVR; on other platforms,
+ * \a use_program_space is ignored and all sequences are read from RAM.
+ */
+
+#ifndef ZumoBuzzerParser_h
+#define ZumoBuzzerParser_h
+
+#include <stdint.h>
+
+/*! \brief State of the melody parser.
+ *
+ * The persistent music settings (octave, tempo, default note length, volume,
+ * and staccato) live here along with the position in the sequence, so several
+ * sequences can be parsed independently.
+ */
+struct ZumoBuzzerParser
+{
+  const char *sequence;         // next character, or 0 if finished
+  unsigned char use_program_space; // boolean: true if we should
+                                   // use program space
+
+  // music settings and defaults
+  unsigned char octave;         // the current octave
+  uint16_t whole_note_duration; // the duration of a whole note
+  uint16_t note_type;           // 4 for quarter, etc
+  uint16_t duration;            // the duration of a note in ms
+  unsigned char volume;         // the note volume
+  unsigned char staccato;       // true if playing staccato
+
+  // staccato handling
+  uint16_t staccato_rest_duration; // duration of a staccato
+                                   //  rest, or zero if it is time
+                                   //  to play a note
+
+  /*! \brief Starts parsing a sequence with the default settings (as if it
+   *         began with '!').
+   *
+   * \param sequence Sequence of notes (see `ZumoBuzzer::play()`).
+   * \param use_program_space 1 if \a sequence is in program space, 0 if it is
+   *                          in RAM.
+   */
+  void begin(const char *sequence, unsigned char use_program_space);
+
+  /*! \brief Parses the next note (or rest) in the sequence.
+   *
+   * \param note Receives the note number, or `SILENT_NOTE` for a rest.
+   * \param duration Receives the duration of the note in ms.
+   * \param volume Receives the volume of the note (0--15).
+   *
+   * \return 1 if a note was parsed, or 0 if the end of the sequence was
+   *         reached (in which case \a sequence is set to 0).
+   *
+   * In staccato mode, each note is followed by a rest, which is returned by
+   * the next call.
+   */
+  unsigned char parseNote(unsigned char *note, uint16_t *duration,
+                          unsigned char *volume);
+};
+
+#endif
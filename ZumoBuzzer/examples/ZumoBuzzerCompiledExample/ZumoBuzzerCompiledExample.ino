@@ -0,0 +1,60 @@
+#include <avr/pgmspace.h>
+#include <ZumoBuzzer.h>
+#include <Pushbutton.h>
+
+/*
+ * This example uses the ZumoBuzzer library to compile a melody into
+ * precomputed timer settings with compile(), and then plays it with
+ * playCompiled() each time the Zumo user pushbutton is pressed. While a
+ * compiled melody plays, the buzzer's timer interrupt never has to parse
+ * the melody, so it stays short (a few microseconds) on every note.
+ *
+ * The compiled events are also printed to the serial monitor (9600 baud)
+ * as a C array. You can paste that array into your own sketch and play it
+ * with playCompiledFromProgramSpace() to keep long melodies in program
+ * space instead of RAM. The values depend on the board, so generate them on
+ * the same kind of Arduino you will play them on.
+ */
+
+#define MAX_EVENTS 40
+
+const char melody[] PROGMEM = "! O5 L16 T140 ceg>c8 r <g8 >c4";
+
+ZumoBuzzer buzzer;
+Pushbutton button(ZUMO_BUTTON);
+
+// each event takes 9 bytes of RAM
+ZumoBuzzerEvent events[MAX_EVENTS];
+unsigned int eventCount;
+
+void setup()
+{
+  Serial.begin(9600);
+
+  eventCount = buzzer.compileFromProgramSpace(melody, events, MAX_EVENTS);
+
+  // print the events in a form that can be pasted into a sketch
+  Serial.print("const ZumoBuzzerEvent melody[");
+  Serial.print(eventCount);
+  Serial.println("] PROGMEM =");
+  Serial.println("{");
+  for (unsigned int i = 0; i < eventCount; i++)
+  {
+    Serial.print("  {");
+    Serial.print(events[i].prescaler);
+    Serial.print(", ");
+    Serial.print(events[i].top);
+    Serial.print(", ");
+    Serial.print(events[i].width);
+    Serial.print(", ");
+    Serial.print(events[i].timeout);
+    Serial.println(i + 1 < eventCount ? "}," : "}");
+  }
+  Serial.println("};");
+}
+
+void loop()
+{
+  button.waitForButton();
+  buzzer.playCompiled(events, eventCount);
+}
@@ -0,0 +1,90 @@
+#include <ZumoBuzzer.h>
+#include <QTRSensors.h>
+#include <ZumoReflectanceSensorArray.h>
+
+/*
+ * This example uses the ZumoBuzzer timing statistics to show how much time
+ * the buzzer interrupt takes while a melody plays in the background, next
+ * to the time taken by each reflectance sensor read.  Once per second, the
+ * shortest and longest sensor read times and the buzzer statistics are
+ * printed to the serial monitor (9600 baud), all in CPU cycles.
+ *
+ * The statistics are compiled out of the library by default.  To use this
+ * example, uncomment the line
+ *
+ *   //#define ZUMO_BUZZER_INSTRUMENTATION
+ *
+ * near the top of ZumoBuzzer.h.
+ */
+
+#define CYCLES_PER_MICROSECOND (F_CPU / 1000000)
+
+const char melody[] PROGMEM = "! O5 L16 T140 V8 ceg>c8 r <g8 >c4 r4 <b-ag f8 a8 >c4";
+
+ZumoBuzzer buzzer;
+ZumoReflectanceSensorArray reflectanceSensors;
+unsigned int sensorValues[6];
+
+unsigned long readMin = 0xFFFFFFFF;
+unsigned long readMax = 0;
+unsigned long lastReport = 0;
+
+void setup()
+{
+  Serial.begin(9600);
+  reflectanceSensors.init();
+
+#ifndef ZUMO_BUZZER_INSTRUMENTATION
+  Serial.println("Define ZUMO_BUZZER_INSTRUMENTATION in ZumoBuzzer.h to use this example.");
+  while (1);
+#else
+  buzzer.resetStats();
+#endif
+}
+
+void loop()
+{
+  if (!buzzer.isPlaying())
+    buzzer.playFromProgramSpace(melody);
+
+  unsigned long start = micros();
+  reflectanceSensors.read(sensorValues);
+  unsigned long elapsed = micros() - start;
+
+  if (elapsed < readMin)
+    readMin = elapsed;
+  if (elapsed > readMax)
+    readMax = elapsed;
+
+#ifdef ZUMO_BUZZER_INSTRUMENTATION
+  if (millis() - lastReport >= 1000)
+  {
+    ZumoBuzzerStats stats;
+    buzzer.getStats(&stats);
+
+    Serial.print("read min/max: ");
+    Serial.print(readMin * CYCLES_PER_MICROSECOND);
+    Serial.print('/');
+    Serial.print(readMax * CYCLES_PER_MICROSECOND);
+    Serial.print("  isr min/max/mean: ");
+    Serial.print(stats.isrMinCycles);
+    Serial.print('/');
+    Serial.print(stats.isrMaxCycles);
+    Serial.print('/');
+    Serial.print(stats.isrMeanCycles);
+    Serial.print("  overflows/s: ");
+    Serial.print(stats.overflowsPerSecond);
+    Serial.print("  parse min/max/mean: ");
+    Serial.print(stats.parseMinCycles);
+    Serial.print('/');
+    Serial.print(stats.parseMaxCycles);
+    Serial.print('/');
+    Serial.println(stats.parseMeanCycles);
+
+    readMin = 0xFFFFFFFF;
+    readMax = 0;
+    buzzer.resetStats();
+    lastReport = millis();
+  }
+#endif
+}
@@ -0,0 +1,141 @@
+#include "ZumoAccelFifo.h"
+#include <Wire.h>
+
+// accelerometer addresses
+#define DLHC_ADDRESS  0x19
+#define D_ADDRESS     0x1D
+
+// registers (the same address on both devices unless noted)
+#define WHO_AM_I      0x0F  // LSM303D only
+#define CTRL0         0x1F  // LSM303D only
+#define CTRL_REG1_A   0x20  // CTRL1 on the LSM303D
+#define CTRL2         0x21  // LSM303D only
+#define CTRL_REG4_A   0x23  // LSM303DLHC only
+#define CTRL_REG5_A   0x24  // LSM303DLHC only
+#define OUT_X_L_A     0x28
+#define FIFO_CTRL     0x2E
+#define FIFO_SRC      0x2F
+
+#define D_WHO_AM_I_VALUE 0x49
+
+// setting the top bit of a register address makes the address advance on
+// each byte of a multiple-byte read
+#define AUTO_INCREMENT 0x80
+
+// FIFO_SRC bits
+#define FIFO_OVERRUN  0x40
+#define FIFO_EMPTY    0x20
+#define FIFO_COUNT    0x1F
+
+// the number of samples that fit in the Wire library's buffer
+#define SAMPLES_PER_TRANSFER (BUFFER_LENGTH / 6)
+
+// constructor
+ZumoAccelFifo::ZumoAccelFifo()
+{
+  device = DEVICE_NONE;
+  overrun = false;
+}
+
+boolean ZumoAccelFifo::init(unsigned int rate)
+{
+  // Output data rate field (the top four bits of CTRL_REG1_A/CTRL1): the
+  // LSM303D's codes for 100, 200, and 400 Hz are one more than the DLHC's.
+  unsigned char odr = rate >= 400 ? 0x7 : rate >= 200 ? 0x6 : 0x5;
+
+  address = D_ADDRESS;
+  if (readReg(WHO_AM_I) == D_WHO_AM_I_VALUE)
+  {
+    device = DEVICE_D;
+    writeReg(CTRL2, 0x00);                          // +/- 2 g
+    writeReg(CTRL_REG1_A, ((odr + 1) << 4) | 0x07); // rate, x, y, and z enabled
+    writeReg(CTRL0, 0x40);                          // FIFO enabled
+    writeReg(FIFO_CTRL, 0x40);                      // stream mode
+    return true;
+  }
+
+  address = DLHC_ADDRESS;
+  Wire.beginTransmission(address);
+  if (Wire.endTransmission() == 0)
+  {
+    device = DEVICE_DLHC;
+    writeReg(CTRL_REG4_A, 0x08);                    // +/- 2 g, high resolution
+    writeReg(CTRL_REG1_A, (odr << 4) | 0x07);       // rate, x, y, and z enabled
+    writeReg(CTRL_REG5_A, 0x40);                    // FIFO enabled
+    writeReg(FIFO_CTRL, 0x80);                      // stream mode
+    return true;
+  }
+
+  device = DEVICE_NONE;
+  return false;
+}
+
+unsigned char ZumoAccelFifo::read(ZumoAccelSample *samples, unsigned char maxSamples)
+{
+  if (device == DEVICE_NONE)
+    return 0;
+
+  int src = readReg(FIFO_SRC);
+  if (src < 0 || (src & FIFO_EMPTY))
+  {
+    overrun = false;
+    return 0;
+  }
+
+  // With an overrun, all 32 places are full; otherwise, the count is the
+  // number of unread samples.
+  overrun = src & FIFO_OVERRUN;
+  unsigned char count = overrun ? 32 : src & FIFO_COUNT;
+  if (count > maxSamples)
+    count = maxSamples;
+
+  unsigned char n = 0;
+  while (n < count)
+  {
+    unsigned char chunk = count - n;
+    if (chunk > SAMPLES_PER_TRANSFER)
+      chunk = SAMPLES_PER_TRANSFER;
+
+    Wire.beginTransmission(address);
+    Wire.write(OUT_X_L_A | AUTO_INCREMENT);
+    if (Wire.endTransmission() != 0)
+      break;
+    if (Wire.requestFrom(address, (unsigned char)(chunk * 6)) != chunk * 6)
+      break;
+
+    for (unsigned char i = 0; i < chunk; i++, n++)
+    {
+      int v[3];
+      for (unsigned char j = 0; j < 3; j++)
+      {
+        unsigned char lo = Wire.read();
+        unsigned char hi = Wire.read();
+        v[j] = (int16_t)(hi << 8 | lo) >> 4;
+      }
+      samples[n].x = v[0];
+      samples[n].y = v[1];
+      samples[n].z = v[2];
+    }
+  }
+  return n;
+}
+
+void ZumoAccelFifo::writeReg(unsigned char reg, unsigned char value)
+{
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.write(value);
+  Wire.endTransmission();
+}
+
+// returns -1 if the accelerometer does not answer
+int ZumoAccelFifo::readReg(unsigned char reg)
+{
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  if (Wire.endTransmission() != 0)
+    return -1;
+  if (Wire.requestFrom(address, (unsigned char)1) != 1)
+    return -1;
+  return Wire.read();
+}
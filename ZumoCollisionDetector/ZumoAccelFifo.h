@@ -0,0 +1,83 @@
+/*! \file ZumoAccelFifo.h
+ *
+ * See the ZumoAccelFifo class reference for more information about this
+ * library.
+ *
+ * \class ZumoAccelFifo ZumoAccelFifo.h
+ * \brief Reads every accelerometer sample from the LSM303's FIFO
+ *
+ * Reading the Zumo Shield's LSM303 accelerometer once per loop gives one
+ * sample per loop, and a short jolt that happens between two reads is
+ * missed.  ZumoAccelFifo instead sets the accelerometer to store its samples
+ * in its 32-sample FIFO (in stream mode, where the oldest samples are
+ * dropped if it fills up) and reads all of the samples that have
+ * accumulated each time `read()` is called.  The FIFO holds 160 ms of
+ * samples at 200 Hz, so as long as `read()` is called at least that often,
+ * no samples are lost.
+ *
+ * `read()` reads the number of samples in the FIFO and then reads the
+ * samples with the accelerometer's address auto-increment, in one I2C
+ * transfer for up to five samples (the size of the Wire library's 32-byte
+ * buffer) and one more transfer for each five after that.  Called every
+ * few milliseconds, it usually finds only one or two samples.
+ *
+ * Both the LSM303DLHC (on the original Zumo Shield) and the LSM303D (on
+ * version 1.2) are supported; `init()` finds out which one is connected.
+ * The accelerometer is set to its ±2 g range, and the samples are returned
+ * in units of about 1 mg (the readings shifted right by four bits, which
+ * on the LSM303DLHC are 12-bit readings aligned to the left).
+ *
+ * This class uses the Wire library, so sketches that use it have to include
+ * `Wire.h` and call `Wire.begin()` before `init()`.
+ */
+
+#ifndef ZumoAccelFifo_h
+#define ZumoAccelFifo_h
+
+#include <Arduino.h>
+
+struct ZumoAccelSample
+{
+  int x, y, z;
+};
+
+class ZumoAccelFifo
+{
+  public:
+
+    enum DeviceType
+    {
+      DEVICE_NONE,
+      DEVICE_DLHC,
+      DEVICE_D
+    };
+
+    // constructor
+    ZumoAccelFifo();
+
+    // Finds the accelerometer and sets it up to take samples at the given
+    // rate (100, 200, or 400 Hz) into its FIFO.  Returns false if no
+    // accelerometer was found.
+    boolean init(unsigned int rate = 200);
+
+    unsigned char getDeviceType() { return device; }
+
+    // Reads up to maxSamples samples from the FIFO, oldest first, and
+    // returns the number read.  Samples left in the FIFO are read next time.
+    unsigned char read(ZumoAccelSample *samples, unsigned char maxSamples);
+
+    // true if the FIFO filled up (and samples were lost) before the last
+    // read()
+    boolean overran() { return overrun; }
+
+  private:
+
+    void writeReg(unsigned char reg, unsigned char value);
+    int readReg(unsigned char reg);
+
+    unsigned char device;
+    unsigned char address;
+    boolean overrun;
+};
+
+#endif
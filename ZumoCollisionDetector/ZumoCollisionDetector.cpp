@@ -0,0 +1,127 @@
+#include "ZumoCollisionDetector.h"
+
+// constructor
+ZumoCollisionDetector::ZumoCollisionDetector()
+{
+  sampleRate = 200;
+  cutoff = 5;
+  tauMillis = 100;
+  setThreshold(150, 2);
+  setMotorModel(100, 100, 50);
+  setLeft = setRight = 0;
+  collisionCount = 0;
+  reset();
+}
+
+void ZumoCollisionDetector::setSampleRate(unsigned int hz)
+{
+  sampleRate = hz;
+  setUpFilters();
+  setMotorModel(tauMillis, turnLimit, accelLimit);
+}
+
+void ZumoCollisionDetector::setHighPass(float cutoffHz)
+{
+  cutoff = cutoffHz;
+  setUpFilters();
+}
+
+void ZumoCollisionDetector::setThreshold(unsigned int threshold, unsigned char samples)
+{
+  thresholdSquared = (unsigned long)threshold * threshold;
+  this->samples = samples;
+}
+
+void ZumoCollisionDetector::setMotorModel(unsigned int tauMillis, int turnLimit, int accelLimit)
+{
+  this->tauMillis = tauMillis;
+  this->turnLimit = turnLimit;
+  this->accelLimit = accelLimit;
+
+  // first-order lag: each sample period T moves the modeled speed T/(tau+T)
+  // of the way to the set speed
+  unsigned long periodMicros = 1000000UL / sampleRate;
+  modelGain = 256UL * periodMicros / (1000UL * tauMillis + periodMicros);
+}
+
+void ZumoCollisionDetector::setMotorSpeeds(int leftSpeed, int rightSpeed)
+{
+  setLeft = leftSpeed;
+  setRight = rightSpeed;
+}
+
+void ZumoCollisionDetector::reset()
+{
+  modelLeft = setLeft * 16;
+  modelRight = setRight * 16;
+  suppressed = false;
+  colliding = false;
+  count = 0;
+  magnitudeSquared = 0;
+  setUpFilters();
+}
+
+boolean ZumoCollisionDetector::update(int x, int y)
+{
+  updateModel();
+
+  if (selfAccelerating())
+  {
+    suppressed = true;
+    colliding = false;
+    count = 0;
+    magnitudeSquared = 0;
+    return false;
+  }
+
+  if (suppressed)
+  {
+    // The filters still hold the Zumo's own acceleration, so start them
+    // over from this reading.
+    suppressed = false;
+    filterX.reset();
+    filterY.reset();
+  }
+
+  long fx = filterX.add(x);
+  long fy = filterY.add(y);
+  // each square fits in a long, but their sum can reach 2^31
+  magnitudeSquared = (unsigned long)(fx * fx) + (unsigned long)(fy * fy);
+
+  // count the readings in a row on the other side of the threshold from
+  // where we are now
+  if ((magnitudeSquared > thresholdSquared) != colliding)
+    count++;
+  else
+    count = 0;
+
+  if (count < samples)
+    return false;
+
+  count = 0;
+  colliding = !colliding;
+  if (colliding)
+    collisionCount++;
+  return colliding;
+}
+
+void ZumoCollisionDetector::setUpFilters()
+{
+  filterX.setHighPass(cutoff / sampleRate);
+  filterY.setHighPass(cutoff / sampleRate);
+}
+
+void ZumoCollisionDetector::updateModel()
+{
+  modelLeft += ((long)setLeft * 16 - modelLeft) * modelGain >> 8;
+  modelRight += ((long)setRight * 16 - modelRight) * modelGain >> 8;
+}
+
+boolean ZumoCollisionDetector::selfAccelerating()
+{
+  int left = modelLeft / 16;
+  int right = modelRight / 16;
+
+  return abs(left - right) > turnLimit ||
+    abs(setLeft - left) > accelLimit || abs(setRight - right) > accelLimit;
+}
@@ -0,0 +1,124 @@
+/*! \file ZumoCollisionDetector.h
+ *
+ * See the ZumoCollisionDetector class reference for more information about
+ * this library.
+ *
+ * \class ZumoCollisionDetector ZumoCollisionDetector.h
+ * \brief Detects collisions from accelerometer readings
+ *
+ * ZumoCollisionDetector looks at every reading of the accelerometer (for
+ * example, every sample read from the LSM303's FIFO with ZumoAccelFifo) and
+ * decides when the Zumo has been hit or has run into something.  It does
+ * not read the accelerometer itself: the readings are passed to `update()`
+ * one at a time, so the same code can be run on a desktop computer with
+ * readings recorded from a Zumo (see the Host Simulation section of the
+ * README).
+ *
+ * Each reading's x and y components go through a second-order high-pass
+ * filter (ZumoBiquad from the ZumoFilters library), which removes gravity,
+ * the tilt of the Zumo, and slow changes in speed, and leaves the sudden
+ * jolt of a collision.  A collision starts when the magnitude of the
+ * filtered x-y vector is over the threshold for a given number of readings
+ * in a row, and ends when it has been under the threshold for the same
+ * number of readings.
+ *
+ * The Zumo's own acceleration when it starts, stops, or turns looks like a
+ * collision too, so the detector also needs to know the speeds the motors
+ * have been set to (`setMotorSpeeds()`).  It models each motor's actual
+ * speed as following the set speed with a first-order lag, and ignores the
+ * readings while the Zumo is turning (the two modeled speeds differ by more
+ * than the turn limit) or while a modeled speed is still more than the
+ * acceleration limit away from the set speed.  The filters are restarted
+ * once the Zumo is driving steadily again.  The model advances by one sample
+ * period on each reading, so every reading the accelerometer takes should be
+ * passed to `update()`.
+ *
+ * The readings can be in any units; the defaults are for readings of about
+ * 1000 per g (ZumoAccelFifo's units).  They should stay within -8192 to
+ * 8191, the range ZumoBiquad can filter without overflowing.
+ */
+
+#ifndef ZumoCollisionDetector_h
+#define ZumoCollisionDetector_h
+
+#include <Arduino.h>
+#include <../ZumoFilters/ZumoFilters.h>
+
+class ZumoCollisionDetector
+{
+  public:
+
+    // constructor
+    ZumoCollisionDetector();
+
+    // Sets the rate at which the readings passed to update() were taken, in
+    // Hz (default 200).
+    void setSampleRate(unsigned int hz);
+
+    // Sets the cutoff frequency of the high-pass filter in Hz (default 5).
+    void setHighPass(float cutoffHz);
+
+    // Sets the magnitude the filtered x-y vector has to exceed (default 150)
+    // and the number of readings in a row it has to exceed it for to start a
+    // collision, or be under it for to end one (default 2).
+    void setThreshold(unsigned int threshold, unsigned char samples);
+
+    // Sets the time constant of the motor model in milliseconds (default
+    // 100), and how far apart the two motor speeds (default 100) and how
+    // far a motor's speed from the speed it was set to (default 50) can be
+    // before the readings are ignored, in ZumoMotors speed units.
+    void setMotorModel(unsigned int tauMillis, int turnLimit, int accelLimit);
+
+    // Tells the detector the speeds the motors have just been set to.
+    void setMotorSpeeds(int leftSpeed, int rightSpeed);
+
+    // Forgets the readings and any collision in progress, and assumes the
+    // motors are already running at the speeds they were last set to.
+    void reset();
+
+    // Updates the detector with the x and y components of the next
+    // accelerometer reading.  Returns true if a collision started with this
+    // reading.
+    boolean update(int x, int y);
+
+    // true while a collision is in progress
+    boolean isColliding() { return colliding; }
+
+    // true while the readings are being ignored because of the Zumo's own
+    // acceleration
+    boolean isSuppressed() { return suppressed; }
+
+    // the squared magnitude of the last filtered x-y vector
+    unsigned long getMagnitudeSquared() { return magnitudeSquared; }
+
+    // the number of collisions since the detector was constructed
+    unsigned int getCollisionCount() { return collisionCount; }
+
+  private:
+
+    void setUpFilters();
+    void updateModel();
+    boolean selfAccelerating();
+
+    unsigned int sampleRate;
+    float cutoff;
+    unsigned long thresholdSquared;
+    unsigned char samples;
+    unsigned int tauMillis;
+    int turnLimit;
+    int accelLimit;
+    unsigned int modelGain;   // fraction of the speed error each sample, out of 256
+
+    ZumoBiquad filterX;
+    ZumoBiquad filterY;
+
+    int setLeft, setRight;      // the speeds the motors were set to
+    int modelLeft, modelRight;  // modeled speeds, times 16
+    boolean suppressed;
+    boolean colliding;
+    unsigned char count;        // readings in a row on the other side of the threshold
+    unsigned long magnitudeSquared;
+    unsigned int collisionCount;
+};
+
+#endif
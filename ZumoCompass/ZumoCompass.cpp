@@ -0,0 +1,272 @@
+#include "ZumoCompass.h"
+
+// number of CORDIC iterations; the error after n iterations is less than
+// atan(2^-n)
+#define CORDIC_STEPS 13
+
+// atan(2^-i) as binary angles
+static const unsigned int cordicAngles[CORDIC_STEPS] =
+  { 8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3 };
+
+// the fit forgets 1/FORGET of the old points each time it adds one
+#define FORGET 64
+
+// the fit needs this many points before it is used
+#define MIN_POINTS 12
+
+// points added to the fit are at least 1/SPACING_FRACTION of the width of
+// the readings apart
+#define SPACING_FRACTION 16
+
+// the box of readings has to cover at least COVERAGE/16 of the width of the
+// ellipse in x and y for the fit to be used
+#define COVERAGE 12
+
+// the most the ellipse can be stretched (the ratio of its axes squared)
+// before the fit is rejected
+#define MAX_STRETCH 16
+
+// the readings are divided by this for the fit, to keep the sums of their
+// fourth powers reasonable
+#define FIT_UNIT 1024.0
+
+// constructor
+ZumoCompass::ZumoCompass()
+{
+  setCalibrationSpacing(64);
+  reset();
+}
+
+void ZumoCompass::setCalibrationSpacing(unsigned int spacing)
+{
+  this->spacing = spacing;
+}
+
+void ZumoCompass::reset()
+{
+  averageX.reset();
+  averageY.reset();
+  heading = 0;
+  minX = minY = 32767;
+  maxX = maxY = -32767;
+  for (unsigned char i = 0; i < 14; i++)
+    sums[i] = 0;
+  weight = 0;
+  fitted = false;
+}
+
+unsigned int ZumoCompass::update(int x, int y)
+{
+  if (x < minX) minX = x;
+  if (x > maxX) maxX = x;
+  if (y < minY) minY = y;
+  if (y > maxY) maxY = y;
+
+  int distance = max(maxX - minX, maxY - minY) / SPACING_FRACTION;
+  if (distance < (int)spacing)
+    distance = spacing;
+  if (weight == 0 || abs(x - lastX) + abs(y - lastY) >= distance)
+    addPoint(x, y);
+
+  int ax = averageX.add(x);
+  int ay = averageY.add(y);
+  int hx, hy;
+
+  if (fitted)
+  {
+    long dx = ax - centerX;
+    long dy = ay - centerY;
+    hx = (scaleXX * dx + scaleXY * dy) >> 12;
+    hy = (scaleXY * dx + scaleYY * dy) >> 12;
+  }
+  else
+  {
+    // Scale each axis so that the box of readings becomes a square with
+    // sides of 2048.
+    int rangeX = maxX - minX;
+    int rangeY = maxY - minY;
+    hx = rangeX > 0 ? (2048L * (ax - minX) / rangeX) - 1024 : ax;
+    hy = rangeY > 0 ? (2048L * (ay - minY) / rangeY) - 1024 : ay;
+  }
+
+  heading = atan2(hy, hx);
+  return heading;
+}
+
+unsigned int ZumoCompass::atan2(int y, int x)
+{
+  unsigned int angle = 0;
+
+  if (x == 0 && y == 0)
+    return 0;
+
+  // -32768 has no 16-bit negation, so halve both components first (this
+  // does not change the angle, and the scaling below would shift them down
+  // anyway).
+  if (x == -32768 || y == -32768)
+  {
+    x >>= 1;
+    y >>= 1;
+  }
+
+  // Rotate the vector into the right half-plane.
+  if (x < 0)
+  {
+    x = -x;
+    y = -y;
+    angle = 32768;
+  }
+
+  // Scale it up (or down) so that the larger component is between 4096 and
+  // 8191: big enough to keep the precision of the small steps, and small
+  // enough that the growth of the vector (about 1.65 times) can't overflow.
+  while (x < 4096 && y < 4096 && y > -4096)
+  {
+    x <<= 1;
+    y <<= 1;
+  }
+  while (x > 8191 || y > 8191 || y < -8191)
+  {
+    x >>= 1;
+    y >>= 1;
+  }
+
+  // Rotate it onto the x axis in steps of atan(2^-i), adding up the angle.
+  for (unsigned char i = 0; i < CORDIC_STEPS; i++)
+  {
+    int dx = x >> i;
+    int dy = y >> i;
+    if (y > 0)
+    {
+      x += dy;
+      y -= dx;
+      angle += cordicAngles[i];
+    }
+    else
+    {
+      x -= dy;
+      y += dx;
+      angle -= cordicAngles[i];
+    }
+  }
+  return angle;
+}
+
+void ZumoCompass::addPoint(int x, int y)
+{
+  lastX = x;
+  lastY = y;
+
+  float fx = x / FIT_UNIT;
+  float fy = y / FIT_UNIT;
+  float xx = fx * fx, xy = fx * fy, yy = fy * fy;
+  float terms[14] = { fx, fy, xx, xy, yy, xx * fx, xx * fy, fx * yy, fy * yy,
+    xx * xy, xx * yy, xy * yy, yy * yy, 1 };
+
+  // Weight the old points a little less each time a new one is added.
+  const float keep = 1 - 1.0 / FORGET;
+  for (unsigned char i = 0; i < 14; i++)
+    sums[i] = sums[i] * keep + terms[i];
+  if (weight < FORGET)
+    weight++;
+
+  if (weight >= MIN_POINTS)
+    solve();
+}
+
+// Fits the conic x^2 + B xy + C y^2 + D x + E y + F = 0 to the points by
+// least squares, and if it is an ellipse, sets the calibration from it.
+void ZumoCompass::solve()
+{
+  enum { X, Y, XX, XY, YY, XXX, XXY, XYY, YYY, XXXY, XXYY, XYYY, YYYY, N };
+  const float *s = sums;
+
+  // normal equations for the unknowns B, C, D, E, F, with the terms xy,
+  // y^2, x, y, 1 multiplying them and -x^2 on the other side
+  float a[5][6] = {
+    { s[XXYY], s[XYYY], s[XXY], s[XYY], s[XY], -s[XXXY] },
+    { s[XYYY], s[YYYY], s[XYY], s[YYY], s[YY], -s[XXYY] },
+    { s[XXY],  s[XYY],  s[XX],  s[XY],  s[X],  -s[XXX] },
+    { s[XYY],  s[YYY],  s[XY],  s[YY],  s[Y],  -s[XXY] },
+    { s[XY],   s[YY],   s[X],   s[Y],   s[N],  -s[XX] } };
+
+  // Gaussian elimination with partial pivoting
+  for (unsigned char col = 0; col < 5; col++)
+  {
+    unsigned char pivot = col;
+    for (unsigned char row = col + 1; row < 5; row++)
+    {
+      if (fabs(a[row][col]) > fabs(a[pivot][col]))
+        pivot = row;
+    }
+    if (a[pivot][col] == 0)
+      return;
+    if (pivot != col)
+    {
+      for (unsigned char k = col; k < 6; k++)
+      {
+        float t = a[col][k];
+        a[col][k] = a[pivot][k];
+        a[pivot][k] = t;
+      }
+    }
+    for (unsigned char row = col + 1; row < 5; row++)
+    {
+      float f = a[row][col] / a[col][col];
+      for (unsigned char k = col; k < 6; k++)
+        a[row][k] -= f * a[col][k];
+    }
+  }
+  float p[5];
+  for (signed char row = 4; row >= 0; row--)
+  {
+    float v = a[row][5];
+    for (unsigned char k = row + 1; k < 5; k++)
+      v -= a[row][k] * p[k];
+    p[row] = v / a[row][row];
+  }
+
+  // The conic is (v - c)' M (v - c) = r with M = [1 B/2; B/2 C].
+  float m12 = p[0] / 2, m22 = p[1];
+  float det = m22 - m12 * m12;
+  if (det <= 0)
+    return;  // not an ellipse
+  float cx = (-p[2] * m22 + p[3] * m12) / (2 * det);
+  float cy = (p[2] * m12 - p[3]) / (2 * det);
+  float r = cx * cx + 2 * m12 * cx * cy + m22 * cy * cy - p[4];
+  if (r <= 0)
+    return;
+
+  // Reject very stretched ellipses, which come from points that only cover
+  // part of it.
+  float trace = 1 + m22;
+  if (trace * trace > (MAX_STRETCH + 2 + 1.0 / MAX_STRETCH) * det)
+    return;
+
+  // The readings should have covered most of the ellipse, so the center
+  // should be inside the box of readings and the box should be nearly as
+  // wide as the ellipse.  (The ellipse is 2 sqrt(r C / det) wide in x and
+  // 2 sqrt(r / det) in y.)
+  cx *= FIT_UNIT;
+  cy *= FIT_UNIT;
+  if (cx < minX || cx > maxX || cy < minY || cy > maxY)
+    return;
+  float width = 2 * FIT_UNIT * COVERAGE / 16;
+  if (maxX - minX < width * sqrt(r * m22 / det) || maxY - minY < width * sqrt(r / det))
+    return;
+
+  // The symmetric square root of M maps the ellipse to a circle without
+  // rotating it: sqrt(M) = (M + sqrt(det) I) / sqrt(trace + 2 sqrt(det)).
+  // Scale it so that its largest element is 4096.
+  float sd = sqrt(det);
+  float s11 = 1 + sd, s12 = m12, s22 = m22 + sd;
+  float largest = max(max(fabs(s11), fabs(s12)), fabs(s22));
+  float k = 4096 / largest;
+
+  centerX = cx;
+  centerY = cy;
+  scaleXX = s11 * k;
+  scaleXY = s12 * k;
+  scaleYY = s22 * k;
+  fitted = true;
+}
@@ -0,0 +1,139 @@
+/*! \file ZumoCompass.h
+ *
+ * See the ZumoCompass class reference for more information about this
+ * library.
+ *
+ * \class ZumoCompass ZumoCompass.h
+ * \brief Compass heading with calibration that is learned while driving
+ *
+ * ZumoCompass turns magnetometer readings (for example, `compass.m.x` and
+ * `compass.m.y` from the LSM303 library after `compass.readMag()`) into the
+ * Zumo's heading, assuming that the Zumo is level.  It does not read the
+ * magnetometer itself.
+ *
+ * ### Heading ###
+ *
+ * Each reading passed to `update()` is added to a moving average of the last
+ * eight readings (ZumoMovingAverage from the ZumoFilters library), so the
+ * motors' magnetic interference is smoothed out over several passes through
+ * the sketch's loop instead of by taking several readings at once.  The
+ * average is corrected with the calibration and turned into an angle with
+ * an integer CORDIC arctangent, which is accurate to about 0.05 degrees and
+ * uses only shifts and additions.  Its speed on the AVR has not been
+ * measured against the floating-point `atan2()`; the Benchmark example's
+ * compass_atan2 and float_atan2 lines compare the two on your board.
+ *
+ * Angles are binary angles: a full circle is 65536, so 90 degrees is 16384,
+ * and adding or subtracting them wraps around correctly in 16 bits.  The
+ * heading is the angle of the magnetic field from the Zumo's x axis,
+ * increasing clockwise, as in the Compass example.  `difference()` gives the
+ * signed angle from one heading to another (between -180 and 180 degrees),
+ * and `toDegrees()` converts an angle to degrees.
+ *
+ * ### Calibration ###
+ *
+ * Iron and magnets on the Zumo add a constant offset to the field it measures
+ * (hard-iron distortion), and the steel around the magnetometer stretches
+ * and rotates it (soft-iron distortion).  As the Zumo turns, the readings
+ * therefore trace out an ellipse instead of a circle centered on zero.
+ * ZumoCompass fits an ellipse to the readings while the Zumo drives, with a
+ * least-squares fit of a general conic section that is updated for each new
+ * point, and maps the ellipse back to a circle centered on zero before
+ * computing the heading.  A reading is only added to the fit once it has
+ * moved 1/16 of the width of the range of readings from the last point
+ * added, so there are about 50 points in each turn all the way around and
+ * driving straight for a long time does not crowd out the other directions.
+ * Older points are gradually forgotten so the fit can follow changes in the
+ * Zumo's surroundings.  Each new point costs a few milliseconds of
+ * floating-point math, but that only happens while the Zumo turns.
+ *
+ * Until the fit is good enough (at least a dozen points that give a
+ * reasonable ellipse, with readings from across most of it), the heading is
+ * calibrated with the minimum and maximum readings so far, like the original
+ * Compass example.  Scaling the readings to that box takes two 32-bit
+ * divisions (several hundred cycles each on the AVR) on every `update()`,
+ * so updates are slower until the fit is used, which only needs
+ * multiplications and shifts.  No separate
+ * calibration step is needed: the Zumo just has to turn all the way around
+ * once or twice, which it can do as part of what it is doing anyway.
+ */
+
+#ifndef ZumoCompass_h
+#define ZumoCompass_h
+
+#include <Arduino.h>
+#include <../ZumoFilters/ZumoFilters.h>
+
+// converts degrees to a binary angle
+#define ZUMO_COMPASS_ANGLE(degrees) ((unsigned int)((long)(degrees) * 65536L / 360))
+
+class ZumoCompass
+{
+  public:
+
+    // constructor
+    ZumoCompass();
+
+    // Sets the least distance (in magnetometer units, in x and y together) a
+    // reading has to be from the last point added to the calibration for it
+    // to be added too (default 64).  Normally, the distance is 1/16 of the
+    // width of the range of readings so far; this minimum keeps noise from
+    // adding points before the Zumo has turned, so it should be several times
+    // the noise in the readings.
+    void setCalibrationSpacing(unsigned int spacing);
+
+    // forgets the calibration and the averaged readings
+    void reset();
+
+    // Updates the heading and calibration with the x and y components of a
+    // magnetometer reading, and returns the new heading.
+    unsigned int update(int x, int y);
+
+    // the heading from the last update()
+    unsigned int getHeading() { return heading; }
+
+    // true once the ellipse fit is being used
+    boolean isCalibrated() { return fitted; }
+
+    // the number of points in the ellipse fit (older ones count less)
+    unsigned int getCalibrationPoints() { return weight; }
+
+    // the signed angle from one heading to another
+    static int difference(unsigned int from, unsigned int to) { return (int16_t)(to - from); }
+
+    // converts a binary angle to degrees, from 0 to 359
+    static int toDegrees(unsigned int angle) { return ((unsigned long)angle * 360 + 32768) >> 16; }
+
+    // Integer arctangent of y/x using CORDIC, as a binary angle (0 is the
+    // positive x axis, 16384 is the positive y axis).
+    static unsigned int atan2(int y, int x);
+
+  private:
+
+    void addPoint(int x, int y);
+    void solve();
+
+    unsigned int spacing;
+
+    ZumoMovingAverage<int, 3> averageX;
+    ZumoMovingAverage<int, 3> averageY;
+    unsigned int heading;
+
+    // box calibration from the minimum and maximum readings
+    int minX, maxX, minY, maxY;
+
+    // Sums of the products of powers of the points added to the fit, in
+    // units of 1/1024 of the readings, in the order x, y, x^2, xy, y^2, x^3,
+    // x^2 y, x y^2, y^3, x^3 y, x^2 y^2, x y^3, y^4, and 1.
+    float sums[14];
+    unsigned int weight;
+    int lastX, lastY;  // the last point added
+
+    // the fitted calibration: heading vector = scale * (reading - center),
+    // with scale in units of 1/4096
+    boolean fitted;
+    int centerX, centerY;
+    int scaleXX, scaleXY, scaleYY;
+};
+
+#endif
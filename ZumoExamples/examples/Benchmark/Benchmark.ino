@@ -0,0 +1,160 @@
+/*
+ * Benchmark for the Zumo libraries
+ *
+ * This sketch calls each of the main Zumo library functions many times and
+ * prints how many CPU cycles each call takes, so that changes to the
+ * libraries can be checked for performance regressions.  It runs once at
+ * startup and prints its results to the serial monitor (9600 baud) as
+ * comma-separated lines:
+ *
+ *   # zumo-benchmark mcu=atmega328p f_cpu=16000000
+ *   name,calls,cycles_per_call
+ *   qtr_read,20,...
+ *   ...
+ *   # done
+ *
+ * Lines starting with '#' are comments.  Times are measured with micros(),
+ * averaged over the number of calls, and corrected for the cost of the
+ * empty benchmark loop.  They include the time spent in any interrupts
+ * that occur during the calls (mainly the millis() timer interrupt).
+ *
+ * The reflectance sensor times depend on what is under the sensors, since
+ * each read waits for the sensor outputs to discharge (up to the 2000 us
+ * timeout), so run the benchmark with the Zumo in the same place each
+ * time (for example, on a white surface, or held up in the air for the
+ * maximum read time).  The motor benchmark uses speeds too small to move
+ * the robot, and the buzzer benchmark plays very short, quiet notes.
+ *
+ * The sketch does not use any hardware besides the Zumo Shield, so it can
+ * also be run in an AVR simulator with the sensor pins driven by a script.
+ * The cases that only compute (the filters and the compass heading) can be
+ * timed on a computer with ZumoHostSim/tests/run-benchmark.sh, which prints
+ * host nanoseconds per call under the same names; those numbers are only
+ * comparable with other runs on the same computer.
+ */
+
+#include <QTRSensors.h>
+#include <ZumoReflectanceSensorArray.h>
+#include <ZumoMotors.h>
+#include <ZumoBuzzer.h>
+#include <Pushbutton.h>
+#include <ZumoFilters.h>
+#include <ZumoCompass.h>
+
+#define NUM_SENSORS 6
+
+#if defined(__AVR_ATmega32U4__)
+#define MCU_NAME "atmega32u4"
+#elif defined(__AVR_ATmega328P__)
+#define MCU_NAME "atmega328p"
+#elif defined(__AVR_ATmega168__)
+#define MCU_NAME "atmega168"
+#else
+#define MCU_NAME "unknown"
+#endif
+
+ZumoReflectanceSensorArray reflectanceSensors;
+ZumoMotors motors;
+ZumoBuzzer buzzer;
+Pushbutton button(ZUMO_BUTTON);
+
+unsigned int sensorValues[NUM_SENSORS];
+ZumoMovingAverage<int, 3> movingAverage;
+ZumoEMA<int, 3> ema;
+ZumoBiquad biquad;
+ZumoMedian<int, 5> median;
+ZumoCompass compassHeading;
+ZumoBuzzerEvent events[16];
+volatile int result;  // keeps the compiler from optimizing calls away
+
+const char melody[] = "! O5 L16 T140 ceg>c8 r <g8 >c4";
+
+unsigned long loopMicros; // time taken by 1000 iterations of an empty loop
+
+// Runs statement the given number of times and prints the average number of
+// cycles it took per call.
+#define BENCHMARK(name, calls, statement)                            \
+  do                                                                 \
+  {                                                                  \
+    unsigned long start = micros();                                  \
+    for (volatile unsigned int i = 0; i < (calls); i++)              \
+    {                                                                \
+      statement;                                                     \
+    }                                                                \
+    unsigned long elapsed = micros() - start;                        \
+    unsigned long overhead = loopMicros * (calls) / 1000;            \
+    elapsed = elapsed > overhead ? elapsed - overhead : 0;           \
+    printResult(name, calls, elapsed);                               \
+  } while (0)
+
+void printResult(const char *name, unsigned int calls, unsigned long elapsed)
+{
+  Serial.print(name);
+  Serial.print(',');
+  Serial.print(calls);
+  Serial.print(',');
+  Serial.println(elapsed * (F_CPU / 1000000) / calls);
+}
+
+void setup()
+{
+  Serial.begin(9600);
+#ifdef __AVR_ATmega32U4__
+  while (!Serial);  // wait for the serial monitor to be opened
+#endif
+
+  reflectanceSensors.init();
+
+  // fill in a calibration that covers the full sensor range so that
+  // readCalibrated() and readLine() do the same work as on a course
+  reflectanceSensors.calibrate();
+  for (unsigned char i = 0; i < NUM_SENSORS; i++)
+  {
+    reflectanceSensors.calibratedMinimumOn[i] = 0;
+    reflectanceSensors.calibratedMaximumOn[i] = 2000;
+  }
+
+  biquad.setLowPass(0.05);
+
+  Serial.print("# zumo-benchmark mcu=" MCU_NAME " f_cpu=");
+  Serial.println(F_CPU);
+  Serial.println("name,calls,cycles_per_call");
+
+  unsigned long start = micros();
+  for (volatile unsigned int i = 0; i < 1000; i++);
+  loopMicros = micros() - start;
+
+  BENCHMARK("qtr_read", 20, reflectanceSensors.read(sensorValues));
+  BENCHMARK("qtr_read_calibrated", 20, reflectanceSensors.readCalibrated(sensorValues));
+  BENCHMARK("qtr_read_line", 20, result = reflectanceSensors.readLine(sensorValues));
+
+  BENCHMARK("motors_set_speeds_zero", 1000, motors.setSpeeds(0, 0));
+  BENCHMARK("motors_set_speeds", 1000, motors.setSpeeds(1, -1));
+  motors.setSpeeds(0, 0);
+
+  BENCHMARK("pushbutton_get_single_debounced_press", 1000,
+            result = button.getSingleDebouncedPress());
+
+  BENCHMARK("buzzer_play_note", 1000, buzzer.playNote(NOTE_A(5), 1, 1));
+  BENCHMARK("buzzer_compile_melody", 100,
+            result = buzzer.compile(melody, events, 16));
+  buzzer.stopPlaying();
+
+  BENCHMARK("filters_moving_average_8", 1000, result = movingAverage.add(i));
+  BENCHMARK("filters_ema_8", 1000, result = ema.add(i));
+  BENCHMARK("filters_biquad", 1000, result = biquad.add(i & 0x1FFF));
+  BENCHMARK("filters_median_5", 1000, result = median.add(i));
+
+  // float_atan2 is the floating-point heading calculation ZumoCompass
+  // replaces; compass_update uses readings too close together to add points
+  // to the calibration fit, as when the Zumo drives straight
+  BENCHMARK("compass_atan2", 1000, result = ZumoCompass::atan2(i, 500));
+  BENCHMARK("float_atan2", 1000, result = atan2(i, 500) * (32768 / M_PI));
+  BENCHMARK("compass_update", 1000, result = compassHeading.update(300, i & 15));
+
+  Serial.println("# done");
+}
+
+void loop()
+{
+}
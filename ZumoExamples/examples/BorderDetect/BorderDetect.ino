@@ -19,6 +19,9 @@
 ZumoBuzzer buzzer;
 ZumoMotors motors;
 Pushbutton button(ZUMO_BUTTON); // pushbutton on pin 12
+
+// lets the button's pin-change interrupt wake the Zumo from power-down sleep
+PUSHBUTTON_PCINT_ISR()
  
 #define NUM_SENSORS 6
 unsigned int sensor_values[NUM_SENSORS];
@@ -28,7 +31,9 @@ ZumoReflectanceSensorArray sensors(QTR_NO_EMITTER_PIN);
 void waitForButtonAndCountDown()
 {
   digitalWrite(LED, HIGH);
-  button.waitForButton();
+  // sleep until the button is pushed to save battery power while waiting
+  // (the buzzer is silent here, so it is fine to stop all clocks)
+  button.waitForButtonSleep(PUSHBUTTON_SLEEP_POWER_DOWN);
   digitalWrite(LED, LOW);
    
   // play audible countdown
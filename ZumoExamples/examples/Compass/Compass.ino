@@ -2,22 +2,35 @@
 #include <Pushbutton.h>
 #include <Wire.h>
 #include <LSM303.h>
+#include <ZumoFilters.h>
+#include <ZumoCompass.h>
 
 /* This example uses the magnetometer in the Zumo Shield's onboard
  * LSM303DLHC to help the Zumo make precise 90-degree turns and drive
- * in squares. It uses the ZumoMotors, Pushbutton, and LSM303
- * (compass) libraries. The LSM303 library is not included in the Zumo
- * Shield libraries; it can be downloaded from GitHub at:
+ * in squares. It uses the ZumoMotors, Pushbutton, ZumoCompass, and
+ * LSM303 (compass) libraries. The LSM303 library is not included in
+ * the Zumo Shield libraries; it can be downloaded from GitHub at:
  *
  *   https://github.com/pololu/LSM303
  *
- * This program first calibrates the compass to account for offsets in
- *  its output. Calibration is accomplished in setup().
+ * ZumoCompass turns the magnetometer readings into a heading. It
+ * averages the readings over several passes through loop(), so each
+ * pass only takes one reading, and it calibrates itself while the
+ * Zumo drives by fitting an ellipse to the readings (see the
+ * ZumoCompass library for details). With CALIBRATION_SPIN defined,
+ * the Zumo first spins in place until the calibration is ready;
+ * without it, the Zumo starts driving in squares right away, and its
+ * first few turns are less precise.
  *
  * In loop(), The driving angle then changes its offset by 90 degrees
  * from the heading every second. Essentially, this navigates the
  * Zumo to drive in square patterns.
  *
+ * Since the heading is averaged over passes through loop(), anything
+ * that slows loop() down makes the heading lag behind the Zumo while
+ * it turns, and the Zumo overshoots. So the headings are printed at
+ * 115200 baud, and only every PRINT_INTERVAL passes while turning.
+ *
  * It is important to note that stray magnetic fields from electric
  * current (including from the Zumo's own motors) and the environment
  * (for example, steel rebar in a concrete floor) might adversely
@@ -28,27 +41,30 @@
 #define SPEED           200 // Maximum motor speed when going straight; variable speed when turning
 #define TURN_BASE_SPEED 100 // Base speed when turning (added to variable speed)
 
-
-#define CALIBRATION_SAMPLES 70  // Number of compass readings to take when calibrating
+#define CALIBRATION_SPIN            // Comment this out to skip the calibration spin
+#define CALIBRATION_TIMEOUT 10000   // Longest time to spin when calibrating (ms)
 #define CRB_REG_M_2_5GAUSS 0x60 // CRB_REG_M value for magnetometer +/-2.5 gauss full scale
 #define CRA_REG_M_220HZ    0x1C // CRA_REG_M value for magnetometer 220 Hz update rate
 
-// Allowed deviation (in degrees) relative to target angle that must be achieved before driving straight
-#define DEVIATION_THRESHOLD 5
+// Allowed deviation relative to target angle that must be achieved before driving straight
+#define DEVIATION_THRESHOLD ZUMO_COMPASS_ANGLE(5)
+
+// Number of readings to take after stopping, to fill ZumoCompass's
+// average with readings taken without the motors running
+#define REFRESH_SAMPLES 8
+
+// Number of passes through loop() between printing the headings while
+// turning (printing every pass would slow the passes down)
+#define PRINT_INTERVAL 16
 
 ZumoMotors motors;
 Pushbutton button(ZUMO_BUTTON);
 LSM303 compass;
+ZumoCompass compassHeading;
 
-// Setup will calibrate our compass by finding maximum/minimum magnetic readings
 void setup()
 {
-  // The highest possible magnetic value to read in any direction is 2047
-  // The lowest possible magnetic value to read in any direction is -2047
-  LSM303::vector<int16_t> running_min = {32767, 32767, 32767}, running_max = {-32767, -32767, -32767};
-  unsigned char index;
-
-  Serial.begin(9600);
+  Serial.begin(115200);
 
   // Initiate the Wire library and join the I2C bus as a master
   Wire.begin();
@@ -64,80 +80,71 @@ void setup()
 
   button.waitForButton();
 
+#ifdef CALIBRATION_SPIN
   Serial.println("starting calibration");
 
-  // To calibrate the magnetometer, the Zumo spins to find the max/min
-  // magnetic vectors. This information is used to correct for offsets
-  // in the magnetometer data.
+  // The Zumo spins until ZumoCompass has seen the readings in all
+  // directions and fitted its calibration to them.
   motors.setLeftSpeed(SPEED);
   motors.setRightSpeed(-SPEED);
 
-  for(index = 0; index < CALIBRATION_SAMPLES; index ++)
+  unsigned long start = millis();
+  while (!compassHeading.isCalibrated() && millis() - start < CALIBRATION_TIMEOUT)
   {
     // Take a reading of the magnetic vector and store it in compass.m
-    compass.read();
-
-    running_min.x = min(running_min.x, compass.m.x);
-    running_min.y = min(running_min.y, compass.m.y);
-
-    running_max.x = max(running_max.x, compass.m.x);
-    running_max.y = max(running_max.y, compass.m.y);
-
-    Serial.println(index);
-
-    delay(50);
+    compass.readMag();
+    compassHeading.update(compass.m.x, compass.m.y);
   }
 
   motors.setLeftSpeed(0);
   motors.setRightSpeed(0);
 
-  Serial.print("max.x   ");
-  Serial.print(running_max.x);
-  Serial.println();
-  Serial.print("max.y   ");
-  Serial.print(running_max.y);
-  Serial.println();
-  Serial.print("min.x   ");
-  Serial.print(running_min.x);
-  Serial.println();
-  Serial.print("min.y   ");
-  Serial.print(running_min.y);
-  Serial.println();
-
-  // Set calibrated values to compass.m_max and compass.m_min
-  compass.m_max.x = running_max.x;
-  compass.m_max.y = running_max.y;
-  compass.m_min.x = running_min.x;
-  compass.m_min.y = running_min.y;
+  if (compassHeading.isCalibrated())
+    Serial.println("calibrated");
+  else
+    Serial.println("not calibrated yet; it will finish while driving");
 
   button.waitForButton();
+#endif
 }
 
 void loop()
 {
-  float heading, relative_heading;
+  unsigned int heading;
+  int relative_heading;
   int speed;
-  static float target_heading = averageHeading();
+  static unsigned int target_heading = refreshHeading();
+  static unsigned char passes = 0;
 
-  // Heading is given in degrees away from the magnetic vector, increasing clockwise
-  heading = averageHeading();
+  // Take one reading; the heading is the average of the last few.
+  // Heading is given as a binary angle (65536 is a full circle) away
+  // from the magnetic vector, increasing clockwise
+  compass.readMag();
+  heading = compassHeading.update(compass.m.x, compass.m.y);
 
   // This gives us the relative heading with respect to the target angle
-  relative_heading = relativeHeading(heading, target_heading);
-
-  Serial.print("Target heading: ");
-  Serial.print(target_heading);
-  Serial.print("    Actual heading: ");
-  Serial.print(heading);
-  Serial.print("    Difference: ");
-  Serial.print(relative_heading);
+  relative_heading = ZumoCompass::difference(heading, target_heading);
 
   // If the Zumo has turned to the direction it wants to be pointing, go straight and then do another turn
-  if(abs(relative_heading) < DEVIATION_THRESHOLD)
+  boolean straight = relative_heading > -(int)DEVIATION_THRESHOLD && relative_heading < (int)DEVIATION_THRESHOLD;
+
+  boolean print = straight || ++passes >= PRINT_INTERVAL;
+  if (print)
+  {
+    passes = 0;
+    Serial.print("Target heading: ");
+    Serial.print(ZumoCompass::toDegrees(target_heading));
+    Serial.print("    Actual heading: ");
+    Serial.print(ZumoCompass::toDegrees(heading));
+    Serial.print("    Difference: ");
+    Serial.print(relative_heading * 360L / 65536);
+  }
+
+  if (straight)
   {
     motors.setSpeeds(SPEED, SPEED);
 
-    Serial.print("   Straight");
+    Serial.println("   Straight");
 
     delay(1000);
 
@@ -150,8 +157,8 @@ void loop()
     // to using fixed increments of 90 degrees from the initial
     // heading (which might have been measured in a different magnetic
     // field than the one the Zumo is experiencing now).
-    // Note: fmod() is floating point modulo
-    target_heading = fmod(averageHeading() + 90, 360);
+    // Binary angles wrap around at 360 degrees on their own.
+    target_heading = refreshHeading() + ZUMO_COMPASS_ANGLE(90);
   }
   else
   {
@@ -160,7 +167,7 @@ void loop()
     // minimum base amount plus an additional variable amount based
     // on the heading difference.
 
-    speed = SPEED*relative_heading/180;
+    speed = (long)SPEED * relative_heading / 32768;
 
     if (speed < 0)
       speed -= TURN_BASE_SPEED;
@@ -169,56 +176,19 @@ void loop()
 
     motors.setSpeeds(speed, -speed);
 
-    Serial.print("   Turn");
+    if (print)
+      Serial.println("   Turn");
   }
-  Serial.println();
 }
 
-// Converts x and y components of a vector to a heading in degrees.
-// This function is used instead of LSM303::heading() because we don't
-// want the acceleration of the Zumo to factor spuriously into the
-// tilt compensation that LSM303::heading() performs. This calculation
-// assumes that the Zumo is always level.
-template <typename T> float heading(LSM303::vector<T> v)
+// Takes enough readings to replace the ones in ZumoCompass's average,
+// and returns the heading.
+unsigned int refreshHeading()
 {
-  float x_scaled =  2.0*(float)(v.x - compass.m_min.x) / ( compass.m_max.x - compass.m_min.x) - 1.0;
-  float y_scaled =  2.0*(float)(v.y - compass.m_min.y) / (compass.m_max.y - compass.m_min.y) - 1.0;
-
-  float angle = atan2(y_scaled, x_scaled)*180 / M_PI;
-  if (angle < 0)
-    angle += 360;
-  return angle;
-}
-
-// Yields the angle difference in degrees between two headings
-float relativeHeading(float heading_from, float heading_to)
-{
-  float relative_heading = heading_to - heading_from;
-
-  // constrain to -180 to 180 degree range
-  if (relative_heading > 180)
-    relative_heading -= 360;
-  if (relative_heading < -180)
-    relative_heading += 360;
-
-  return relative_heading;
-}
-
-// Average 10 vectors to get a better measurement and help smooth out
-// the motors' magnetic interference.
-float averageHeading()
-{
-  LSM303::vector<int32_t> avg = {0, 0, 0};
-
-  for(int i = 0; i < 10; i ++)
+  for (unsigned char i = 0; i < REFRESH_SAMPLES; i++)
   {
-    compass.read();
-    avg.x += compass.m.x;
-    avg.y += compass.m.y;
+    compass.readMag();
+    compassHeading.update(compass.m.x, compass.m.y);
   }
-  avg.x /= 10.0;
-  avg.y /= 10.0;
-
-  // avg is the average measure of the magnetic vector.
-  return heading(avg);
+  return compassHeading.getHeading();
 }
@@ -17,18 +17,50 @@
 #include <ZumoMotors.h>
 #include <ZumoBuzzer.h>
 #include <Pushbutton.h>
+#include <ZumoPID.h>
+#include <ZumoSpeedPlanner.h>
+#include <ZumoLineRecovery.h>
 
 
 ZumoBuzzer buzzer;
 ZumoReflectanceSensorArray reflectanceSensors;
 ZumoMotors motors;
 Pushbutton button(ZUMO_BUTTON);
-int lastError = 0;
+
+// PID controller for the steering.  The gains are fixed-point numbers with
+// 8 fractional bits (256 = 1.0): a proportional constant of 64 (1/4) and a
+// derivative constant of 3072, which works out to the derivative constant of
+// 6 per loop used in earlier versions of this example at its loop time of
+// about 2 ms (the derivative is measured per millisecond).  The integral term
+// is generally not very useful for line following, so its gain is 0.  These
+// should work decently for many Zumo motor choices, but you probably want to
+// use trial and error to tune them for your particular Zumo and line course.
+ZumoPID pid(64, 0, 3072);
 
 // This is the maximum speed the motors will be allowed to turn.
 // (400 lets the motors go at top speed; decrease to impose a speed limit)
 const int MAX_SPEED = 400;
 
+// The speed planner chooses the base speed for each loop: MAX_SPEED on
+// straights, and down to MIN_SPEED when the line is far from the center of
+// the sensor array or moving across it quickly, which means the Zumo is in
+// (or entering) a curve.  The speed falls in proportion to the curvature
+// estimate (the error plus its rate of change times LOOK_AHEAD_MS) until
+// that reaches FULL_CURVATURE.  These settings only slow the Zumo a little,
+// so it takes gentle curves about as fast as it would with no planner.  If
+// your Zumo still loses the line in the tightest curves of your course,
+// decrease MIN_SPEED or FULL_CURVATURE; if it is slow in gentle curves,
+// increase them.
+const int MIN_SPEED = 380;
+const unsigned int FULL_CURVATURE = 10000;
+const unsigned int LOOK_AHEAD_MS = 40;
+ZumoSpeedPlanner planner(MIN_SPEED, MAX_SPEED);
+
+// If the line is lost (for example, at a sharp corner), the recovery object
+// takes over the motors and spins toward the side the line was lost on, then
+// the other way, until it finds the line again.
+ZumoLineRecovery recovery;
+
 
 void setup()
 {
@@ -72,7 +104,12 @@ void setup()
 
   // Play music and wait for it to finish before we start driving.
   buzzer.play("L16 cdegreg4");
-  while(buzzer.isPlaying());
+  while(buzzer.isPlaying())
+    delay(1);
+
+  // Start out slowly and let the planner speed up from there.
+  planner.setCurvatureRange(FULL_CURVATURE, LOOK_AHEAD_MS);
+  planner.reset(MIN_SPEED);
 }
 
 void loop()
@@ -88,34 +125,31 @@ void loop()
   // corresponds to position 2500.
   int error = position - 2500;
 
-  // Get motor speed difference using proportional and derivative PID terms
-  // (the integral term is generally not very useful for line following).
-  // Here we are using a proportional constant of 1/4 and a derivative
-  // constant of 6, which should work decently for many Zumo motor choices.
-  // You probably want to use trial and error to tune these constants for
-  // your particular Zumo and line course.
-  int speedDifference = error / 4 + 6 * (error - lastError);
-
-  lastError = error;
-
-  // Get individual motor speeds.  The sign of speedDifference
-  // determines if the robot turns left or right.
-  int m1Speed = MAX_SPEED + speedDifference;
-  int m2Speed = MAX_SPEED - speedDifference;
-
-  // Here we constrain our motor speeds to be between 0 and MAX_SPEED.
-  // Generally speaking, one motor will always be turning at MAX_SPEED
-  // and the other will be at MAX_SPEED-|speedDifference| if that is positive,
-  // else it will be stationary.  For some applications, you might want to
-  // allow the motor speed to go negative so that it can spin in reverse.
-  if (m1Speed < 0)
-    m1Speed = 0;
-  if (m2Speed < 0)
-    m2Speed = 0;
-  if (m1Speed > MAX_SPEED)
-    m1Speed = MAX_SPEED;
-  if (m2Speed > MAX_SPEED)
-    m2Speed = MAX_SPEED;
-
-  motors.setSpeeds(m1Speed, m2Speed);
+  // If the line has been lost, let the recovery object search for it.  Once
+  // the line is found again, start over with a fresh PID controller and slow
+  // speed, since the old error history no longer applies.
+  if (recovery.update(error, sensors))
+  {
+    pid.reset();
+    planner.reset(MIN_SPEED);
+    return;
+  }
+
+  // Get the motor speed difference from the PID controller.  ZumoPID measures
+  // the time since the last update itself, so the derivative term stays the
+  // same if the loop gets faster or slower.
+  pid.update(error);
+
+  // Get the base speed from the speed planner.  It uses the sensor readings
+  // to slow down when it is not sure where the line is.
+  int speed = planner.update(error, sensors);
+
+  // Set the motor speeds: the left motor gets the base speed plus the speed
+  // difference and the right motor gets the base speed minus it, so its sign
+  // determines if the robot turns left or right.  Each speed is constrained
+  // to be between 0 and MAX_SPEED, so in a curve, the outer motor can speed
+  // up past the base speed while the inner one slows down.  For some
+  // applications, you might want to allow the motor speed to go negative so
+  // that it can spin in reverse.
+  pid.steer(speed, 0, MAX_SPEED);
 }
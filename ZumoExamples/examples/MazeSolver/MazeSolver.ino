@@ -3,10 +3,14 @@
 #include <ZumoMotors.h>
 #include <ZumoBuzzer.h>
 #include <Pushbutton.h>
+#include <ZumoPID.h>
+#include <ZumoLineTurn.h>
+#include <ZumoMazeMap.h>
+#include <ZumoIntersectionDetector.h>
 
 /* This example uses the Zumo Reflectance Sensor Array
- * to navigate a black line maze with no loops. This program
- * is based off the 3pi maze solving example which can be
+ * to navigate a black line maze, which may have loops. This
+ * program is based off the 3pi maze solving example which can be
  * found here:
  *
  * http://www.pololu.com/docs/0J21/8.a
@@ -18,16 +22,24 @@
  * In loop(), the function solveMaze() is called and navigates
  * the Zumo until it finds the finish line which is defined as
  * a large black area that is thick and wide enough to
- * cover all six sensors at the same time.
+ * cover all six sensors at the same time.  The Zumo should start
+ * at the end of a line, facing into the maze.  As it explores, it
+ * builds a map of the intersections and the segments between them
+ * with the ZumoMazeMap library.
  * 
  * Once the Zumo reaches the finishing line, it will stop and
  * wait for the user to place the Zumo back at the starting
  * line. The Zumo can then follow the shortest path to the finish
  * line.
  *
- * The macros SPEED, TURN_SPEED, ABOVE_LINE(), and LINE_THICKNESS 
- * might need to be adjusted on a case by case basis to give better 
- * line following results.
+ * While exploring, the Zumo also measures how long each segment
+ * takes to drive, so when it follows the shortest path it can drive
+ * the long segments at FAST_SPEED and slow down just before the
+ * next intersection.
+ *
+ * The macros SPEED, FAST_SPEED, TURN_SPEED, ABOVE_LINE(), 
+ * LINE_THICKNESS, and BRAKE_DISTANCE might need to be adjusted on a
+ * case by case basis to give better line following results.
  */
 
 // SENSOR_THRESHOLD is a value to compare reflectance sensor
@@ -40,8 +52,14 @@
 
 // Motor speed when turning. TURN_SPEED should always
 // have a positive value, otherwise the Zumo will turn
-// in the wrong direction.
-#define TURN_SPEED 200
+// in the wrong direction.  Turns slow down to MIN_TURN_SPEED
+// as the line reaches the center of the sensor array.
+#define TURN_SPEED 400
+#define MIN_TURN_SPEED 100
+
+// Motor speed when sweeping the sensors over the line to
+// calibrate them.
+#define CALIBRATION_SPEED 200
 
 // Motor speed when driving straight. SPEED should always
 // have a positive value, otherwise the Zumo will travel in the
@@ -51,34 +69,67 @@
 // Thickness of your line in inches
 #define LINE_THICKNESS .75 
 
-// When the motor speed of the zumo is set by
-// motors.setSpeeds(200,200), 200 is in ZUNITs/Second.
-// A ZUNIT is a fictitious measurement of distance
-// and only helps to approximate how far the Zumo has
-// traveled. Experimentally it was observed that for 
-// every inch, there were approximately 17142 ZUNITs.
-// This value will differ depending on setup/battery
-// life and may be adjusted accordingly. This value
-// was found using a 75:1 HP Motors with batteries
-// partially discharged.
-#define INCHES_TO_ZUNITS 17142.0
-
-// When the Zumo reaches the end of a segment it needs
-// to find out three things: if it has reached the finish line,
-// if there is a straight segment ahead of it, and which
-// segment to take. OVERSHOOT tells the Zumo how far it needs
-// to overshoot the segment to find out any of these things.
-#define OVERSHOOT(line_thickness)(((INCHES_TO_ZUNITS * (line_thickness)) / SPEED))
+// Distance from the sensor array to the Zumo's axle in inches.
+// The Zumo turns around its axle, so before a 90 degree turn it
+// drives on until the axle is over the intersection.  That way, it
+// is lined up with the new segment when the line is centered under
+// the sensors.
+#define AXLE_DISTANCE 0.45
+
+// Motor speed for the long straights when replaying the maze.
+#define FAST_SPEED 400
+
+// How far before the end of a segment (in inches) the Zumo slows
+// back down to SPEED when replaying the maze, so that it does not
+// overshoot the intersection.
+#define BRAKE_DISTANCE 1.0
+
+// When the Zumo reaches the end of a segment it needs to find out
+// three things: if it has reached the finish line, if there is a
+// straight segment ahead of it, and which segment to take.  It keeps
+// driving while the intersection detector watches the sensors, and
+// the detector decides once the outer sensors have passed the line.
+// The time that takes is also a measurement of the Zumo's speed.
+// CROSSING_TIME is the first estimate of that time, in milliseconds;
+// after that, the detector averages in what it measures.
+#define CROSSING_TIME 64
 
 ZumoBuzzer buzzer;
 ZumoReflectanceSensorArray reflectanceSensors;
 ZumoMotors motors;
 Pushbutton button(ZUMO_BUTTON);
 
-// path[] keeps a log of all the turns made
-// since starting the maze
-char path[100] = "";
-unsigned char path_length = 0; // the length of the path
+// Steering controller for following a segment: proportional only, with a
+// gain of 85/256 (about 1/3), and never more than SPEED in either direction.
+ZumoPID pid(85, 0, 0);
+
+// Turns in place onto the next segment.
+ZumoLineTurn lineTurn;
+
+// The map of the maze.  Segment lengths are measured in milliseconds
+// of driving at SPEED.
+ZumoMazeMap maze;
+
+// Two intersections that are closer together than this (in milliseconds
+// of driving at SPEED) in both directions are assumed to be the same one.
+// This should be less than half of the shortest segment in your maze, but
+// more than the error that builds up while driving around the maze.
+#define MATCH_DISTANCE 200
+
+// Classifies the end of each segment while the Zumo drives through it.
+// Distances are measured in milliseconds of driving at SPEED, like the
+// segment lengths in the map.
+ZumoIntersectionDetector intersection;
+
+// The Arduino environment generates these prototypes automatically, but
+// other compilers (like the one used with the host simulation in
+// ZumoHostSim) need them.
+void turn(char dir, unsigned char lines_to_pass);
+void driveToAxle();
+void followSegment(unsigned int fast_time);
+unsigned int fastTime(unsigned int segment_length);
+boolean solveMaze();
+void goToFinishLine();
 
 void setup()
 {
@@ -106,7 +157,7 @@ void setup()
     turn_direction *= -1;
 	
     // Turn direction.
-    motors.setSpeeds(turn_direction * TURN_SPEED, -1*turn_direction * TURN_SPEED);
+    motors.setSpeeds(turn_direction * CALIBRATION_SPEED, -1*turn_direction * CALIBRATION_SPEED);
       
     // This while loop monitors line position
     // until the turn is complete. 
@@ -134,8 +185,13 @@ void setup()
     last_status = 0;
   }
   
+  lineTurn.setSpeeds(TURN_SPEED, MIN_TURN_SPEED);
+  lineTurn.setLineSensors(6, SENSOR_THRESHOLD);
+  intersection.setThreshold(SENSOR_THRESHOLD);
+  intersection.setLineWidth(CROSSING_TIME);
+
   // Turn left.
-  turn('L');
+  turn('L', 0);
   
   motors.setSpeeds(0, 0);
   
@@ -152,7 +208,16 @@ void loop()
   // solveMaze() explores every segment
   // of the maze until it finds the finish
   // line.
-  solveMaze();
+  if(!solveMaze())
+  {
+    // There is no route to replay: the finish was not found, or the
+    // maze has more intersections than the map can hold.  Sound a
+    // descending tune, then explore again from the start when the
+    // user places the Zumo there and pushes the button.
+    buzzer.play("L8 c<g<<c");
+    button.waitForButton();
+    return;
+  }
   
   // Sound off buzzer to denote Zumo has solved the maze
   buzzer.play(">>a32");
@@ -173,15 +238,12 @@ void loop()
 
 // Turns according to the parameter dir, which should be 
 // 'L' (left), 'R' (right), 'S' (straight), or 'B' (back).
-void turn(char dir)
+// lines_to_pass is the number of lines the Zumo should turn
+// past before it stops on one.
+void turn(char dir, unsigned char lines_to_pass)
 {
-
-  // count and last_status help
-  // keep track of how much further
-  // the Zumo needs to turn.
-  unsigned short count = 0;
-  unsigned short last_status = 0;
   unsigned int sensors[6];
+  int position;
   
   // dir tests for which direction to turn
   switch(dir)
@@ -191,218 +253,182 @@ void turn(char dir)
   // we can treat a left turn the same as a direction reversal: they differ only 
   // in whether the zumo will turn 90 degrees or 180 degrees before seeing the 
   // line under the sensor. If 'B' is passed to the turn function when there is a
-  // left turn available, then the Zumo will turn onto the left segment.
+  // left turn available, then the Zumo will turn onto the left segment unless
+  // it is told to pass it.
     case 'L':
-	case 'B':
-      // Turn left.
-      motors.setSpeeds(-TURN_SPEED, TURN_SPEED);
-      
-      // This while loop monitors line position
-      // until the turn is complete. 
-      while(count < 2)
-      {
-        reflectanceSensors.readLine(sensors);
-		
-        // Increment count whenever the state of the sensor changes 
-		// (white->black and black->white) since the sensor should 
-		// pass over 1 line while the robot is turning, the final 
-		// count should be 2
-        count += ABOVE_LINE(sensors[1]) ^ last_status; 
-        last_status = ABOVE_LINE(sensors[1]);
-      }
-    
-    break;
+    case 'B':
+      lineTurn.start(-1, lines_to_pass);
+      break;
     
     case 'R':
-      // Turn right.
-      motors.setSpeeds(TURN_SPEED, -TURN_SPEED);
-      
-      // This while loop monitors line position
-      // until the turn is complete. 
-      while(count < 2)
-      {
-        reflectanceSensors.readLine(sensors);
-        count += ABOVE_LINE(sensors[4]) ^ last_status;
-        last_status = ABOVE_LINE(sensors[4]);
-      }
-    
-    break;
+      lineTurn.start(1, lines_to_pass);
+      break;
 	
     case 'S':
     // Don't do anything!
-    break;
+    return;
   }
+  
+  // Spin until the line is centered under the sensor array. 
+  // lineTurn slows down as it gets close, so that followSegment()
+  // does not have to swing the Zumo back to the line afterward.
+  do
+  {
+    position = reflectanceSensors.readLine(sensors);
+  }
+  while(!lineTurn.update(position - 2500, sensors));
 }
 
-// This function decides which way to turn during the learning phase of
-// maze solving.  It uses the variables found_left, found_straight, and
-// found_right, which indicate whether there is an exit in each of the
-// three directions, applying the "left hand on the wall" strategy.
-char selectTurn(unsigned char found_left, unsigned char found_straight,
-  unsigned char found_right)
+// Drives straight ahead from where the intersection detector
+// decided what kind of intersection it is (with the sensors just past
+// the line) until the axle is over the middle of the line.
+void driveToAxle()
 {
-  // Make a decision about how to turn.  The following code
-  // implements a left-hand-on-the-wall strategy, where we always
-  // turn as far to the left as possible.
-  if(found_left)
-    return 'L';
-  else if(found_straight)
-    return 'S';
-  else if(found_right)
-    return 'R';
-  else
-    return 'B';
+  unsigned int line_width = intersection.getLineWidth();
+  
+  motors.setSpeeds(SPEED, SPEED);
+  delay(AXLE_DISTANCE / LINE_THICKNESS * line_width - line_width / 2);
 }
 
 // The maze is broken down into segments. Once the Zumo decides
 // which segment to turn on, it will navigate until it finds another
 // intersection. followSegment() will then return after the
-// intersection is found.
-void followSegment()
+// intersection detector has classified what is at the end of the
+// segment.  For the first fast_time milliseconds, the Zumo drives at
+// FAST_SPEED instead of SPEED.
+void followSegment(unsigned int fast_time)
 {
   unsigned int position;
   unsigned int sensors[6];
   int offset_from_center;
-  int power_difference;
+  int speed = fast_time ? FAST_SPEED : SPEED;
+  unsigned long start = millis();
+  unsigned long last_time = start;
   
+  // The distance traveled, in milliseconds of driving at SPEED
+  // times SPEED.
+  unsigned long distance = 0;
+
+  pid.setOutputLimits(-speed, speed);
+  pid.reset();
+  intersection.reset();
+
   while(1)
   {     
+    // Slow down when the fast part of the segment is over, or if we
+    // reach an intersection before then.
+    if(speed != SPEED && (millis() - start >= fast_time || intersection.isCrossing()))
+    {
+      speed = SPEED;
+      pid.setOutputLimits(-speed, speed);
+    }
+
     // Get the position of the line.
     position = reflectanceSensors.readLine(sensors);
+    
+    unsigned long now = millis();
+    distance += (now - last_time) * speed;
+    last_time = now;
+    
+    // We use the inner four sensors (1, 2, 3, and 4) for
+    // determining whether there is a line straight ahead, and the
+    // sensors 0 and 5 for detecting lines going to the left and
+    // right.  The detector looks at them on every reading and
+    // tells us when it has seen enough.
+    if(intersection.update(sensors, distance / SPEED))
+      return;
+    
+    if(intersection.isCrossing())
+    {
+      // The line position means nothing while we are crossing an
+      // intersection or have lost the line, so drive straight.
+      motors.setSpeeds(SPEED, SPEED);
+      continue;
+    }
      
     // The offset_from_center should be 0 when we are on the line.
     offset_from_center = ((int)position) - 2500;
      
     // Compute the difference between the two motor power settings,
     // m1 - m2.  If this is a positive number the robot will turn
-    // to the left.  If it is a negative number, the robot will
-    // turn to the right, and the magnitude of the number determines
+    // to the right.  If it is a negative number, the robot will
+    // turn to the left, and the magnitude of the number determines
     // the sharpness of the turn.
-    power_difference = offset_from_center / 3;
-     
-    // Compute the actual motor settings.  We never set either motor
-    // to a negative value.
-    if(power_difference > SPEED)
-      power_difference = SPEED;
-    if(power_difference < -SPEED)
-      power_difference = -SPEED;
-     
-    if(power_difference < 0)
-      motors.setSpeeds(SPEED + power_difference, SPEED);
-    else
-      motors.setSpeeds(SPEED, SPEED - power_difference);
+    pid.update(offset_from_center);
      
-    // We use the inner four sensors (1, 2, 3, and 4) for
-    // determining whether there is a line straight ahead, and the
-    // sensors 0 and 5 for detecting lines going to the left and
-    // right.
-     
-    if(!ABOVE_LINE(sensors[0]) && !ABOVE_LINE(sensors[1]) && !ABOVE_LINE(sensors[2]) && !ABOVE_LINE(sensors[3]) && !ABOVE_LINE(sensors[4]) && !ABOVE_LINE(sensors[5]))
-    {
-      // There is no line visible ahead, and we didn't see any
-      // intersection.  Must be a dead end.            
-      return;
-    }
-    else if(ABOVE_LINE(sensors[0]) || ABOVE_LINE(sensors[5]))
-    {
-      // Found an intersection.
-      return;
-    }
-   
+    // Set the motor speeds: the outer motor runs at speed and the inner
+    // one is slowed down by the power difference.  We never set either
+    // motor to a negative value.
+    pid.steer(speed, 0, speed);
   }
 }
 
-// The solveMaze() function works by applying a "left hand on the wall" strategy: 
-// the robot follows a segment until it reaches an intersection, where it takes the 
-// leftmost fork available to it. It records each turn it makes, and as long as the 
-// maze has no loops, this strategy will eventually lead it to the finish. Afterwards, 
-// the recorded path is simplified by removing dead ends. More information can be 
-// found in the 3pi maze solving example.
-void solveMaze()
+// The solveMaze() function works by exploring the maze one segment at a time:
+// the robot follows a segment until it reaches an intersection, records the
+// intersection and the length of the segment in the map, and then takes the
+// leftmost exit it has not explored yet.  If all of the exits of an intersection
+// have been explored, it heads back to the closest intersection that still has
+// an unexplored exit.  Without loops, this is the same as the "left hand on the
+// wall" strategy from the 3pi maze solving example, but the map also recognizes
+// intersections it has already been to, so it does not go around loops forever.
+// Returns false if there is no route to the finish to replay.
+boolean solveMaze()
 {
+    maze.reset();
+    maze.setMatchDistance(MATCH_DISTANCE);
+
     while(1)
     {
-        // Navigate current line segment
-        followSegment();
-         
-        // These variables record whether the robot has seen a line to the
-        // left, straight ahead, and right, while examining the current
-        // intersection.
-        unsigned char found_left = 0;
-        unsigned char found_straight = 0;
-        unsigned char found_right = 0;
+        // Navigate current line segment.  The intersection detector
+        // measures how long it takes and what is at the end of it.
+        followSegment(0);
+        unsigned int segment_length = intersection.getSegmentLength();
          
-        // Now read the sensors and check the intersection type.
-        unsigned int sensors[6];
-        reflectanceSensors.readLine(sensors);
-         
-        // Check for left and right exits.
-        if(ABOVE_LINE(sensors[0]))
-            found_left = 1;
-        if(ABOVE_LINE(sensors[5]))
-            found_right = 1;
-            
-        // Drive straight a bit more, until we are
-        // approximately in the middle of intersection.
-        // This should help us better detect if we
-        // have left or right segments.
-        motors.setSpeeds(SPEED, SPEED);
-        delay(OVERSHOOT(LINE_THICKNESS)/2);
-        
-        reflectanceSensors.readLine(sensors);
-         
-        // Check for left and right exits.
-        if(ABOVE_LINE(sensors[0]))
-            found_left = 1;
-        if(ABOVE_LINE(sensors[5]))
-            found_right = 1;
-        
-        // After driving a little further, we
-        // should have passed the intersection
-        // and can check to see if we've hit the
-        // finish line or if there is a straight segment
-        // ahead.   
-        delay(OVERSHOOT(LINE_THICKNESS)/2);
-        
-        // Check for a straight exit.
-        reflectanceSensors.readLine(sensors);
-        
-        // Check again to see if left or right segment has been found
-        if(ABOVE_LINE(sensors[0]))
-            found_left = 1;
-        if(ABOVE_LINE(sensors[5]))
-            found_right = 1;
-        
-        if(ABOVE_LINE(sensors[1]) || ABOVE_LINE(sensors[2]) || ABOVE_LINE(sensors[3]) || ABOVE_LINE(sensors[4]))
-            found_straight = 1;
-         
-        // Check for the ending spot.
-        // If all four middle sensors are on dark black, we have
+        // Check for the ending spot: a patch of black wide enough to
+        // cover all four middle sensors.  If we have found it, we have
         // solved the maze.
-        if(ABOVE_LINE(sensors[1]) && ABOVE_LINE(sensors[2]) && ABOVE_LINE(sensors[3]) && ABOVE_LINE(sensors[4]))
+        if(intersection.isFinish())
         {
           motors.setSpeeds(0,0);
+          maze.arriveAtFinish(segment_length);
           break;
         }
          
-        // Intersection identification is complete.
-        unsigned char dir = selectTurn(found_left, found_straight, found_right);
+        // Intersection identification is complete.  If the map runs out of
+        // room, selectTurn() falls back to the left hand on the wall strategy.
+        maze.arrive(segment_length, intersection.foundLeft(), intersection.foundStraight(), intersection.foundRight());
+        char dir = maze.selectTurn();
+        if(dir == 0)
+        {
+          // Every exit we can get to has been explored, but we did not
+          // find the finish.
+          motors.setSpeeds(0,0);
+          break;
+        }
         
-        // Make the turn indicated by the path.
-		turn(dir);
-         
-        // Store the intersection in the path variable.
-        path[path_length] = dir;
-        path_length++;
-         
-        // You should check to make sure that the path_length does not
-        // exceed the bounds of the array.  We'll ignore that in this
-        // example.
-         
-        // Simplify the learned path.
-        simplifyPath();
-         
+        // Make the turn.  turn('B') stops at the first line to the left, so
+        // to turn around at an intersection with a left exit, we have to
+        // turn past it.
+        if(dir == 'L' || dir == 'R')
+          driveToAxle();
+        turn(dir, dir == 'B' && intersection.foundLeft() ? 1 : 0);
+        maze.turn(dir);
     }
+
+    // Find the shortest route through the explored part of the maze.
+    // This fails if the finish was not found, or if the map ran out of
+    // room for it (see ZUMO_MAZE_MAX_NODES).
+    return maze.findRoute();
+}
+
+// Returns how long to drive at FAST_SPEED on a segment that took
+// segment_length milliseconds to drive at SPEED.
+unsigned int fastTime(unsigned int segment_length)
+{
+  unsigned int brake_time = BRAKE_DISTANCE / LINE_THICKNESS * intersection.getLineWidth();
+  if(segment_length <= brake_time)
+    return 0;
+  return (unsigned long)(segment_length - brake_time) * SPEED / FAST_SPEED;
 }
 
 // Now enter an infinite loop - we can re-run the maze as many
@@ -410,31 +436,25 @@ void solveMaze()
 void goToFinishLine()
 {
   unsigned int sensors[6];
-  int i = 0;
+  unsigned char i;
 
-  // Turn around if the Zumo is facing the wrong direction.
-  if(path[0] == 'B')
+  for(i = 0; i <= maze.getRouteLength(); i++)
   {
-    turn('B');
-    i++;
-  }
-  
-  for(;i<path_length;i++)
-  {
-
-    followSegment();
-                  
-    // Drive through the intersection. 
-    motors.setSpeeds(SPEED, SPEED);
-    delay(OVERSHOOT(LINE_THICKNESS));
+    // Drive the segment at FAST_SPEED, slowing down to SPEED in time
+    // to cover the last BRAKE_DISTANCE inches before the next
+    // intersection at the speed we measured it at.  followSegment()
+    // returns once we have driven through the intersection.
+    followSegment(fastTime(maze.getRouteSegmentLength(i)));
+    
+    // The last segment ends at the finish.
+    if(i == maze.getRouteLength())
+      break;
                    
-    // Make a turn according to the instruction stored in
-    // path[i].
-    turn(path[i]);
+    // Make a turn according to the route found in the map.
+    if(maze.getRouteTurn(i) != 'S')
+      driveToAxle();
+    turn(maze.getRouteTurn(i), 0);
   }
-    
-  // Follow the last segment up to the finish.
-  followSegment();
  
   // The finish line has been reached.
   // Return and wait for another button push to
@@ -444,56 +464,3 @@ void goToFinishLine()
   
   return; 
 } 
-
-
-// simplifyPath analyzes the path[] array and reduces all the
-// turns. For example: Right turn + Right turn = (1) Back turn.
-void simplifyPath()
-{
-  
-  // only simplify the path if the second-to-last turn was a 'B'
-  if(path_length < 3 || path[path_length - 2] != 'B')
-  return;
-   
-  int total_angle = 0;
-  int i;
-  
-  for(i = 1; i <= 3; i++)
-  {
-    switch(path[path_length - i])
-    {
-      case 'R':
-        total_angle += 90;
-        break;
-      case 'L':
-        total_angle += 270;
-        break;
-      case 'B':
-        total_angle += 180;
-        break;
-    }
-  }
-   
-  // Get the angle as a number between 0 and 360 degrees.
-  total_angle = total_angle % 360;
-   
-  // Replace all of those turns with a single one.
-  switch(total_angle)
-  {
-    case 0:
-      path[path_length - 3] = 'S';
-      break;
-    case 90:
-      path[path_length - 3] = 'R';
-      break;
-    case 180:
-      path[path_length - 3] = 'B';
-      break;
-    case 270:
-      path[path_length - 3] = 'L';
-      break;
-  }
-   
-  // The path is now two steps shorter.
-  path_length -= 2;
-}
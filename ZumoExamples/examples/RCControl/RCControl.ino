@@ -24,7 +24,7 @@ void loop()
   int throttle = pulseIn(THROTTLE_PIN, HIGH);
   int steering = pulseIn(STEERING_PIN, HIGH);
 
-  int left_speed, right_speed;
+  int speed, turn_rate;
 
   if (throttle > 0 && steering > 0)
   {
@@ -41,22 +41,21 @@ void loop()
     if (abs(steering) <= PULSE_WIDTH_DEADBAND)
       steering = 0;
 
-    // mix throttle and steering inputs to obtain left & right motor speeds
-    left_speed = ((long)throttle * MAX_SPEED / PULSE_WIDTH_RANGE) - ((long)steering * MAX_SPEED / PULSE_WIDTH_RANGE);
-    right_speed = ((long)throttle * MAX_SPEED / PULSE_WIDTH_RANGE) + ((long)steering * MAX_SPEED / PULSE_WIDTH_RANGE);
-
-    // cap speeds to max
-    left_speed = min(max(left_speed, -MAX_SPEED), MAX_SPEED);
-    right_speed = min(max(right_speed, -MAX_SPEED), MAX_SPEED);
+    // scale throttle and steering inputs to forward speed and turn rate
+    speed = (long)throttle * MAX_SPEED / PULSE_WIDTH_RANGE;
+    turn_rate = (long)steering * MAX_SPEED / PULSE_WIDTH_RANGE;
   }
   else
   {
     // at least one RC signal is not good; turn off LED and stop motors
     digitalWrite(LED_PIN, LOW);
 
-    left_speed = 0;
-    right_speed = 0;
+    speed = 0;
+    turn_rate = 0;
   }
 
-  ZumoMotors::setSpeeds(left_speed, right_speed);
+  // mix forward speed and turn rate into left & right motor speeds; when a
+  // motor would exceed the maximum, forward speed is reduced so that full
+  // steering is still available
+  ZumoMotors::setVelocity(speed, turn_rate);
 }
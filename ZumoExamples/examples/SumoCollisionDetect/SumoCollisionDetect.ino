@@ -3,36 +3,37 @@
 #include <Pushbutton.h>
 #include <QTRSensors.h>
 #include <ZumoReflectanceSensorArray.h>
+#include <ZumoFilters.h>
+#include <ZumoCollisionDetector.h>
+#include <ZumoAccelFifo.h>
 #include <avr/pgmspace.h>
 #include <Wire.h>
-#include <LSM303.h>
 
-/* This example uses the accelerometer in the Zumo Shield's onboard LSM303DLHC with the LSM303 Library to 
- * detect contact with an adversary robot in the sumo ring. The LSM303 Library is not included in the Zumo 
- * Shield libraries; it can be downloaded separately from GitHub at: 
- *
- *    https://github.com/pololu/LSM303 
+/* This example uses the accelerometer in the Zumo Shield's onboard LSM303 to detect contact with an
+ * adversary robot in the sumo ring.
  *
  * This example extends the BorderDetect example, which makes use of the onboard Zumo Reflectance Sensor Array
  * and its associated library to detect the border of the sumo ring.  It also illustrates the use of the 
  * ZumoMotors, PushButton, and ZumoBuzzer libraries.
  *
- * In loop(), the program reads the x and y components of acceleration (ignoring z), and detects a
- * contact when the magnitude of the 3-period average of the x-y vector exceeds an empirically determined
- * XY_ACCELERATION_THRESHOLD.  On contact detection, the forward speed is increased to FULL_SPEED from
- * the default SEARCH_SPEED, simulating a "fight or flight" response.
+ * The accelerometer stores its readings in its FIFO, and on each pass through loop(), the program reads
+ * all of the readings taken since the last pass with ZumoAccelFifo and passes them to a
+ * ZumoCollisionDetector, so even a short jolt between two passes is seen.  The detector high-pass filters
+ * the x and y components of acceleration (ignoring z) and detects a contact when the magnitude of the
+ * filtered x-y vector exceeds an empirically determined XY_ACCELERATION_THRESHOLD.  On contact detection,
+ * the forward speed is increased to FULL_SPEED from the default SEARCH_SPEED, simulating a "fight or
+ * flight" response.
  *
- * The program attempts to detect contact only when the Zumo is going straight.  When it is executing a
- * turn at the sumo ring border, the turn itself generates an acceleration in the x-y plane, so the 
- * acceleration reading at that time is difficult to interpret for contact detection.  Since the Zumo also 
- * accelerates forward out of a turn, the acceleration readings are also ignored for MIN_DELAY_AFTER_TURN 
- * milliseconds after completing a turn. To further avoid false positives, a MIN_DELAY_BETWEEN_CONTACTS is 
- * also specified.
+ * When the Zumo is executing a turn at the sumo ring border, or accelerating forward out of one, its own
+ * acceleration is difficult to tell apart from a contact.  Every time the program sets the motor speeds,
+ * it also tells the detector, which ignores the readings until the Zumo should be driving straight at
+ * a steady speed again.  To further avoid false positives, a MIN_DELAY_BETWEEN_CONTACTS is also specified.
  *
  * This example also contains the following enhancements:
  * 
  *  - uses the Zumo Buzzer library to play a sound effect ("charge" melody) at start of competition and 
- *    whenever contact is made with an opposing robot
+ *    whenever contact is made with an opposing robot; a quiet search tune plays in the background at a
+ *    lower priority, so the sound effect interrupts it and the tune resumes afterward
  *
  *  - randomizes the turn angle on border detection, so that the Zumo executes a more effective search pattern
  *
@@ -40,10 +41,10 @@
  *    period of forward movement at FULL_SPEED.  In the example, both speeds are set to 400 (max), but this 
  *    feature may be useful to prevent runoffs at the turns if the sumo ring surface is unusually smooth.
  *
- *  - logging of accelerometer output to the serial monitor when LOG_SERIAL is #defined.
- *
- *  This example also makes use of the public domain RunningAverage library from the Arduino website; the relevant
- *  code has been copied into this .ino file and does not need to be downloaded separately.
+ *  - logging of accelerometer output to the serial monitor (at 115200 baud) when LOG_SERIAL is #defined.
+ *    Each reading is printed as a line with its x and y components and the motor speeds, and everything
+ *    else on lines starting with '#', so a log can be replayed through ZumoCollisionDetector on a
+ *    computer (see the Host Simulation section of the README).
  */
 
 // #define LOG_SERIAL // write log output to serial port
@@ -52,8 +53,12 @@
 Pushbutton button(ZUMO_BUTTON); // pushbutton on pin 12
 
 // Accelerometer Settings
-#define RA_SIZE 3  // number of readings to include in running average of accelerometer readings
-#define XY_ACCELERATION_THRESHOLD 2400  // for detection of contact (~16000 = magnitude of acceleration due to gravity)
+#define ACCEL_RATE 200  // Hz
+#define XY_ACCELERATION_THRESHOLD 150  // for detection of contact (~1000 = magnitude of acceleration due to gravity)
+ZumoAccelFifo accel;
+ZumoCollisionDetector collisionDetector;
+ZumoAccelSample accel_samples[32];
+boolean contact_detected;  // set when the detector sees a collision; cleared when the loop checks it
 
 // Reflectance Sensor Settings
 #define NUM_SENSORS 6
@@ -64,6 +69,7 @@ ZumoReflectanceSensorArray sensors(QTR_NO_EMITTER_PIN);
 
 // Motor Settings
 ZumoMotors motors;
+int left_speed, right_speed;  // the speeds last set with setSpeeds()
 
 // these might need to be tuned for different motor types
 #define REVERSE_SPEED     200 // 0 is stopped, 400 is full speed
@@ -87,68 +93,15 @@ unsigned long full_speed_start_time;
 ZumoBuzzer buzzer;
 const char sound_effect[] PROGMEM = "O4 T100 V15 L4 MS g12>c12>e12>G6>E12 ML>G2"; // "charge" melody
  // use V0 to suppress sound effect; v15 for max volume
+const char search_music[] PROGMEM = "O3 T120 V6 L8 MS cege cege dfaf dfaf"; // background tune
+#define SEARCH_MUSIC_PRIORITY  0
+#define SOUND_EFFECT_PRIORITY  1
  
  // Timing
 unsigned long loop_start_time;
-unsigned long last_turn_time;
 unsigned long contact_made_time;
-#define MIN_DELAY_AFTER_TURN          400  // ms = min delay before detecting contact event
 #define MIN_DELAY_BETWEEN_CONTACTS   1000  // ms = min delay between detecting new contact event
 
-// RunningAverage class 
-// based on RunningAverage library for Arduino
-// source:  http://playground.arduino.cc/Main/RunningAverage
-template <typename T> 
-class RunningAverage
-{
-  public:
-    RunningAverage(void);
-    RunningAverage(int);
-    ~RunningAverage();
-    void clear();
-    void addValue(T);
-    T getAverage() const;
-    void fillValue(T, int);
-  protected:
-    int _size;
-    int _cnt;
-    int _idx;
-    T _sum;
-    T * _ar;
-    static T zero;
-};
-
-// Accelerometer Class -- extends the LSM303 Library to support reading and averaging the x-y acceleration 
-//   vectors from the onboard LSM303DLHC accelerometer/magnetometer
-class Accelerometer : public LSM303
-{
-  typedef struct acc_data_xy
-  {
-    unsigned long timestamp;
-    int x;
-    int y;
-    float dir;
-  } acc_data_xy;
-  
-  public: 
-    Accelerometer() : ra_x(RA_SIZE), ra_y(RA_SIZE) {};
-    ~Accelerometer() {};
-    void enable(void);
-    void getLogHeader(void);
-    void readAcceleration(unsigned long timestamp);
-    float len_xy() const;
-    float dir_xy() const;
-    int x_avg(void) const;
-    int y_avg(void) const;
-    long ss_xy_avg(void) const;
-    float dir_xy_avg(void) const;
-  private:
-    acc_data_xy last;
-    RunningAverage<int> ra_x;
-    RunningAverage<int> ra_y;   
-};
-
-Accelerometer lsm303;
 boolean in_contact;  // set when accelerometer detects contact with opposing robot
 
 // forward declaration
@@ -159,13 +112,14 @@ void setup()
   // Initiate the Wire library and join the I2C bus as a master
   Wire.begin();
   
-  // Initiate LSM303
-  lsm303.init();
-  lsm303.enable();
+  // Initiate the accelerometer and the collision detector
+  accel.init(ACCEL_RATE);
+  collisionDetector.setSampleRate(ACCEL_RATE);
+  collisionDetector.setThreshold(XY_ACCELERATION_THRESHOLD, 2);
   
 #ifdef LOG_SERIAL
-  Serial.begin(9600);
-  lsm303.getLogHeader();
+  Serial.begin(115200);
+  Serial.println("# x,y,left,right");
 #endif
 
   randomSeed((unsigned int) millis());
@@ -182,12 +136,15 @@ void setup()
 void waitForButtonAndCountDown(bool restarting)
 { 
 #ifdef LOG_SERIAL
-  Serial.print(restarting ? "Restarting Countdown" : "Starting Countdown");
+  Serial.print(restarting ? "# Restarting Countdown" : "# Starting Countdown");
   Serial.println();
 #endif
   
   digitalWrite(LED, HIGH);
-  button.waitForButton();
+  // sleep until the button is pushed to save battery power while waiting;
+  // idle mode keeps the buzzer and serial port running in case the sound
+  // effect or log output is still in progress
+  button.waitForButtonSleep(PUSHBUTTON_SLEEP_IDLE);
   digitalWrite(LED, LOW);
    
   // play audible countdown
@@ -197,13 +154,19 @@ void waitForButtonAndCountDown(bool restarting)
     buzzer.playNote(NOTE_G(3), 50, 12);
   }
   delay(1000);
-  buzzer.playFromProgramSpace(sound_effect);
+  buzzer.playQueuedFromProgramSpace(sound_effect, SOUND_EFFECT_PRIORITY);
   delay(1000);
   
+  // throw away the readings taken while waiting; the detector knows the
+  // motors are stopped, so it will ignore the readings while the Zumo
+  // accelerates to its search speed
+  while (accel.read(accel_samples, 32) > 0);
+  collisionDetector.reset();
+
   // reset loop variables
   in_contact = false;  // 1 if contact made; 0 if no contact or contact lost
+  contact_detected = false;
   contact_made_time = 0;
-  last_turn_time = millis();  // prevents false contact detection on initial acceleration
   _forwardSpeed = SearchSpeed;
   full_speed_start_time = 0;
 }
@@ -213,13 +176,19 @@ void loop()
   if (button.isPressed())
   {
     // if button is pressed, stop and wait for another press to go again
-    motors.setSpeeds(0, 0);
+    setSpeeds(0, 0);
+    buzzer.stopPlaying();
     button.waitForRelease();
     waitForButtonAndCountDown(true);
   }
   
+  // keep the search tune going; queueing never blocks, and the tune waits
+  // for any sound effect that is still playing
+  if (!buzzer.isPlaying())
+    buzzer.playQueuedFromProgramSpace(search_music, SEARCH_MUSIC_PRIORITY);
+
   loop_start_time = millis();
-  lsm303.readAcceleration(loop_start_time); 
+  readAccelerometer();
   sensors.read(sensor_values);
   
   if ((_forwardSpeed == FullSpeed) && (loop_start_time - full_speed_start_time > FULL_SPEED_DURATION_LIMIT))
@@ -241,7 +210,7 @@ void loop()
   {
     if (check_for_contact()) on_contact_made();
     int speed = getForwardSpeed();
-    motors.setSpeeds(speed, speed);
+    setSpeeds(speed, speed);
   }
 }
 
@@ -251,7 +220,7 @@ void loop()
 void turn(char direction, bool randomize)
 {
 #ifdef LOG_SERIAL
-  Serial.print("turning ...");
+  Serial.print("# turning ...");
   Serial.println();
 #endif
 
@@ -262,13 +231,52 @@ void turn(char direction, bool randomize)
   
   // motors.setSpeeds(0,0);
   // delay(STOP_DURATION);
-  motors.setSpeeds(-REVERSE_SPEED, -REVERSE_SPEED);
-  delay(REVERSE_DURATION);
-  motors.setSpeeds(TURN_SPEED * direction, -TURN_SPEED * direction);
-  delay(randomize ? TURN_DURATION + (random(8) - 2) * duration_increment : TURN_DURATION);
+  setSpeeds(-REVERSE_SPEED, -REVERSE_SPEED);
+  waitAndReadAccelerometer(REVERSE_DURATION);
+  setSpeeds(TURN_SPEED * direction, -TURN_SPEED * direction);
+  waitAndReadAccelerometer(randomize ? TURN_DURATION + (random(8) - 2) * duration_increment : TURN_DURATION);
   int speed = getForwardSpeed();
-  motors.setSpeeds(speed, speed);
-  last_turn_time = millis();
+  setSpeeds(speed, speed);
+}
+
+// set the motor speeds and tell the collision detector about them
+void setSpeeds(int left, int right)
+{
+  motors.setSpeeds(left, right);
+  collisionDetector.setMotorSpeeds(left, right);
+  left_speed = left;
+  right_speed = right;
+}
+
+// read all of the accelerometer readings taken since the last call and
+// pass them to the collision detector
+void readAccelerometer()
+{
+  unsigned char count = accel.read(accel_samples, 32);
+  for (unsigned char i = 0; i < count; i++)
+  {
+    if (collisionDetector.update(accel_samples[i].x, accel_samples[i].y))
+      contact_detected = true;
+
+#ifdef LOG_SERIAL
+    Serial.print(accel_samples[i].x);
+    Serial.print(',');
+    Serial.print(accel_samples[i].y);
+    Serial.print(',');
+    Serial.print(left_speed);
+    Serial.print(',');
+    Serial.println(right_speed);
+#endif
+  }
+}
+
+// delay() that keeps reading the accelerometer, so that the collision
+// detector sees the readings taken while the Zumo turns
+void waitAndReadAccelerometer(unsigned int ms)
+{
+  unsigned long start = millis();
+  while (millis() - start < ms)
+    readAccelerometer();
 }
 
 void setForwardSpeed(ForwardSpeed speed)
@@ -295,186 +303,36 @@ int getForwardSpeed()
   return speed;
 }
   
-// check for contact, but ignore readings immediately after turning or losing contact
+// check for contact seen by the collision detector since the last check, but
+// ignore it immediately after making contact
 bool check_for_contact()
 {
-  static long threshold_squared = (long) XY_ACCELERATION_THRESHOLD * (long) XY_ACCELERATION_THRESHOLD;
-  return (lsm303.ss_xy_avg() >  threshold_squared) && \
-    (loop_start_time - last_turn_time > MIN_DELAY_AFTER_TURN) && \
-    (loop_start_time - contact_made_time > MIN_DELAY_BETWEEN_CONTACTS);
+  bool detected = contact_detected;
+  contact_detected = false;
+  return detected && (loop_start_time - contact_made_time > MIN_DELAY_BETWEEN_CONTACTS);
 }
 
 // sound horn and accelerate on contact -- fight or flight
 void on_contact_made()
 {
 #ifdef LOG_SERIAL
-  Serial.print("contact made");
+  Serial.print("# contact made");
   Serial.println();
 #endif
   in_contact = true;
   contact_made_time = loop_start_time;
   setForwardSpeed(FullSpeed);
-  buzzer.playFromProgramSpace(sound_effect);
+  // interrupts the search tune, which resumes when the effect is done
+  buzzer.playQueuedFromProgramSpace(sound_effect, SOUND_EFFECT_PRIORITY);
 }
 
 // reset forward speed
 void on_contact_lost()
 {
 #ifdef LOG_SERIAL
-  Serial.print("contact lost");
+  Serial.print("# contact lost");
   Serial.println();
 #endif
   in_contact = false;
   setForwardSpeed(SearchSpeed);
 }
-
-// class Accelerometer -- member function definitions
-
-// enable accelerometer only
-// to enable both accelerometer and magnetometer, call enableDefault() instead
-void Accelerometer::enable(void)
-{
-  // Enable Accelerometer
-  // 0x27 = 0b00100111
-  // Normal power mode, all axes enabled
-  writeAccReg(LSM303::CTRL_REG1_A, 0x27);
-
-  if (getDeviceType() == LSM303::device_DLHC)
-  writeAccReg(LSM303::CTRL_REG4_A, 0x08); // DLHC: enable high resolution mode
-}
-
-void Accelerometer::getLogHeader(void)
-{
-  Serial.print("millis    x      y     len     dir  | len_avg  dir_avg  |  avg_len");
-  Serial.println();
-}
-
-void Accelerometer::readAcceleration(unsigned long timestamp)
-{
-  readAcc();
-  if (a.x == last.x && a.y == last.y) return;
-  
-  last.timestamp = timestamp;
-  last.x = a.x;
-  last.y = a.y;
-  
-  ra_x.addValue(last.x);
-  ra_y.addValue(last.y);
- 
-#ifdef LOG_SERIAL
- Serial.print(last.timestamp);
- Serial.print("  ");
- Serial.print(last.x);
- Serial.print("  ");
- Serial.print(last.y);
- Serial.print("  ");
- Serial.print(len_xy());
- Serial.print("  ");
- Serial.print(dir_xy());
- Serial.print("  |  ");
- Serial.print(sqrt(static_cast<float>(ss_xy_avg())));
- Serial.print("  ");
- Serial.print(dir_xy_avg());
- Serial.println();
-#endif
-}
-
-float Accelerometer::len_xy() const
-{
-  return sqrt(last.x*a.x + last.y*a.y);
-}
-
-float Accelerometer::dir_xy() const
-{
-  return atan2(last.x, last.y) * 180.0 / M_PI;
-}
-
-int Accelerometer::x_avg(void) const
-{
-  return ra_x.getAverage();
-}
-
-int Accelerometer::y_avg(void) const
-{
-  return ra_y.getAverage();
-}
-
-long Accelerometer::ss_xy_avg(void) const
-{
-  long x_avg_long = static_cast<long>(x_avg());
-  long y_avg_long = static_cast<long>(y_avg()); 
-  return x_avg_long*x_avg_long + y_avg_long*y_avg_long;
-}
-
-float Accelerometer::dir_xy_avg(void) const
-{
-  return atan2(static_cast<float>(x_avg()), static_cast<float>(y_avg())) * 180.0 / M_PI;
-}
-
-
-
-// RunningAverage class 
-// based on RunningAverage library for Arduino
-// source:  http://playground.arduino.cc/Main/RunningAverage
-// author:  Rob.Tillart@gmail.com
-// Released to the public domain
-
-template <typename T>
-T RunningAverage<T>::zero = static_cast<T>(0);
-
-template <typename T>
-RunningAverage<T>::RunningAverage(int n)
-{
-  _size = n;
-  _ar = (T*) malloc(_size * sizeof(T));
-  clear();
-}
-
-template <typename T>
-RunningAverage<T>::~RunningAverage()
-{
-  free(_ar);
-}
-
-// resets all counters
-template <typename T>
-void RunningAverage<T>::clear() 
-{ 
-  _cnt = 0;
-  _idx = 0;
-  _sum = zero;
-  for (int i = 0; i< _size; i++) _ar[i] = zero;  // needed to keep addValue simple
-}
-
-// adds a new value to the data-set
-template <typename T>
-void RunningAverage<T>::addValue(T f)
-{
-  _sum -= _ar[_idx];
-  _ar[_idx] = f;
-  _sum += _ar[_idx];
-  _idx++;
-  if (_idx == _size) _idx = 0;  // faster than %
-  if (_cnt < _size) _cnt++;
-}
-
-// returns the average of the data-set added so far
-template <typename T>
-T RunningAverage<T>::getAverage() const
-{
-  if (_cnt == 0) return zero; // NaN ?  math.h
-  return _sum / _cnt;
-}
-
-// fill the average with a value
-// the param number determines how often value is added (weight)
-// number should preferably be between 1 and size
-template <typename T>
-void RunningAverage<T>::fillValue(T value, int number)
-{
-  clear();
-  for (int i = 0; i < number; i++) 
-  {
-    addValue(value);
-  }
-}
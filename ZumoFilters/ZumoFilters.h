@@ -0,0 +1,370 @@
+/*! \file ZumoFilters.h
+ *
+ * \brief Fixed-size filters for smoothing sensor readings
+ *
+ * ZumoFilters provides four filters for streams of sensor readings, such as
+ * accelerometer readings, reflectance sensor values, or RC pulse widths:
+ *
+ * - ZumoMovingAverage: the average of the last 2^SHIFT samples
+ * - ZumoEMA: an exponential moving average
+ * - ZumoBiquad: a second-order low-pass or high-pass filter
+ * - ZumoMedian: the median of the last N samples, which removes single
+ *   spikes (for example, a glitched RC pulse) instead of averaging them in
+ *
+ * They are templates defined entirely in this header, so there is nothing
+ * to compile unless they are used.  The number of samples each one stores
+ * is a template parameter, so all of its storage is inside the object and
+ * none of them use `malloc()`; a filter uses the RAM for its samples plus a
+ * few bytes.  Only integer arithmetic is used while filtering (the biquad
+ * uses floating point to compute its coefficients once, when it is set up),
+ * and none of them divide: averages over a power of two are computed with
+ * shifts.
+ *
+ * Each filter has an `add()` function that takes a new sample and returns
+ * the filtered value, and a `get()` function that returns the last filtered
+ * value.  The first sample after construction or `reset()` fills the whole
+ * filter, as if the input had always had that value, so the output does not
+ * start out pulled toward zero.
+ *
+ * ### Cycle costs ###
+ *
+ * Estimated cost of one `add()` on an ATmega328P with `int` samples.  These
+ * are rough estimates from counting instructions, not measurements; the
+ * Benchmark example measures the real costs on your board.
+ *
+ * Filter                        | Estimated cycles
+ * ----------------------------- | ----------------
+ * `ZumoMovingAverage<int, S>`   | about 50 + 6 * S
+ * `ZumoEMA<int, S>`             | about 40 + 12 * S
+ * `ZumoBiquad`                  | about 250
+ * `ZumoMedian<int, N>`          | about 40 + 15 * N
+ *
+ * For comparison, a 16-bit division takes about 200 cycles and a 32-bit
+ * division about 600.
+ */
+
+#ifndef ZumoFilters_h
+#define ZumoFilters_h
+
+#include <Arduino.h>
+
+/*! \brief Average of the last 2^SHIFT samples
+ *
+ * T is the sample type and S is the type used for the running sum, which
+ * has to be able to hold 2^SHIFT times the largest sample (the default,
+ * `long`, is big enough for any `int` samples).  SHIFT can be from 0 to 8.
+ * The average is the sum shifted right by SHIFT, so it rounds toward minus
+ * infinity.
+ */
+template <class T, unsigned char SHIFT, class S = long>
+class ZumoMovingAverage
+{
+  public:
+
+    // the number of samples averaged
+    static const unsigned int SIZE = 1U << SHIFT;
+
+    ZumoMovingAverage() { reset(); }
+
+    // forgets all samples; the next sample fills the filter
+    void reset()
+    {
+      sum = 0;
+      index = 0;
+      primed = false;
+    }
+
+    // sets every stored sample to the given value
+    void fill(T value)
+    {
+      for (unsigned int i = 0; i < SIZE; i++)
+        samples[i] = value;
+      sum = (S)value * (S)SIZE;
+      index = 0;
+      primed = true;
+    }
+
+    // adds a sample, replacing the oldest one, and returns the new average
+    T add(T value)
+    {
+      if (!primed)
+      {
+        fill(value);
+        return value;
+      }
+      sum += (S)value - (S)samples[index];
+      samples[index] = value;
+      index = (index + 1) & (SIZE - 1);
+      return get();
+    }
+
+    T get() const { return sum >> SHIFT; }
+
+  private:
+
+    T samples[1U << SHIFT];
+    S sum;
+    unsigned char index;  // where the next sample goes
+    boolean primed;
+};
+
+/*! \brief Exponential moving average
+ *
+ * Each sample moves the output 1/2^SHIFT of the way toward it, which
+ * smooths about as much as a moving average of 2^SHIFT samples but only
+ * stores the output.  The output is kept with SHIFT extra fractional bits in
+ * a variable of type S, which has to be able to hold 2^SHIFT times the
+ * largest sample; SHIFT can be from 1 to 15 with `int` samples and the
+ * default `long`.
+ */
+template <class T, unsigned char SHIFT, class S = long>
+class ZumoEMA
+{
+  public:
+
+    ZumoEMA() { reset(); }
+
+    // forgets the output; the next sample fills the filter
+    void reset()
+    {
+      state = 0;
+      primed = false;
+    }
+
+    // sets the output to the given value
+    void fill(T value)
+    {
+      state = (S)value * ((S)1 << SHIFT);
+      primed = true;
+    }
+
+    // adds a sample and returns the new output
+    T add(T value)
+    {
+      if (!primed)
+      {
+        fill(value);
+        return value;
+      }
+      state += (S)value - (state >> SHIFT);
+      return get();
+    }
+
+    T get() const { return state >> SHIFT; }
+
+  private:
+
+    S state;  // the output times 2^SHIFT
+    boolean primed;
+};
+
+/*! \brief Fixed-point second-order (biquad) filter
+ *
+ * ZumoBiquad computes
+ *
+ *     y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ *
+ * with coefficients that are fixed-point numbers with 14 fractional bits
+ * (16384 means 1.0) and a 32-bit accumulator.  The part of each output that
+ * is lost when the accumulator is shifted back down is carried into the next
+ * one, so low cutoff frequencies do not leave a constant error in the output.
+ *
+ * `setLowPass()` and `setHighPass()` compute Butterworth-style coefficients
+ * (from the well-known "Audio EQ Cookbook" formulas) for a cutoff frequency
+ * given as a fraction of the sample rate: for example, 0.05 for a 5 Hz
+ * cutoff on readings taken 100 times per second.  The cutoff should be
+ * between about 0.005 and 0.45; below that, the 14-bit coefficients are too
+ * coarse.  The coefficients are adjusted after rounding so that a low-pass
+ * filter passes a constant input exactly and a high-pass filter removes it
+ * completely.
+ *
+ * Samples should stay within -8192 to 8191.  Then the 32-bit accumulator
+ * cannot overflow for any cutoff from 0.005 to 0.45 and any Q up to 1, even
+ * if the output saturates.  Wider inputs are not safe: a high-pass filter
+ * with a low cutoff has large coefficients that nearly cancel, and with
+ * inputs up to 16384 and a cutoff of 0.005 the accumulator can reach about
+ * 2.6 billion.  (The LSM303 accelerometer returns 12-bit readings shifted
+ * left by four bits, so shift them right first.)
+ */
+class ZumoBiquad
+{
+  public:
+
+    // constructor; the filter passes its input through unchanged until it
+    // is set up
+    ZumoBiquad()
+    {
+      setCoefficients(16384, 0, 0, 0, 0);
+    }
+
+    // Sets the coefficients, with 14 fractional bits, and resets the filter.
+    void setCoefficients(int b0, int b1, int b2, int a1, int a2)
+    {
+      this->b0 = b0;
+      this->b1 = b1;
+      this->b2 = b2;
+      this->a1 = a1;
+      this->a2 = a2;
+      reset();
+    }
+
+    // Sets up a low-pass filter with the given cutoff frequency (as a
+    // fraction of the sample rate) and Q (0.7071 gives the flattest
+    // passband without a peak).
+    void setLowPass(float cutoff, float q = 0.7071)
+    {
+      float c = cos(2 * M_PI * cutoff);
+      float alpha = sin(2 * M_PI * cutoff) / (2 * q);
+      float a0 = 1 + alpha;
+      int nb0 = fixed((1 - c) / 2 / a0);
+      int na1 = fixed(-2 * c / a0);
+      int na2 = fixed((1 - alpha) / a0);
+      // b0 + b1 + b2 = 1 + a1 + a2 gives a gain of exactly 1 at DC
+      setCoefficients(nb0, 16384 + na1 + na2 - 2 * nb0, nb0, na1, na2);
+    }
+
+    // Sets up a high-pass filter with the given cutoff frequency (as a
+    // fraction of the sample rate) and Q.
+    void setHighPass(float cutoff, float q = 0.7071)
+    {
+      float c = cos(2 * M_PI * cutoff);
+      float alpha = sin(2 * M_PI * cutoff) / (2 * q);
+      float a0 = 1 + alpha;
+      int nb0 = fixed((1 + c) / 2 / a0);
+      // b0 + b1 + b2 = 0 gives a gain of exactly 0 at DC
+      setCoefficients(nb0, -2 * nb0, nb0, fixed(-2 * c / a0), fixed((1 - alpha) / a0));
+    }
+
+    // forgets the past samples; the next sample fills the filter
+    void reset()
+    {
+      x1 = x2 = y1 = y2 = 0;
+      error = 0;
+      primed = false;
+    }
+
+    // Sets the past inputs to the given value and the past outputs to what
+    // a constant input of that value would settle to.
+    void fill(int value)
+    {
+      long den = 16384L + a1 + a2;
+      x1 = x2 = value;
+      y1 = y2 = den == 0 ? 0 : (long)value * ((long)b0 + b1 + b2) / den;
+      error = 0;
+      primed = true;
+    }
+
+    // adds a sample and returns the new output
+    int add(int value)
+    {
+      if (!primed)
+        fill(value);
+
+      long acc = error + (long)b0 * value + (long)b1 * x1 + (long)b2 * x2 -
+        (long)a1 * y1 - (long)a2 * y2;
+      long y = acc >> 14;
+      error = acc - y * 16384;
+      if (y > 32767)
+        y = 32767;
+      else if (y < -32768)
+        y = -32768;
+
+      x2 = x1;
+      x1 = value;
+      y2 = y1;
+      y1 = y;
+      return y;
+    }
+
+    int get() const { return y1; }
+
+  private:
+
+    static int fixed(float value)
+    {
+      return value < 0 ? (int)(value * 16384 - 0.5) : (int)(value * 16384 + 0.5);
+    }
+
+    int b0, b1, b2, a1, a2;
+    int x1, x2;    // the last two inputs
+    int y1, y2;    // the last two outputs
+    int error;     // fractional part of the last accumulator, 14 bits
+    boolean primed;
+};
+
+/*! \brief Median of the last N samples
+ *
+ * N should be odd (3 or 5 is usually enough); with an even N, the upper of
+ * the two middle samples is returned.  The filter keeps the samples both in
+ * the order they arrived and in sorted order, so each new sample only has to
+ * be moved into place among the others, which takes time proportional to N.
+ */
+template <class T, unsigned char N>
+class ZumoMedian
+{
+  public:
+
+    ZumoMedian() { reset(); }
+
+    // forgets all samples; the next sample fills the filter
+    void reset()
+    {
+      for (unsigned char i = 0; i < N; i++)
+        history[i] = sorted[i] = 0;
+      index = 0;
+      primed = false;
+    }
+
+    // sets every stored sample to the given value
+    void fill(T value)
+    {
+      for (unsigned char i = 0; i < N; i++)
+        history[i] = sorted[i] = value;
+      index = 0;
+      primed = true;
+    }
+
+    // adds a sample, replacing the oldest one, and returns the new median
+    T add(T value)
+    {
+      if (!primed)
+      {
+        fill(value);
+        return value;
+      }
+
+      T oldest = history[index];
+      history[index] = value;
+      if (++index == N)
+        index = 0;
+
+      // Find the oldest sample in the sorted list, then slide the new one
+      // into its place from there.
+      unsigned char i = 0;
+      while (sorted[i] != oldest)
+        i++;
+      while (i > 0 && sorted[i - 1] > value)
+      {
+        sorted[i] = sorted[i - 1];
+        i--;
+      }
+      while (i < N - 1 && sorted[i + 1] < value)
+      {
+        sorted[i] = sorted[i + 1];
+        i++;
+      }
+      sorted[i] = value;
+      return get();
+    }
+
+    T get() const { return sorted[N / 2]; }
+
+  private:
+
+    T history[N];  // in the order they arrived
+    T sorted[N];
+    unsigned char index;  // where the next sample goes in history
+    boolean primed;
+};
+
+#endif
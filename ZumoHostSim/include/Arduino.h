@@ -0,0 +1,156 @@
+// Host simulation stand-in for the Arduino core.
+//
+// Provides the parts of the Arduino 1.0 API used by the Zumo libraries and
+// examples on top of the simulator in ZumoHostSim.cpp.  Time is virtual and
+// only moves in calls into the core: pinMode(), digitalWrite(),
+// digitalRead(), millis(), and micros() each cost a few CPU cycles (see
+// ZumoSim::setCallCycles()), analogRead() costs 100 us, delay() and
+// delayMicroseconds() skip ahead instantly, and ZumoSim::setMicros() can
+// jump to any point in time.  Code between core calls takes no time.
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#define ARDUINO 100
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define round(x)     ((x)>=0?(long)((x)+0.5):(long)((x)-0.5))
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define sq(x) ((x)*(x))
+
+#define interrupts() sei()
+#define noInterrupts() cli()
+
+#define clockCyclesPerMicrosecond() ( F_CPU / 1000000L )
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+
+#define F(string_literal) (string_literal)
+
+typedef uint8_t boolean;
+typedef uint8_t byte;
+typedef unsigned int word;
+
+// pin numbering matches the Arduino Uno (ATmega328P) or Leonardo (ATmega32U4)
+#if defined(__AVR_ATmega32U4__)
+  #define NUM_DIGITAL_PINS 24
+  static const uint8_t A0 = 18;
+  static const uint8_t A1 = 19;
+  static const uint8_t A2 = 20;
+  static const uint8_t A3 = 21;
+  static const uint8_t A4 = 22;
+  static const uint8_t A5 = 23;
+#else
+  #define NUM_DIGITAL_PINS 20
+  static const uint8_t A0 = 14;
+  static const uint8_t A1 = 15;
+  static const uint8_t A2 = 16;
+  static const uint8_t A3 = 17;
+  static const uint8_t A4 = 18;
+  static const uint8_t A5 = 19;
+#endif
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+#define PE 5
+#define PF 6
+
+// Pin change interrupts are not simulated, so digitalPinToPCICR() is left
+// undefined and Pushbutton falls back to polling.
+uint8_t digitalPinToPort(uint8_t pin);
+uint8_t digitalPinToBitMask(uint8_t pin);
+volatile uint8_t *portOutputRegister(uint8_t port);
+volatile uint8_t *portInputRegister(uint8_t port);
+volatile uint8_t *portModeRegister(uint8_t port);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned int seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+void setup(void);
+void loop(void);
+
+// Serial output goes to stdout; nothing is ever received.
+class ZumoSimSerial
+{
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush();
+
+    size_t write(uint8_t c);
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return print("\r\n"); }
+    template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+    operator bool() { return true; }
+};
+
+extern ZumoSimSerial Serial;
+
+#endif
@@ -0,0 +1,84 @@
+// ZumoSim: control and observation interface for the host simulation HAL.
+//
+// Test programs and simulators use these functions to set up virtual time and
+// the simulated world (pin levels, reflectance sensor discharge times) and to
+// read back what the libraries did with the hardware (motor speeds, buzzer
+// frequency).
+
+#ifndef ZumoSim_h
+#define ZumoSim_h
+
+#include <Arduino.h>
+
+// external drive applied to a pin while it is an input
+#define ZUMO_SIM_FLOATING   0   // reads the pull-up (HIGH if enabled, else LOW)
+#define ZUMO_SIM_DRIVE_LOW  1
+#define ZUMO_SIM_DRIVE_HIGH 2
+#define ZUMO_SIM_RC         3   // QTR RC sensor: HIGH until the capacitor discharges
+
+// Returns the RC discharge time (in microseconds) of a sensor pin at the
+// moment it is released to start a reading.
+typedef unsigned int (*ZumoSimDischargeCallback)(uint8_t pin);
+
+// Called periodically as virtual time advances (see setStepCallback()).
+typedef void (*ZumoSimStepCallback)(void);
+
+class ZumoSim
+{
+  public:
+
+    // Returns the simulator to its power-on state: time 0, interrupts
+    // disabled (the Arduino core enables them before setup()), all pins
+    // floating inputs, and all registers cleared.
+    static void reset();
+
+    // virtual time
+    static unsigned long long getCycles();
+    static unsigned long long getMicros();
+    static void setMicros(unsigned long long us);
+    static void advanceMicros(unsigned long us);
+    static void advanceCycles(unsigned long cycles);
+
+    // CPU cycles charged for each call to pinMode(), digitalWrite(),
+    // digitalRead(), millis(), or micros() and for each pass through the
+    // core's main loop between calls to loop() (default 64), which keeps
+    // polling loops like the QTR sensor read moving forward.  delay(),
+    // delayMicroseconds(), and analogRead() (100 us) move time forward by
+    // their own amounts.  Nothing else advances time: a busy-wait that
+    // never calls into the core (such as "while(buzzer.isPlaying());")
+    // spins forever, so sketches meant for the simulator should call
+    // something like delay(1) in such loops.
+    static void setCallCycles(unsigned int cycles);
+
+    // simulated pins
+    static void setPinDrive(uint8_t pin, uint8_t drive);
+    static void setDischargeMicros(uint8_t pin, unsigned int us);
+    static void setDischargeCallback(ZumoSimDischargeCallback callback);
+    static void setAnalogValue(uint8_t pin, int value);
+    static void setPinDriveAt(unsigned long long us, uint8_t pin, uint8_t drive);
+    static uint8_t getPinLevel(uint8_t pin);
+    static boolean isOutput(uint8_t pin);
+
+    // Shortcut for the Zumo Shield's user pushbutton on pin 12: drive it low
+    // from the given time for the given duration.
+    static void pressButtonAt(unsigned long long us, unsigned long durationMicros = 100000);
+
+    // motor outputs, -400 to 400 (positive is forward), from the Timer1
+    // registers or the last analogWrite() and the direction pins
+    static int getLeftMotorSpeed();
+    static int getRightMotorSpeed();
+
+    // buzzer frequency in Hz (0 when silent), from the Timer2 (ATmega328P) or
+    // Timer4 (ATmega32U4) registers
+    static unsigned int getBuzzerFrequency();
+
+    // calls callback every periodMicros of virtual time (0 disables)
+    static void setStepCallback(ZumoSimStepCallback callback, unsigned long periodMicros);
+
+    // Calls setup() and then loop() until the given virtual time is reached or
+    // stop() is called.
+    static void runSketch(unsigned long long untilMicros);
+    static void stop();
+};
+
+#endif
@@ -0,0 +1,88 @@
+// ZumoTrackSim: a 2D line track for the host simulation.
+//
+// The track is a grayscale image (black line on a white surface) loaded from
+// a PGM file or generated in memory.  As virtual time advances, the Zumo is
+// moved across it with differential-drive kinematics from the motor speeds
+// the sketch sets with ZumoMotors, and each reflectance sensor reading gets
+// a discharge time synthesized from the image under that sensor.  Along the
+// way, the simulator measures how well the sketch follows the line.
+//
+// Coordinates are in millimeters with the origin at the top left corner of
+// the image, x to the right and y down; a heading of 0 degrees points along
+// +x and positive headings turn counterclockwise as seen in the image.
+
+#ifndef ZumoTrackSim_h
+#define ZumoTrackSim_h
+
+#include <stdio.h>
+#include <ZumoSim.h>
+
+struct ZumoTrackSimRobot
+{
+  float maxSpeed;           // mm/s at a motor speed of 400 (default 600)
+  float trackWidth;         // distance between the treads, mm (default 86)
+  float motorTimeConstant;  // first-order motor response, s (default 0.05)
+  float sensorOffset;       // sensor array ahead of the axle, mm (default 45)
+  float sensorPitch;        // distance between adjacent sensors, mm (default 12.7)
+  unsigned int whiteMicros; // discharge time over white (default 150)
+  unsigned int blackMicros; // discharge time over black (default 2500)
+};
+
+// line-following statistics for one run (from a button press until the
+// Zumo stops again)
+struct ZumoTrackSimRun
+{
+  float startTime;          // s
+  float duration;           // s
+  float distance;           // mm traveled by the center of the axle
+  unsigned int laps;
+  float lastLapTime;        // s
+  float bestLapTime;        // s
+  float rmsCrossTrackError; // mm, while driving forward with the line in view
+  float maxCrossTrackError; // mm
+  unsigned int lineLosses;  // times all six sensors left the line
+  float offLineTime;        // s with none of the sensors over the line
+  float longestOffLineTime; // s
+};
+
+class ZumoTrackSim
+{
+  public:
+
+    // Loads a binary (P5) or ASCII (P2) PGM image with the given scale.
+    // Returns false if the file cannot be read.
+    static boolean loadPgm(const char *filename, float mmPerPixel);
+
+    // Generates an oval track: two straights joined by semicircles, drawn
+    // with a 19 mm (3/4") line.  The start pose is set to the middle of the
+    // bottom straight, facing right (counterclockwise laps).
+    static void generateOval(float straightLength = 600, float radius = 250);
+
+    static void setStartPose(float x, float y, float headingDegrees);
+    static ZumoTrackSimRobot *robot();
+
+    // Presses the user pushbutton and returns the Zumo to its start pose
+    // whenever it has been standing still for this long (default 1000 ms;
+    // 0 disables), like a person restarting it on the course.
+    static void setAutoPress(unsigned long ms);
+
+    // Writes the time, pose, motor speeds and cross-track error as CSV
+    // every periodMillis while the sketch runs.
+    static void setTrace(FILE *file, unsigned long periodMillis = 10);
+
+    // Hooks the track up to the simulator; call after ZumoSim::reset() and
+    // before ZumoSim::runSketch().
+    static void begin();
+
+    // Prints the statistics of each run to the given file as it ends and
+    // of the run in progress when this is called.
+    static void setReportFile(FILE *file);
+    static void printReport();
+
+    static float getX();
+    static float getY();
+    static float getHeading();
+    static const ZumoTrackSimRun *currentRun();
+};
+
+#endif
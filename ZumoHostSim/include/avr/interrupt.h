@@ -0,0 +1,18 @@
+// Host simulation stand-in for <avr/interrupt.h>.
+//
+// Interrupt service routines become plain functions that the simulator calls
+// when their interrupt is enabled, its flag is set, and the global interrupt
+// flag in SREG is set.  A pending interrupt is serviced the next time virtual
+// time advances (the next call to micros(), digitalRead(), delay(), etc.).
+
+#ifndef ZumoHostSim_avr_interrupt_h
+#define ZumoHostSim_avr_interrupt_h
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+#define sei() (SREG |= (1 << SREG_I))
+#define cli() (SREG &= ~(1 << SREG_I))
+
+#endif
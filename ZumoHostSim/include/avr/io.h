@@ -0,0 +1,127 @@
+// Host simulation stand-in for <avr/io.h>.
+//
+// The I/O registers that the Zumo libraries touch are ordinary variables
+// defined in ZumoHostSim.cpp.  The simulator reads the timer registers to
+// decide when to call the overflow interrupts and to report the motor and
+// buzzer outputs, and it keeps the PINx registers up to date with the
+// simulated pin levels whenever virtual time advances.
+
+#ifndef ZumoHostSim_avr_io_h
+#define ZumoHostSim_avr_io_h
+
+#include <stdint.h>
+
+// Simulate an ATmega328P (Arduino Uno) unless an ATmega32U4 (Arduino
+// Leonardo) is selected with -D__AVR_ATmega32U4__.  __AVR__ is deliberately
+// left undefined so that code with a portable fallback (like the sleep
+// functions in Pushbutton) uses it.
+#if !defined(__AVR_ATmega328P__) && !defined(__AVR_ATmega32U4__)
+  #define __AVR_ATmega328P__
+#endif
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+// An interrupt flag register: like the real thing, writing a one to a flag
+// clears it, so "TIFR2 |= 0xFF" clears every pending flag.
+class ZumoSimFlagRegister
+{
+  public:
+    ZumoSimFlagRegister &operator=(uint8_t value) { flags &= ~value; return *this; }
+    ZumoSimFlagRegister &operator|=(uint8_t value) { flags &= ~(flags | value); return *this; }
+    ZumoSimFlagRegister &operator&=(uint8_t value) { flags &= ~(flags & value); return *this; }
+    operator uint8_t() const { return flags; }
+
+    // used by the simulator to raise a flag
+    void set(uint8_t mask) { flags |= mask; }
+
+    volatile uint8_t flags;
+};
+
+// A 10-bit Timer4 register: writing the low byte latches the top two bits
+// from TC4H.
+class ZumoSimTimer4Register
+{
+  public:
+    ZumoSimTimer4Register &operator=(uint8_t low);
+    operator uint8_t() const;
+
+    volatile uint16_t value;
+};
+
+extern volatile uint8_t SREG;
+
+// general-purpose I/O ports
+extern volatile uint8_t PINB, DDRB, PORTB;
+extern volatile uint8_t PINC, DDRC, PORTC;
+extern volatile uint8_t PIND, DDRD, PORTD;
+extern volatile uint8_t PINE, DDRE, PORTE;
+extern volatile uint8_t PINF, DDRF, PORTF;
+
+// Timer0 (counts at F_CPU/64; the simulator keeps it in step with micros())
+extern volatile uint8_t TCNT0;
+
+// Timer1 (motor PWM)
+extern volatile uint8_t TCCR1A, TCCR1B;
+extern volatile uint16_t ICR1, OCR1A, OCR1B;
+extern ZumoSimFlagRegister TIFR1;
+
+// Timer2 (buzzer on the ATmega328P)
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TIMSK2;
+extern ZumoSimFlagRegister TIFR2;
+
+// Timer4 (buzzer on the ATmega32U4)
+extern volatile uint8_t TCCR4A, TCCR4B, TCCR4C, TCCR4D, TC4H, TIMSK4;
+extern ZumoSimTimer4Register OCR4C, OCR4D;
+extern ZumoSimFlagRegister TIFR4;
+
+#define SREG_I  7
+
+#define PORTB0 0
+#define PORTB1 1
+#define PORTB2 2
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+#define PORTB6 6
+#define PORTB7 7
+#define PORTC6 6
+#define PORTC7 7
+#define PORTD0 0
+#define PORTD1 1
+#define PORTD2 2
+#define PORTD3 3
+#define PORTD4 4
+#define PORTD5 5
+#define PORTD6 6
+#define PORTD7 7
+#define PORTE6 6
+
+#define PB0 PORTB0
+#define PB4 PORTB4
+#define PD3 PORTD3
+#define PD7 PORTD7
+#define PE6 PORTE6
+
+#define COM1A1  7
+#define COM1A0  6
+#define COM1B1  5
+#define COM1B0  4
+#define WGM11   1
+#define WGM10   0
+#define WGM13   4
+#define WGM12   3
+#define TOV1    0
+
+#define COM2B1  5
+#define WGM22   3
+#define TOIE2   0
+#define TOV2    0
+
+#define TOIE4   2
+#define TOV4    2
+
+#endif
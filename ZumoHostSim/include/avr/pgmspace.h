@@ -0,0 +1,56 @@
+// Host simulation stand-in for <avr/pgmspace.h>.
+//
+// The host has a single address space, so program memory is ordinary
+// read-only data.
+
+#ifndef ZumoHostSim_avr_pgmspace_h
+#define ZumoHostSim_avr_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+
+// the reads go through memcpy() so that they can be applied to fields of any
+// type without breaking the strict aliasing rules
+static inline uint8_t pgm_read_byte(const void *address)
+{
+  return *(const uint8_t *)address;
+}
+
+static inline uint16_t pgm_read_word(const void *address)
+{
+  uint16_t value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+static inline uint32_t pgm_read_dword(const void *address)
+{
+  uint32_t value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+static inline float pgm_read_float(const void *address)
+{
+  float value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+static inline const void *pgm_read_ptr(const void *address)
+{
+  const void *value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+#define memcpy_P  memcpy
+#define strlen_P  strlen
+#define strcpy_P  strcpy
+#define strcmp_P  strcmp
+
+#endif
@@ -0,0 +1,95 @@
+// main() for timing the pure computation cases of the Benchmark example
+// (ZumoExamples/examples/Benchmark) on the host.  Link it with
+// ZumoCompass.cpp (no sketch or simulator is needed; ZumoFilters is a
+// header).
+//
+//   usage: ZumoBenchmark [trials]
+//
+// It prints "name,calls,ns_per_call" lines using the same names and inputs as
+// the Benchmark example, for the cases that only compute (the filters and the
+// compass heading); the cases that wait on hardware (sensor reads, motors,
+// buzzer, pushbutton) are left to the sketch.  Each case is run the given
+// number of times (default 5) and the fastest run is reported, which keeps
+// the numbers steady from one run to the next on an otherwise idle computer.
+//
+// The times are for the host, not an AVR, so they are only useful for
+// comparing versions of the libraries on the same computer with the same
+// compiler options; for example, a change that removes a division should
+// make the corresponding line faster here too.  The Benchmark example
+// measures AVR cycles on a board.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ZumoFilters.h>
+#include <ZumoCompass.h>
+
+static ZumoMovingAverage<int, 3> movingAverage;
+static ZumoEMA<int, 3> ema;
+static ZumoBiquad biquad;
+static ZumoMedian<int, 5> median;
+static ZumoCompass compassHeading;
+static volatile int result;  // keeps the compiler from optimizing calls away
+
+static unsigned int trials = 5;
+
+static double now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// each trial repeats the Benchmark example's loop this many times, so that
+// it takes long enough to time accurately on the host
+#define REPEATS 1000
+
+// Runs statement the given number of times per trial and prints the fastest
+// trial's average time per call.  The loop counter is 16 bits wide, as on the
+// AVR, so the inputs are the same as in the Benchmark example.
+#define BENCHMARK(name, calls, statement)                            \
+  do                                                                 \
+  {                                                                  \
+    double best = 0;                                                 \
+    for (unsigned int t = 0; t < trials; t++)                        \
+    {                                                                \
+      double start = now();                                          \
+      for (unsigned int r = 0; r < REPEATS; r++)                     \
+      {                                                              \
+        for (volatile uint16_t i = 0; i < (calls); i++)              \
+        {                                                            \
+          statement;                                                 \
+        }                                                            \
+      }                                                              \
+      double elapsed = now() - start;                                \
+      if (t == 0 || elapsed < best)                                  \
+        best = elapsed;                                              \
+    }                                                                \
+    printf("%s,%u,%.1f\n", name, (calls), best / REPEATS / (calls)); \
+  } while (0)
+
+int main(int argc, char **argv)
+{
+  if (argc > 2 || (argc == 2 && (trials = strtoul(argv[1], 0, 10)) == 0))
+  {
+    fprintf(stderr, "usage: ZumoBenchmark [trials]\n");
+    return 2;
+  }
+
+  biquad.setLowPass(0.05);
+
+  printf("# zumo-host-benchmark trials=%u\n", trials);
+  printf("name,calls,ns_per_call\n");
+
+  BENCHMARK("filters_moving_average_8", 1000, result = movingAverage.add(i));
+  BENCHMARK("filters_ema_8", 1000, result = ema.add(i));
+  BENCHMARK("filters_biquad", 1000, result = biquad.add(i & 0x1FFF));
+  BENCHMARK("filters_median_5", 1000, result = median.add(i));
+
+  BENCHMARK("compass_atan2", 1000, result = ZumoCompass::atan2(i, 500));
+  BENCHMARK("float_atan2", 1000, result = atan2(i, 500) * (32768 / M_PI));
+  BENCHMARK("compass_update", 1000, result = compassHeading.update(300, i & 15));
+
+  printf("# done\n");
+  return 0;
+}
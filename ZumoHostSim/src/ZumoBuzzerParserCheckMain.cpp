@@ -0,0 +1,343 @@
+// main() for checking the melody parser used by ZumoBuzzer::play() on the
+// host.  Link it with ZumoBuzzerParser.cpp (no sketch is needed).
+//
+//   usage: ZumoBuzzerParserCheck golden.txt     compare with a golden file
+//          ZumoBuzzerParserCheck --write in.txt print a golden file for the
+//                                               melodies in in.txt
+//          ZumoBuzzerParserCheck --fuzz n [seed]
+//                                               parse n random sequences
+//          ZumoBuzzerParserCheck --bench        time the example melodies
+//
+// A golden file lists melodies and the notes they should be parsed into.
+// Each melody is a line starting with "> ", followed by the sequence exactly
+// as it would be passed to play(), and then one line for each note or rest:
+// "note duration volume" (a rest is note 255, SILENT_NOTE).  Lines starting
+// with '#' are comments; they and blank lines end a melody's notes.  --write
+// reads the same format (ignoring any notes after each melody) and prints the
+// file with the notes the parser produces now; check the differences by hand
+// before committing a new golden file.
+//
+// The fuzzer builds random sequences from the characters the parser knows
+// plus a few it does not, and checks that each one finishes (every note uses
+// up at least one character, apart from the rests after staccato notes) and
+// parses into exactly the same notes when its letters are upper-cased and
+// when spaces are inserted between its characters.  A crash (for example, a
+// division by zero) prints the sequence being parsed.
+//
+// The benchmark parses each melody from the example sketches many times and
+// prints "name,notes,ns_per_note" lines.  The times are for the host, not an
+// AVR, so they are only useful for comparing versions of the parser on the
+// same computer; the Benchmark example measures AVR cycles.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <ZumoBuzzerParser.h>
+
+#define MAX_NOTES 10000
+#define MAX_SEQUENCE 256
+
+struct Note
+{
+  unsigned char note;
+  uint16_t duration;
+  unsigned char volume;
+};
+
+// melodies from the example sketches and documentation
+static const struct
+{
+  const char *name;
+  const char *sequence;
+} melodies[] = {
+  { "scale", "!L16 V8 cdefgab>cbagfedc" },
+  { "fugue", "!T240 L8 agafaea dac+adaea fa<aa<bac#a dac#adaea f4" },
+  { "example2", "! V10 cdefgab>cbagfedc" },
+  { "rhapsody", "O6 T40 L16 d#<b<f#<d#<f#<bd#f#"
+    "T80 c#<b-<f#<c#<f#<b-c#8"
+    "T180 d#b<f#d#f#>bd#f#c#b-<f#c#f#>b-c#8 c>c#<c#>c#<b>c#<c#>c#c>c#<c#>c#<b>c#<c#>c#"
+    "c>c#<c#>c#<b->c#<c#>c#c>c#<c#>c#<b->c#<c#>c#"
+    "c>c#<c#>c#f>c#<c#>c#c>c#<c#>c#f>c#<c#>c#"
+    "c>c#<c#>c#f#>c#<c#>c#c>c#<c#>c#f#>c#<c#>c#d#bb-bd#bf#d#c#b-ab-c#b-f#d#" },
+  { "compiled", "! O5 L16 T140 ceg>c8 r <g8 >c4" },
+  { "stats", "! O5 L16 T140 V8 ceg>c8 r <g8 >c4 r4 <b-ag f8 a8 >c4" },
+  { "sumo_charge", "O4 T100 V15 L4 MS g12>c12>e12>G6>E12 ML>G2" },
+  { "sumo_search", "O3 T120 V6 L8 MS cege cege dfaf dfaf" },
+  { "line_start", ">g32>>c32" },
+  { "line_done", "L16 cdegreg4" },
+  { "maze_turn", ">>a32" },
+};
+
+static const char *currentSequence;
+
+static void crashed(int)
+{
+  static const char message[] = "crashed while parsing: ";
+  if (write(2, message, sizeof(message) - 1) < 0 ||
+      write(2, currentSequence, strlen(currentSequence)) < 0 ||
+      write(2, "\n", 1) < 0)
+    _exit(3);
+  _exit(3);
+}
+
+// Parses a sequence into notes, returning the number of notes, or -1 if
+// there are more than maxNotes.
+static int parse(const char *sequence, Note *notes, int maxNotes)
+{
+  ZumoBuzzerParser parser;
+  Note n;
+  int count = 0;
+
+  currentSequence = sequence;
+  parser.begin(sequence, 0);
+  while (parser.parseNote(&n.note, &n.duration, &n.volume))
+  {
+    if (count == maxNotes)
+      return -1;
+    notes[count++] = n;
+  }
+  return count;
+}
+
+static bool sameNotes(const Note *a, const Note *b, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    if (a[i].note != b[i].note || a[i].duration != b[i].duration ||
+        a[i].volume != b[i].volume)
+      return false;
+  }
+  return true;
+}
+
+static void printNotes(const Note *notes, int count)
+{
+  for (int i = 0; i < count; i++)
+    printf("%u %u %u\n", notes[i].note, notes[i].duration, notes[i].volume);
+}
+
+static char *stripNewline(char *line)
+{
+  line[strcspn(line, "\r\n")] = 0;
+  return line;
+}
+
+// Reads a golden file and either compares it with the parser's output or
+// (if write is true) prints it with the parser's output.  Returns the number
+// of melodies that did not match.
+static int checkGolden(FILE *file, bool write)
+{
+  static Note notes[MAX_NOTES];
+  static Note expected[MAX_NOTES];
+  static char melody[4096];
+  char line[4096];
+  int expectedCount = 0, melodyCount = 0, failures = 0;
+  bool haveMelody = false;
+
+  for (bool done = false; !done; )
+  {
+    bool more = fgets(line, sizeof(line), file) != 0;
+    stripNewline(line);
+    bool newMelody = more && !strncmp(line, "> ", 2);
+    bool comment = more && (line[0] == '#' || line[0] == 0);
+
+    if (haveMelody && (newMelody || comment || !more))
+    {
+      // finish the previous melody
+      int count = parse(melody, notes, MAX_NOTES);
+      if (write)
+      {
+        printNotes(notes, count < 0 ? 0 : count);
+      }
+      else if (count != expectedCount ||
+               !sameNotes(notes, expected, count))
+      {
+        printf("mismatch for \"%s\":\n", melody);
+        for (int i = 0; i < count || i < expectedCount; i++)
+        {
+          if (i < count && i < expectedCount &&
+              sameNotes(&notes[i], &expected[i], 1))
+            continue;
+          printf("  note %d: expected ", i);
+          if (i < expectedCount)
+            printf("%u %u %u", expected[i].note, expected[i].duration, expected[i].volume);
+          else
+            printf("nothing");
+          printf(", got ");
+          if (i < count)
+            printf("%u %u %u\n", notes[i].note, notes[i].duration, notes[i].volume);
+          else
+            printf("nothing\n");
+        }
+        failures++;
+      }
+      haveMelody = false;
+    }
+
+    if (!more)
+    {
+      done = true;
+    }
+    else if (newMelody)
+    {
+      snprintf(melody, sizeof(melody), "%s", line + 2);
+      haveMelody = true;
+      expectedCount = 0;
+      melodyCount++;
+      if (write)
+        printf("%s\n", line);
+    }
+    else if (comment)
+    {
+      if (write)
+        printf("%s\n", line);
+    }
+    else if (!haveMelody)
+    {
+      fprintf(stderr, "note without a melody in golden file: %s\n", line);
+      return failures + 1;
+    }
+    else if (!write)
+    {
+      unsigned int note, duration, volume;
+      if (sscanf(line, "%u %u %u", &note, &duration, &volume) != 3 ||
+          expectedCount == MAX_NOTES)
+      {
+        fprintf(stderr, "bad line in golden file: %s\n", line);
+        return failures + 1;
+      }
+      expected[expectedCount].note = note;
+      expected[expectedCount].duration = duration;
+      expected[expectedCount].volume = volume;
+      expectedCount++;
+    }
+  }
+
+  if (!write)
+    printf("%d melodies, %d mismatches\n", melodyCount, failures);
+  return failures;
+}
+
+static int fuzz(unsigned long iterations, unsigned int seed)
+{
+  static const char alphabet[] = "abcdefgrlmotv!<>+#-.0123456789 ABCDEFGRLMOTVxz";
+  static Note notes[MAX_SEQUENCE * 2 + 1], variant[MAX_SEQUENCE * 2 + 1];
+  char sequence[MAX_SEQUENCE], upper[MAX_SEQUENCE], spaced[MAX_SEQUENCE * 2];
+  int failures = 0;
+
+  srand(seed);
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    int length = rand() % (MAX_SEQUENCE / 4);
+    for (int j = 0; j < length; j++)
+    {
+      // mostly digits after letters, to reach the number arguments
+      if (j > 0 && rand() % 3 == 0)
+        sequence[j] = '0' + rand() % 10;
+      else
+        sequence[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    sequence[length] = 0;
+
+    int k = 0;
+    for (int j = 0; j <= length; j++)
+    {
+      upper[j] = (sequence[j] >= 'a' && sequence[j] <= 'z') ? sequence[j] - 'a' + 'A' : sequence[j];
+      if (j < length)
+      {
+        spaced[k++] = sequence[j];
+        if (rand() % 2)
+          spaced[k++] = ' ';
+      }
+    }
+    spaced[k] = 0;
+
+    // each note uses at least one character, and a staccato rest follows at
+    // most one note
+    int maxNotes = length * 2 + 1;
+    int count = parse(sequence, notes, maxNotes);
+    if (count < 0)
+    {
+      printf("too many notes: \"%s\"\n", sequence);
+      failures++;
+      continue;
+    }
+
+    const char *variants[] = { upper, spaced };
+    for (int v = 0; v < 2; v++)
+    {
+      int variantCount = parse(variants[v], variant, maxNotes);
+      if (variantCount != count || !sameNotes(notes, variant, count))
+      {
+        printf("\"%s\" and \"%s\" differ\n", sequence, variants[v]);
+        failures++;
+      }
+    }
+  }
+
+  printf("%lu sequences (seed %u), %d failures\n", iterations, seed, failures);
+  return failures;
+}
+
+static void bench()
+{
+  static Note notes[MAX_NOTES];
+
+  printf("name,notes,ns_per_note\n");
+  for (unsigned int m = 0; m < sizeof(melodies) / sizeof(melodies[0]); m++)
+  {
+    int count = parse(melodies[m].sequence, notes, MAX_NOTES);
+    long repeats = 200000 / (count + 1) + 1;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long r = 0; r < repeats; r++)
+      parse(melodies[m].sequence, notes, MAX_NOTES);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%s,%d,%.1f\n", melodies[m].name, count, ns / repeats / (count ? count : 1));
+  }
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: ZumoBuzzerParserCheck (golden.txt | --write in.txt | "
+    "--fuzz n [seed] | --bench)\n");
+}
+
+int main(int argc, char **argv)
+{
+  signal(SIGFPE, crashed);
+  signal(SIGSEGV, crashed);
+
+  if (argc == 2 && !strcmp(argv[1], "--bench"))
+  {
+    bench();
+    return 0;
+  }
+
+  if ((argc == 3 || argc == 4) && !strcmp(argv[1], "--fuzz"))
+    return fuzz(strtoul(argv[2], 0, 10), argc == 4 ? strtoul(argv[3], 0, 10) : 1) ? 1 : 0;
+
+  bool write = argc == 3 && !strcmp(argv[1], "--write");
+  if (argc != 2 + write || argv[1 + write][0] == '-')
+  {
+    usage();
+    return 2;
+  }
+
+  const char *path = argv[1 + write];
+  FILE *file = fopen(path, "r");
+  if (!file)
+  {
+    fprintf(stderr, "could not read %s\n", path);
+    return 2;
+  }
+  int failures = checkGolden(file, write);
+  fclose(file);
+  return failures ? 1 : 0;
+}
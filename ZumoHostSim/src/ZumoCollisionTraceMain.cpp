@@ -0,0 +1,116 @@
+// main() for replaying recorded accelerometer readings through
+// ZumoCollisionDetector, so that its settings can be tried out on a computer.
+// Link it with ZumoCollisionDetector.cpp (no sketch is needed).
+//
+//   usage: ZumoCollisionTrace [options] (trace.csv | -)
+//
+//   --rate hz             rate the readings were taken at (default 200)
+//   --cutoff hz           high-pass filter cutoff frequency (default 5)
+//   --threshold n         collision threshold (default 150)
+//   --samples n           readings in a row over or under the threshold
+//                         (default 2)
+//   --model tau turn acc  motor model time constant in ms, turn limit, and
+//                         acceleration limit (default 100 100 50)
+//
+// Each line of the trace is one reading, "x,y,left,right": the x and y
+// components of acceleration and the speeds the motors were set to when it
+// was taken.  Lines starting with '#' are ignored, so a log written by the
+// SumoCollisionDetect example with LOG_SERIAL defined can be used directly.
+// Each collision is printed with the number of the reading it started at and
+// the time, followed by a summary.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ZumoCollisionDetector.h>
+
+static void usage()
+{
+  fprintf(stderr, "usage: ZumoCollisionTrace [--rate hz] [--cutoff hz] [--threshold n] "
+    "[--samples n] [--model tau turn acc] (trace.csv | -)\n");
+}
+
+int main(int argc, char **argv)
+{
+  ZumoCollisionDetector detector;
+  unsigned int rate = 200, threshold = 150, samples = 2;
+  unsigned int tau = 100, turnLimit = 100, accelLimit = 50;
+  const char *path = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+      rate = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--cutoff") && i + 1 < argc)
+      detector.setHighPass(atof(argv[++i]));
+    else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+      threshold = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+      samples = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--model") && i + 3 < argc)
+    {
+      tau = atoi(argv[++i]);
+      turnLimit = atoi(argv[++i]);
+      accelLimit = atoi(argv[++i]);
+    }
+    else if ((argv[i][0] != '-' || !strcmp(argv[i], "-")) && !path)
+      path = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (!path || rate == 0)
+  {
+    usage();
+    return 2;
+  }
+
+  FILE *file = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!file)
+  {
+    fprintf(stderr, "could not read %s\n", path);
+    return 1;
+  }
+
+  detector.setSampleRate(rate);
+  detector.setThreshold(threshold, samples);
+  detector.setMotorModel(tau, turnLimit, accelLimit);
+
+  char line[256];
+  unsigned long readings = 0, suppressed = 0;
+  boolean first = true;
+  while (fgets(line, sizeof(line), file))
+  {
+    int x, y, left, right;
+    if (line[0] == '#' || sscanf(line, "%d,%d,%d,%d", &x, &y, &left, &right) != 4)
+      continue;
+
+    detector.setMotorSpeeds(left, right);
+    if (first)
+    {
+      // assume the motors were already at the speeds of the first reading
+      detector.reset();
+      first = false;
+    }
+
+    if (detector.update(x, y))
+    {
+      printf("collision at reading %lu (%.3f s): magnitude %.0f\n", readings,
+        (double)readings / rate, sqrt((double)detector.getMagnitudeSquared()));
+    }
+    if (detector.isSuppressed())
+      suppressed++;
+    readings++;
+  }
+
+  if (file != stdin)
+    fclose(file);
+
+  printf("%lu readings (%.3f s), %u collisions, %lu readings ignored while "
+    "the Zumo was accelerating\n", readings, (double)readings / rate,
+    detector.getCollisionCount(), suppressed);
+  return 0;
+}
@@ -0,0 +1,748 @@
+// Host simulation of the Arduino core and the AVR peripherals used by the
+// Zumo libraries.  See ZumoSim.h for the control interface.
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <ZumoSim.h>
+
+#define CYCLES_PER_MICROSECOND (F_CPU / 1000000UL)
+
+// the pin change interrupts are not simulated, but the vectors the libraries
+// define are called when their timer overflows
+extern "C" void TIMER2_OVF_vect(void) __attribute__((weak));
+extern "C" void TIMER4_OVF_vect(void) __attribute__((weak));
+
+volatile uint8_t SREG;
+volatile uint8_t PINB, DDRB, PORTB;
+volatile uint8_t PINC, DDRC, PORTC;
+volatile uint8_t PIND, DDRD, PORTD;
+volatile uint8_t PINE, DDRE, PORTE;
+volatile uint8_t PINF, DDRF, PORTF;
+volatile uint8_t TCNT0;
+volatile uint8_t TCCR1A, TCCR1B;
+volatile uint16_t ICR1, OCR1A, OCR1B;
+ZumoSimFlagRegister TIFR1;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TIMSK2;
+ZumoSimFlagRegister TIFR2;
+volatile uint8_t TCCR4A, TCCR4B, TCCR4C, TCCR4D, TC4H, TIMSK4;
+ZumoSimTimer4Register OCR4C, OCR4D;
+ZumoSimFlagRegister TIFR4;
+
+ZumoSimSerial Serial;
+
+ZumoSimTimer4Register &ZumoSimTimer4Register::operator=(uint8_t low)
+{
+  value = ((uint16_t)(TC4H & 0x03) << 8) | low;
+  return *this;
+}
+
+ZumoSimTimer4Register::operator uint8_t() const
+{
+  TC4H = value >> 8;
+  return value & 0xFF;
+}
+
+
+// Pin map: port (PB..PF) and bit of each digital pin, as on the Uno or
+// Leonardo.
+struct PinInfo
+{
+  uint8_t port;
+  uint8_t bit;
+};
+
+#if defined(__AVR_ATmega32U4__)
+static const PinInfo pinInfo[NUM_DIGITAL_PINS] = {
+  {PD, 2}, {PD, 3}, {PD, 1}, {PD, 0}, {PD, 4}, {PC, 6}, {PD, 7}, {PE, 6},
+  {PB, 4}, {PB, 5}, {PB, 6}, {PB, 7}, {PD, 6}, {PC, 7}, {PB, 3}, {PB, 1},
+  {PB, 2}, {PB, 0}, {PF, 7}, {PF, 6}, {PF, 5}, {PF, 4}, {PF, 1}, {PF, 0},
+};
+#else
+static const PinInfo pinInfo[NUM_DIGITAL_PINS] = {
+  {PD, 0}, {PD, 1}, {PD, 2}, {PD, 3}, {PD, 4}, {PD, 5}, {PD, 6}, {PD, 7},
+  {PB, 0}, {PB, 1}, {PB, 2}, {PB, 3}, {PB, 4}, {PB, 5},
+  {PC, 0}, {PC, 1}, {PC, 2}, {PC, 3}, {PC, 4}, {PC, 5},
+};
+#endif
+
+#define PWM_L 10
+#define PWM_R 9
+#define DIR_L 8
+#define DIR_R 7
+#define BUTTON_PIN 12
+
+// scheduled changes to the external drive of a pin (e.g. button presses)
+#define MAX_PIN_EVENTS 32
+
+struct PinEvent
+{
+  unsigned long long cycle;
+  uint8_t pin;
+  uint8_t drive;
+};
+
+static unsigned long long cycles;
+static unsigned int callCycles = 64;
+static unsigned long timer2Phase, timer4Phase;
+static boolean stopRequested;
+static boolean sketchRunning;
+static unsigned long long sketchEnd;
+static sigjmp_buf sketchExit;
+
+static uint8_t pinDrive[NUM_DIGITAL_PINS];
+static unsigned long long dischargeStart[NUM_DIGITAL_PINS];  // 0: not charged
+static unsigned long dischargeCycles[NUM_DIGITAL_PINS];
+static int analogValue[NUM_DIGITAL_PINS];
+static int analogWriteValue[NUM_DIGITAL_PINS];
+static ZumoSimDischargeCallback dischargeCallback;
+
+static PinEvent pinEvents[MAX_PIN_EVENTS];
+static unsigned char pinEventCount;
+
+static ZumoSimStepCallback stepCallback;
+static unsigned long long stepPeriod, nextStep;
+
+static unsigned long randomState = 1;
+
+
+
+static volatile uint8_t *portRegister(uint8_t port, volatile uint8_t *b, volatile uint8_t *c,
+  volatile uint8_t *d, volatile uint8_t *e, volatile uint8_t *f)
+{
+  switch (port)
+  {
+    case PB: return b;
+    case PC: return c;
+    case PD: return d;
+    case PE: return e;
+    case PF: return f;
+    default: return 0;
+  }
+}
+
+uint8_t digitalPinToPort(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS ? pinInfo[pin].port : NOT_A_PORT;
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS ? 1 << pinInfo[pin].bit : 0;
+}
+
+volatile uint8_t *portOutputRegister(uint8_t port)
+{
+  return portRegister(port, &PORTB, &PORTC, &PORTD, &PORTE, &PORTF);
+}
+
+volatile uint8_t *portInputRegister(uint8_t port)
+{
+  return portRegister(port, &PINB, &PINC, &PIND, &PINE, &PINF);
+}
+
+volatile uint8_t *portModeRegister(uint8_t port)
+{
+  return portRegister(port, &DDRB, &DDRC, &DDRD, &DDRE, &DDRF);
+}
+
+static boolean outputLatch(uint8_t pin)
+{
+  return (*portOutputRegister(pinInfo[pin].port) & digitalPinToBitMask(pin)) != 0;
+}
+
+static boolean isOutputPin(uint8_t pin)
+{
+  return (*portModeRegister(pinInfo[pin].port) & digitalPinToBitMask(pin)) != 0;
+}
+
+// level of a pin as the MCU would read it right now
+static uint8_t pinLevel(uint8_t pin)
+{
+  if (isOutputPin(pin))
+    return outputLatch(pin);
+
+  switch (pinDrive[pin])
+  {
+    case ZUMO_SIM_DRIVE_LOW:
+      return LOW;
+    case ZUMO_SIM_DRIVE_HIGH:
+      return HIGH;
+    case ZUMO_SIM_RC:
+      return dischargeStart[pin] != 0 && cycles - dischargeStart[pin] < dischargeCycles[pin];
+    default:
+      return outputLatch(pin); // pull-up
+  }
+}
+
+// Brings the PINx registers up to date so code reading them directly sees the
+// simulated levels.  The levels only change when a port or data direction
+// register is written, an external drive changes, or an RC sensor finishes
+// discharging, so the work is skipped until one of those happens.
+static volatile uint8_t *const portRegisters[] = {
+  &PORTB, &PORTC, &PORTD, &PORTE, &PORTF, &DDRB, &DDRC, &DDRD, &DDRE, &DDRF };
+static uint8_t lastPortValues[sizeof(portRegisters) / sizeof(portRegisters[0])];
+static unsigned long long inputsValidUntil;   // 0: out of date
+
+static void updateInputRegisters()
+{
+  boolean portsChanged = false;
+  for (uint8_t i = 0; i < sizeof(portRegisters) / sizeof(portRegisters[0]); i++)
+  {
+    if (*portRegisters[i] != lastPortValues[i])
+    {
+      lastPortValues[i] = *portRegisters[i];
+      portsChanged = true;
+    }
+  }
+  if (!portsChanged && cycles < inputsValidUntil)
+    return;
+
+  PINB = PINC = PIND = PINE = PINF = 0;
+  inputsValidUntil = ~0ULL;
+  for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++)
+  {
+    if (pinLevel(pin))
+    {
+      *portInputRegister(pinInfo[pin].port) |= digitalPinToBitMask(pin);
+
+      if (!isOutputPin(pin) && pinDrive[pin] == ZUMO_SIM_RC)
+        inputsValidUntil = min(inputsValidUntil, dischargeStart[pin] + dischargeCycles[pin]);
+    }
+  }
+}
+
+// Timer2 runs in phase-correct PWM mode, so it overflows every
+// 2 * TOP * prescaler cycles, with TOP = OCR2A in mode 5 (WGM22 set).
+static unsigned long timer2Period()
+{
+  static const unsigned int prescalers[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+  unsigned int prescaler = prescalers[TCCR2B & 0x07];
+  unsigned int top = (TCCR2B & (1 << WGM22)) ? OCR2A : 0xFF;
+
+  if (prescaler == 0 || top == 0)
+    return 0;
+  return 2UL * top * prescaler;
+}
+
+// Timer4 runs in phase- and frequency-correct PWM mode with TOP = OCR4C;
+// clock select n divides the clock by 2^(n-1).
+static unsigned long timer4Period()
+{
+  uint8_t cs = TCCR4B & 0x0F;
+  if (cs == 0 || OCR4C.value == 0)
+    return 0;
+  return 2UL * OCR4C.value << (cs - 1);
+}
+
+static void callInterrupt(void (*vector)(void))
+{
+  uint8_t oldSREG = SREG;
+  SREG &= ~(1 << SREG_I);  // interrupts are disabled on entry...
+  vector();
+  SREG = oldSREG | (1 << SREG_I);  // ...and enabled again by reti
+}
+
+static void serviceInterrupts()
+{
+  if (!(SREG & (1 << SREG_I)))
+    return;
+
+  if ((TIFR2 & (1 << TOV2)) && (TIMSK2 & (1 << TOIE2)) && TIMER2_OVF_vect)
+  {
+    TIFR2 = 1 << TOV2;
+    callInterrupt(TIMER2_OVF_vect);
+  }
+  if ((TIFR4 & (1 << TOV4)) && (TIMSK4 & (1 << TOIE4)) && TIMER4_OVF_vect)
+  {
+    TIFR4 = 1 << TOV4;
+    callInterrupt(TIMER4_OVF_vect);
+  }
+}
+
+static void runPinEvents()
+{
+  while (pinEventCount > 0 && pinEvents[0].cycle <= cycles)
+  {
+    ZumoSim::setPinDrive(pinEvents[0].pin, pinEvents[0].drive);
+    pinEventCount--;
+    memmove(&pinEvents[0], &pinEvents[1], pinEventCount * sizeof(PinEvent));
+  }
+}
+
+// Returns the number of cycles until the next timer overflow, scheduled pin
+// event, or step callback, but no more than limit.
+static unsigned long long cyclesToNextEvent(unsigned long long limit)
+{
+  unsigned long long step = limit;
+  unsigned long period2 = timer2Period();
+  unsigned long period4 = timer4Period();
+
+  if (period2)
+    step = min(step, period2 > timer2Phase ? period2 - timer2Phase : 0);
+  if (period4)
+    step = min(step, period4 > timer4Phase ? period4 - timer4Phase : 0);
+  if (pinEventCount > 0)
+    step = min(step, pinEvents[0].cycle > cycles ? pinEvents[0].cycle - cycles : 0);
+  if (stepCallback)
+    step = min(step, nextStep > cycles ? nextStep - cycles : 0);
+  return step;
+}
+
+// Moves virtual time forward, stopping at each event along the way.
+static void advance(unsigned long long n)
+{
+  unsigned long long end = cycles + n;
+
+  while (cycles < end)
+  {
+    unsigned long period2 = timer2Period();
+    unsigned long period4 = timer4Period();
+    unsigned long long step = cyclesToNextEvent(end - cycles);
+
+    cycles += step;
+    TCNT0 = cycles / 64;
+
+    if (period2 && (timer2Phase += step) >= period2)
+    {
+      timer2Phase = 0;
+      TIFR2.set(1 << TOV2);
+    }
+    if (period4 && (timer4Phase += step) >= period4)
+    {
+      timer4Phase = 0;
+      TIFR4.set(1 << TOV4);
+    }
+
+    runPinEvents();
+
+    if (stepCallback && cycles >= nextStep)
+    {
+      nextStep += stepPeriod;
+      stepCallback();
+    }
+
+    serviceInterrupts();
+  }
+
+  updateInputRegisters();
+  serviceInterrupts();  // in case interrupts were just enabled
+
+  // end the sketch even if it is stuck in a loop inside setup() or loop()
+  if (sketchRunning && (stopRequested || cycles >= sketchEnd))
+  {
+    siglongjmp(sketchExit, 1);
+  }
+}
+
+// Every call to pinMode(), digitalWrite(), digitalRead(), millis(), and
+// micros(), and every return from loop(), takes callCycles.  Nothing else
+// moves time forward (apart from delay(), delayMicroseconds(), and
+// analogRead()), so a run does not depend on how fast the host is.
+static inline void charge()
+{
+  advance(callCycles);
+}
+
+
+// Arduino core
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  charge();
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+
+  volatile uint8_t *ddr = portModeRegister(pinInfo[pin].port);
+  volatile uint8_t *port = portOutputRegister(pinInfo[pin].port);
+  uint8_t mask = digitalPinToBitMask(pin);
+
+  if (mode == OUTPUT)
+  {
+    *ddr |= mask;
+    dischargeStart[pin] = 0;
+  }
+  else
+  {
+    // releasing a charged RC sensor pin starts its discharge
+    if (isOutputPin(pin) && outputLatch(pin) && pinDrive[pin] == ZUMO_SIM_RC)
+    {
+      if (dischargeCallback)
+        dischargeCycles[pin] = (unsigned long)dischargeCallback(pin) * CYCLES_PER_MICROSECOND;
+      dischargeStart[pin] = cycles;
+      inputsValidUntil = 0;
+    }
+
+    *ddr &= ~mask;
+    if (mode == INPUT_PULLUP)
+      *port |= mask;
+    else
+      *port &= ~mask;
+  }
+  updateInputRegisters();
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  charge();
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+
+  volatile uint8_t *port = portOutputRegister(pinInfo[pin].port);
+  if (val == LOW)
+    *port &= ~digitalPinToBitMask(pin);
+  else
+    *port |= digitalPinToBitMask(pin);
+  analogWriteValue[pin] = -1;
+  updateInputRegisters();
+}
+
+int digitalRead(uint8_t pin)
+{
+  charge();
+  if (pin >= NUM_DIGITAL_PINS)
+    return LOW;
+  return pinLevel(pin);
+}
+
+int analogRead(uint8_t pin)
+{
+  advance(100 * CYCLES_PER_MICROSECOND);  // a conversion takes about 100 us
+  if (pin < A0)
+    pin += A0;
+  return pin < NUM_DIGITAL_PINS ? analogValue[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+  pinMode(pin, OUTPUT);
+  if (pin < NUM_DIGITAL_PINS)
+  {
+    digitalWrite(pin, val < 128 ? LOW : HIGH);
+    analogWriteValue[pin] = val;
+  }
+}
+
+unsigned long millis()
+{
+  charge();
+  return cycles / (F_CPU / 1000);
+}
+
+unsigned long micros()
+{
+  charge();
+  return cycles / CYCLES_PER_MICROSECOND;
+}
+
+void delay(unsigned long ms)
+{
+  advance((unsigned long long)ms * (F_CPU / 1000));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  advance((unsigned long long)us * CYCLES_PER_MICROSECOND);
+}
+
+// a fixed linear congruential generator, so runs are repeatable on any host
+long random(long howbig)
+{
+  if (howbig == 0)
+    return 0;
+  randomState = randomState * 1103515245UL + 12345;
+  return ((randomState >> 1) & 0x7FFFFFFF) % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned int seed)
+{
+  if (seed != 0)
+    randomState = seed;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+
+// Serial
+
+void ZumoSimSerial::flush()
+{
+  fflush(stdout);
+}
+
+size_t ZumoSimSerial::write(uint8_t c)
+{
+  putchar(c);
+  return 1;
+}
+
+size_t ZumoSimSerial::print(const char *s)
+{
+  return fputs(s, stdout) >= 0 ? strlen(s) : 0;
+}
+
+size_t ZumoSimSerial::print(char c)
+{
+  return write(c);
+}
+
+size_t ZumoSimSerial::print(long n, int base)
+{
+  if (n < 0 && base == DEC)
+    return print('-') + print((unsigned long)-n, base);
+  return print((unsigned long)n, base);
+}
+
+size_t ZumoSimSerial::print(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  if (base < 2)
+    base = 10;
+  *str = '\0';
+  do
+  {
+    unsigned long digit = n % base;
+    n /= base;
+    *--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while (n);
+
+  return print(str);
+}
+
+size_t ZumoSimSerial::print(double n, int digits)
+{
+  return printf("%.*f", digits, n);
+}
+
+
+// ZumoSim
+
+void ZumoSim::reset()
+{
+  cycles = 0;
+  timer2Phase = timer4Phase = 0;
+  stopRequested = false;
+
+  SREG = 0;
+  PORTB = PORTC = PORTD = PORTE = PORTF = 0;
+  DDRB = DDRC = DDRD = DDRE = DDRF = 0;
+  TCNT0 = 0;
+  TCCR1A = TCCR1B = 0;
+  ICR1 = OCR1A = OCR1B = 0;
+  TIFR1 = 0xFF;
+  TCCR2A = TCCR2B = OCR2A = OCR2B = TIMSK2 = 0;
+  TIFR2 = 0xFF;
+  TCCR4A = TCCR4B = TCCR4C = TCCR4D = TC4H = TIMSK4 = 0;
+  OCR4C.value = OCR4D.value = 0;
+  TIFR4 = 0xFF;
+
+  for (uint8_t pin = 0; pin < NUM_DIGITAL_PINS; pin++)
+  {
+    pinDrive[pin] = ZUMO_SIM_FLOATING;
+    dischargeStart[pin] = 0;
+    dischargeCycles[pin] = 0;
+    analogValue[pin] = 0;
+    analogWriteValue[pin] = -1;
+  }
+  dischargeCallback = 0;
+  pinEventCount = 0;
+  stepCallback = 0;
+  randomState = 1;
+
+  inputsValidUntil = 0;
+  updateInputRegisters();
+}
+
+unsigned long long ZumoSim::getCycles()
+{
+  return cycles;
+}
+
+unsigned long long ZumoSim::getMicros()
+{
+  return cycles / CYCLES_PER_MICROSECOND;
+}
+
+// Jumps straight to the given time without running the timers or callbacks
+// for the skipped interval; the time can also be moved backwards.
+void ZumoSim::setMicros(unsigned long long us)
+{
+  cycles = us * CYCLES_PER_MICROSECOND;
+  TCNT0 = cycles / 64;
+  inputsValidUntil = 0;
+  nextStep = cycles + stepPeriod;
+  updateInputRegisters();
+}
+
+void ZumoSim::advanceMicros(unsigned long us)
+{
+  advance((unsigned long long)us * CYCLES_PER_MICROSECOND);
+}
+
+void ZumoSim::advanceCycles(unsigned long n)
+{
+  advance(n);
+}
+
+void ZumoSim::setCallCycles(unsigned int n)
+{
+  callCycles = n;
+}
+
+void ZumoSim::setPinDrive(uint8_t pin, uint8_t drive)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  pinDrive[pin] = drive;
+  inputsValidUntil = 0;
+  updateInputRegisters();
+}
+
+void ZumoSim::setDischargeMicros(uint8_t pin, unsigned int us)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  pinDrive[pin] = ZUMO_SIM_RC;
+  dischargeCycles[pin] = (unsigned long)us * CYCLES_PER_MICROSECOND;
+  inputsValidUntil = 0;
+}
+
+void ZumoSim::setDischargeCallback(ZumoSimDischargeCallback callback)
+{
+  dischargeCallback = callback;
+}
+
+void ZumoSim::setAnalogValue(uint8_t pin, int value)
+{
+  if (pin < A0)
+    pin += A0;
+  if (pin < NUM_DIGITAL_PINS)
+    analogValue[pin] = value;
+}
+
+// Schedules a change to a pin's external drive; events at the same time run
+// in the order they were added.
+void ZumoSim::setPinDriveAt(unsigned long long us, uint8_t pin, uint8_t drive)
+{
+  if (pinEventCount >= MAX_PIN_EVENTS)
+    return;
+
+  unsigned long long at = us * CYCLES_PER_MICROSECOND;
+  unsigned char i = pinEventCount;
+  while (i > 0 && pinEvents[i - 1].cycle > at)
+  {
+    pinEvents[i] = pinEvents[i - 1];
+    i--;
+  }
+  pinEvents[i].cycle = at;
+  pinEvents[i].pin = pin;
+  pinEvents[i].drive = drive;
+  pinEventCount++;
+}
+
+uint8_t ZumoSim::getPinLevel(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS ? pinLevel(pin) : LOW;
+}
+
+boolean ZumoSim::isOutput(uint8_t pin)
+{
+  return pin < NUM_DIGITAL_PINS && isOutputPin(pin);
+}
+
+void ZumoSim::pressButtonAt(unsigned long long us, unsigned long durationMicros)
+{
+  setPinDriveAt(us, BUTTON_PIN, ZUMO_SIM_DRIVE_LOW);
+  setPinDriveAt(us + durationMicros, BUTTON_PIN, ZUMO_SIM_FLOATING);
+}
+
+// Works out the speed a motor driver channel sees: the duty cycle of the PWM
+// pin scaled to 400 and negated if the direction pin is high.  The PWM comes
+// from Timer1 if its output is connected to the pin, otherwise from the last
+// analogWrite().
+static int motorSpeed(uint8_t pwmPin, uint8_t dirPin, uint8_t comBit, uint16_t compare)
+{
+  int speed;
+
+  if (!isOutputPin(pwmPin))
+    return 0;
+
+  if ((TCCR1A & (1 << comBit)) && ICR1 != 0)
+    speed = (unsigned long)min(compare, ICR1) * 400 / ICR1;
+  else if (analogWriteValue[pwmPin] >= 0)
+    speed = ((long)analogWriteValue[pwmPin] * 400 + 127) / 255;
+  else
+    speed = outputLatch(pwmPin) ? 400 : 0;
+
+  return pinLevel(dirPin) ? -speed : speed;
+}
+
+int ZumoSim::getLeftMotorSpeed()
+{
+  return motorSpeed(PWM_L, DIR_L, COM1B1, OCR1B);
+}
+
+int ZumoSim::getRightMotorSpeed()
+{
+  return motorSpeed(PWM_R, DIR_R, COM1A1, OCR1A);
+}
+
+unsigned int ZumoSim::getBuzzerFrequency()
+{
+#if defined(__AVR_ATmega32U4__)
+  unsigned long period = timer4Period();
+  if (period == 0 || OCR4D.value == 0)
+    return 0;
+#else
+  unsigned long period = timer2Period();
+  if (period == 0 || OCR2B == 0)
+    return 0;
+#endif
+  return (F_CPU + period / 2) / period;
+}
+
+void ZumoSim::setStepCallback(ZumoSimStepCallback callback, unsigned long periodMicros)
+{
+  stepCallback = periodMicros ? callback : 0;
+  stepPeriod = (unsigned long long)periodMicros * CYCLES_PER_MICROSECOND;
+  nextStep = cycles + stepPeriod;
+}
+
+// Calls setup() and then loop() repeatedly.  When the time limit is reached
+// or stop() is called, the sketch is abandoned wherever it is (destructors of
+// its local objects are not run).
+void ZumoSim::runSketch(unsigned long long untilMicros)
+{
+  sketchEnd = untilMicros * CYCLES_PER_MICROSECOND;
+  stopRequested = false;
+
+  if (cycles < sketchEnd && sigsetjmp(sketchExit, 1) == 0)
+  {
+    sketchRunning = true;
+    sei();  // the Arduino core enables interrupts before calling setup()
+    setup();
+    while (1)
+    {
+      loop();
+      charge();  // the core's main loop between calls to loop()
+    }
+  }
+
+  sketchRunning = false;
+}
+
+void ZumoSim::stop()
+{
+  stopRequested = true;
+}
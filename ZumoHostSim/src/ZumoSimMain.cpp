@@ -0,0 +1,23 @@
+// Optional main() for running a sketch on the host: links against the
+// sketch's setup() and loop() and runs them for a number of virtual seconds.
+//
+//   usage: sketch [seconds] [button press time in ms]...
+//
+// Each button press time presses the user pushbutton (pin 12) for 100 ms, so
+// sketches that wait for the button can get going.
+
+#include <stdio.h>
+#include <ZumoSim.h>
+
+int main(int argc, char **argv)
+{
+  unsigned long seconds = argc > 1 ? strtoul(argv[1], 0, 10) : 10;
+
+  ZumoSim::reset();
+  for (int i = 2; i < argc; i++)
+    ZumoSim::pressButtonAt(strtoull(argv[i], 0, 10) * 1000);
+
+  ZumoSim::runSketch(seconds * 1000000ULL);
+  Serial.flush();
+  return 0;
+}
@@ -0,0 +1,489 @@
+// 2D line track for the host simulation.  See ZumoTrackSim.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <ZumoTrackSim.h>
+
+#define STEP_MICROS 1000
+#define LINE_WIDTH 19.05          // 3/4" electrical tape, mm
+#define DARK 128                  // reflectance below which a pixel is line
+#define LINE_WINDOW 60            // mm to each side of the array searched for the line
+#define LAP_RADIUS 40             // mm from the start that completes a lap...
+#define LAP_ARM_DISTANCE 200      // ...after getting at least this far away
+#define FORWARD_FRACTION 0.2      // of maxSpeed: slower than this is not line following
+
+static uint8_t *image;            // reflectance, 0 (black) to 255 (white)
+static int imageWidth, imageHeight;
+static float mmPerPixel = 1;
+
+static ZumoTrackSimRobot robotParams = { 600, 86, 0.05, 45, 12.7, 150, 2500 };
+
+static float startX, startY, startHeading;
+static float x, y, heading;       // heading in radians
+static float leftVelocity, rightVelocity;
+
+static uint8_t sensorPins[6];
+
+static unsigned long autoPressMillis = 1000;
+static unsigned long stillMillis;
+static boolean pressedWhileStill;
+
+static FILE *traceFile;
+static unsigned long tracePeriod = 10, traceCountdown;
+
+static FILE *reportFile;
+static ZumoTrackSimRun run;
+static unsigned int runNumber;
+static boolean runActive;
+static boolean lapArmed;
+static float lapStartTime;
+static double squaredErrorSum;
+static unsigned long errorSamples;
+static boolean lineWasVisible;
+static float offLineDuration;      // s since the line was last visible
+static float lastCrossTrackError;
+
+
+static float now()
+{
+  return ZumoSim::getMicros() / 1e6;
+}
+
+// reflectance at a point, interpolated between pixels; off the image is white
+static float reflectance(float px, float py)
+{
+  px = px / mmPerPixel - 0.5;
+  py = py / mmPerPixel - 0.5;
+  int ix = (int)floor(px), iy = (int)floor(py);
+  float fx = px - ix, fy = py - iy;
+  float sum = 0;
+
+  for (int dy = 0; dy < 2; dy++)
+  {
+    for (int dx = 0; dx < 2; dx++)
+    {
+      int cx = ix + dx, cy = iy + dy;
+      float value = 255;
+      if (cx >= 0 && cy >= 0 && cx < imageWidth && cy < imageHeight)
+        value = image[cy * imageWidth + cx];
+      sum += value * (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy);
+    }
+  }
+  return sum;
+}
+
+// point under the sensor array at the given lateral offset (mm, positive to
+// the right of the Zumo)
+static void arrayPoint(float lateral, float *px, float *py)
+{
+  float c = cos(heading), s = sin(heading);
+  *px = x + c * robotParams.sensorOffset + s * lateral;
+  *py = y - s * robotParams.sensorOffset + c * lateral;
+}
+
+// sensor 0 is on the left and sensor 5 on the right, as in readLine()
+static float sensorReflectance(uint8_t sensor)
+{
+  float px, py;
+  arrayPoint((sensor - 2.5) * robotParams.sensorPitch, &px, &py);
+  return reflectance(px, py);
+}
+
+static unsigned int discharge(uint8_t pin)
+{
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    if (sensorPins[i] == pin)
+    {
+      float r = sensorReflectance(i);
+      return robotParams.whiteMicros +
+        (unsigned int)((255 - r) * (robotParams.blackMicros - robotParams.whiteMicros) / 255);
+    }
+  }
+  return robotParams.whiteMicros;
+}
+
+// Lateral position of the line relative to the center of the sensor array
+// (positive to the right): the centroid of the stretch of dark pixels along
+// the array that is closest to its center.  Returns false if there is no line
+// within LINE_WINDOW, or if the stretch is wider than two line widths or
+// runs off the end of the window, since then the array is crossing an
+// intersection or the finish area and the error is not meaningful.
+static boolean crossTrackError(float *error)
+{
+  boolean found = false, valid = false;
+  float closest = 0, sum = 0, weightSum = 0;
+  int runStart = 0;
+
+  for (int lateral = -LINE_WINDOW; lateral <= LINE_WINDOW + 1; lateral++)
+  {
+    float px, py, r = 255;
+    if (lateral <= LINE_WINDOW)
+    {
+      arrayPoint(lateral, &px, &py);
+      r = reflectance(px, py);
+    }
+
+    if (r < DARK)
+    {
+      if (weightSum == 0)
+        runStart = lateral;
+      sum += (255 - r) * lateral;
+      weightSum += 255 - r;
+    }
+    else if (weightSum != 0)
+    {
+      // end of a dark stretch
+      float center = sum / weightSum;
+      if (!found || fabs(center) < fabs(closest))
+      {
+        found = true;
+        closest = center;
+        valid = runStart > -LINE_WINDOW && lateral <= LINE_WINDOW &&
+          lateral - runStart <= 2 * LINE_WIDTH;
+      }
+      sum = weightSum = 0;
+    }
+  }
+
+  *error = closest;
+  return valid;
+}
+
+static void endRun()
+{
+  run.duration = now() - run.startTime;
+  run.rmsCrossTrackError = errorSamples ? sqrt(squaredErrorSum / errorSamples) : 0;
+  runActive = false;
+  ZumoTrackSim::printReport();
+}
+
+static void startRun()
+{
+  memset(&run, 0, sizeof(run));
+  run.startTime = lapStartTime = now();
+  runNumber++;
+  runActive = true;
+  lapArmed = false;
+  squaredErrorSum = 0;
+  errorSamples = 0;
+  lineWasVisible = true;
+  offLineDuration = 0;
+}
+
+static void updateStatistics(float dt)
+{
+  float speed = (leftVelocity + rightVelocity) / 2;
+  run.distance += fabs(speed) * dt;
+
+  // laps: back near the start after having gone some distance away
+  float distanceFromStart = hypot(x - startX, y - startY);
+  if (distanceFromStart > LAP_ARM_DISTANCE)
+    lapArmed = true;
+  else if (lapArmed && distanceFromStart < LAP_RADIUS)
+  {
+    lapArmed = false;
+    run.laps++;
+    run.lastLapTime = now() - lapStartTime;
+    if (run.bestLapTime == 0 || run.lastLapTime < run.bestLapTime)
+      run.bestLapTime = run.lastLapTime;
+    lapStartTime = now();
+    if (reportFile)
+      fprintf(reportFile, "run %u: lap %u: %.3f s\n", runNumber, run.laps, run.lastLapTime);
+  }
+
+  boolean lineVisible = false;
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    if (sensorReflectance(i) < DARK)
+      lineVisible = true;
+  }
+
+  // time off the line, whether or not the Zumo is driving forward
+  if (lineVisible)
+    offLineDuration = 0;
+  else
+  {
+    offLineDuration += dt;
+    run.offLineTime += dt;
+    if (offLineDuration > run.longestOffLineTime)
+      run.longestOffLineTime = offLineDuration;
+  }
+
+  if (speed < FORWARD_FRACTION * robotParams.maxSpeed)
+    return;
+
+  float error;
+  if (crossTrackError(&error))
+  {
+    lastCrossTrackError = error;
+    squaredErrorSum += error * error;
+    errorSamples++;
+    if (fabs(error) > run.maxCrossTrackError)
+      run.maxCrossTrackError = fabs(error);
+  }
+
+  if (lineWasVisible && !lineVisible)
+    run.lineLosses++;
+  lineWasVisible = lineVisible;
+}
+
+// called every STEP_MICROS of virtual time
+static void step()
+{
+  const float dt = STEP_MICROS / 1e6;
+  int leftSpeed = ZumoSim::getLeftMotorSpeed();
+  int rightSpeed = ZumoSim::getRightMotorSpeed();
+
+  // motors: first-order response to the commanded speed
+  float response = 1 - exp(-dt / robotParams.motorTimeConstant);
+  leftVelocity += (leftSpeed * robotParams.maxSpeed / 400 - leftVelocity) * response;
+  rightVelocity += (rightSpeed * robotParams.maxSpeed / 400 - rightVelocity) * response;
+
+  // differential drive (y is down, so a counterclockwise turn decreases y)
+  float speed = (leftVelocity + rightVelocity) / 2;
+  heading += (rightVelocity - leftVelocity) / robotParams.trackWidth * dt;
+  x += speed * cos(heading) * dt;
+  y -= speed * sin(heading) * dt;
+
+  if (leftSpeed != 0 || rightSpeed != 0)
+  {
+    stillMillis = 0;
+    pressedWhileStill = false;
+    if (!runActive)
+      startRun();
+  }
+  else
+    stillMillis++;
+
+  if (runActive)
+    updateStatistics(dt);
+
+  unsigned long stopMillis = autoPressMillis ? autoPressMillis : 1000;
+  if (runActive && stillMillis >= stopMillis)
+    endRun();
+
+  if (autoPressMillis && stillMillis >= autoPressMillis && !pressedWhileStill)
+  {
+    pressedWhileStill = true;
+    x = startX;
+    y = startY;
+    heading = startHeading;
+    leftVelocity = rightVelocity = 0;
+    ZumoSim::pressButtonAt(ZumoSim::getMicros());
+  }
+
+  if (traceFile && --traceCountdown == 0)
+  {
+    traceCountdown = tracePeriod;
+    fprintf(traceFile, "%lu,%.1f,%.1f,%.1f,%d,%d,%.1f\n",
+      (unsigned long)(ZumoSim::getMicros() / 1000), x, y, heading * RAD_TO_DEG,
+      leftSpeed, rightSpeed, lastCrossTrackError);
+  }
+}
+
+static int readPgmNumber(FILE *file)
+{
+  int c = fgetc(file);
+  while (c == '#' || isspace(c))
+  {
+    if (c == '#')
+    {
+      while (c != '\n' && c != EOF)
+        c = fgetc(file);
+    }
+    c = fgetc(file);
+  }
+
+  int value = -1;
+  while (c != EOF && isdigit(c))
+  {
+    value = (value < 0 ? 0 : value * 10) + c - '0';
+    c = fgetc(file);
+  }
+  return value;
+}
+
+boolean ZumoTrackSim::loadPgm(const char *filename, float scale)
+{
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return false;
+
+  char magic[3] = { 0 };
+  boolean ok = fread(magic, 1, 2, file) == 2 && magic[0] == 'P' &&
+    (magic[1] == '2' || magic[1] == '5');
+  int width = ok ? readPgmNumber(file) : -1;
+  int height = ok ? readPgmNumber(file) : -1;
+  int maxValue = ok ? readPgmNumber(file) : -1;
+
+  if (width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535)
+  {
+    fclose(file);
+    return false;
+  }
+
+  uint8_t *pixels = (uint8_t *)malloc((size_t)width * height);
+  for (long i = 0; ok && i < (long)width * height; i++)
+  {
+    int value;
+    if (magic[1] == '2')
+      value = readPgmNumber(file);
+    else if (maxValue < 256)
+      value = fgetc(file);
+    else
+    {
+      int high = fgetc(file);
+      value = (high << 8) | fgetc(file);
+    }
+
+    if (value < 0)
+      ok = false;
+    else
+      pixels[i] = (long)value * 255 / maxValue;
+  }
+  fclose(file);
+
+  if (!ok)
+  {
+    free(pixels);
+    return false;
+  }
+
+  free(image);
+  image = pixels;
+  imageWidth = width;
+  imageHeight = height;
+  mmPerPixel = scale;
+  setStartPose(width * scale / 2, height * scale / 2, 0);
+  return true;
+}
+
+void ZumoTrackSim::generateOval(float straightLength, float radius)
+{
+  const float margin = 100;
+  mmPerPixel = 1;
+  imageWidth = (int)(straightLength + 2 * (radius + margin));
+  imageHeight = (int)(2 * (radius + margin));
+  free(image);
+  image = (uint8_t *)malloc((size_t)imageWidth * imageHeight);
+
+  float left = margin + radius, right = left + straightLength;
+  float centerY = margin + radius;
+
+  for (int py = 0; py < imageHeight; py++)
+  {
+    for (int px = 0; px < imageWidth; px++)
+    {
+      // distance from the pixel center to the centerline of the track
+      float cx = px + 0.5, cy = py + 0.5;
+      float d;
+      if (cx < left)
+        d = fabs(hypot(cx - left, cy - centerY) - radius);
+      else if (cx > right)
+        d = fabs(hypot(cx - right, cy - centerY) - radius);
+      else
+        d = fabs(fabs(cy - centerY) - radius);
+      image[py * imageWidth + px] = d < LINE_WIDTH / 2 ? 0 : 255;
+    }
+  }
+
+  setStartPose((left + right) / 2 - robotParams.sensorOffset, centerY + radius, 0);
+}
+
+void ZumoTrackSim::setStartPose(float px, float py, float headingDegrees)
+{
+  startX = x = px;
+  startY = y = py;
+  startHeading = heading = headingDegrees * DEG_TO_RAD;
+}
+
+ZumoTrackSimRobot *ZumoTrackSim::robot()
+{
+  return &robotParams;
+}
+
+void ZumoTrackSim::setAutoPress(unsigned long ms)
+{
+  autoPressMillis = ms;
+}
+
+void ZumoTrackSim::setTrace(FILE *file, unsigned long periodMillis)
+{
+  traceFile = file;
+  tracePeriod = traceCountdown = periodMillis ? periodMillis : 1;
+  if (traceFile)
+    fprintf(traceFile, "time_ms,x_mm,y_mm,heading_deg,left,right,cross_track_mm\n");
+}
+
+void ZumoTrackSim::setReportFile(FILE *file)
+{
+  reportFile = file;
+}
+
+void ZumoTrackSim::begin()
+{
+  // the pins ZumoReflectanceSensorArray::init() uses by default
+  const uint8_t pins[6] = { 4, A3, 11, A0, A2, 5 };
+
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    sensorPins[i] = pins[i];
+    ZumoSim::setDischargeMicros(pins[i], robotParams.whiteMicros);
+  }
+  ZumoSim::setDischargeCallback(discharge);
+  ZumoSim::setStepCallback(step, STEP_MICROS);
+
+  x = startX;
+  y = startY;
+  heading = startHeading;
+  leftVelocity = rightVelocity = 0;
+  stillMillis = 0;
+  pressedWhileStill = false;
+  runActive = false;
+  runNumber = 0;
+}
+
+void ZumoTrackSim::printReport()
+{
+  if (!reportFile || runNumber == 0)
+    return;
+
+  ZumoTrackSimRun r = run;
+  if (runActive)
+  {
+    r.duration = now() - r.startTime;
+    r.rmsCrossTrackError = errorSamples ? sqrt(squaredErrorSum / errorSamples) : 0;
+  }
+
+  fprintf(reportFile, "run %u: %.3f s%s, %.0f mm, %u laps", runNumber, r.duration,
+    runActive ? " (still running)" : "", r.distance, r.laps);
+  if (r.laps)
+    fprintf(reportFile, " (last %.3f s, best %.3f s)", r.lastLapTime, r.bestLapTime);
+  fprintf(reportFile, ", cross-track error %.1f mm RMS / %.1f mm max, %u line losses",
+    r.rmsCrossTrackError, r.maxCrossTrackError, r.lineLosses);
+  fprintf(reportFile, ", %.3f s off the line (longest %.3f s)\n", r.offLineTime,
+    r.longestOffLineTime);
+}
+
+float ZumoTrackSim::getX()
+{
+  return x;
+}
+
+float ZumoTrackSim::getY()
+{
+  return y;
+}
+
+float ZumoTrackSim::getHeading()
+{
+  return heading * RAD_TO_DEG;
+}
+
+const ZumoTrackSimRun *ZumoTrackSim::currentRun()
+{
+  return &run;
+}
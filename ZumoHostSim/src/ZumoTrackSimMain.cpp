@@ -0,0 +1,97 @@
+// main() for running a line following sketch on a simulated track.  Link it
+// (instead of ZumoSimMain.cpp) with the sketch, ZumoHostSim.cpp and
+// ZumoTrackSim.cpp.
+//
+//   usage: sketch [options] (track.pgm | --oval)
+//
+//   --time s              virtual seconds to run (default 60)
+//   --scale mm            millimeters per pixel of the image (default 1)
+//   --start x y heading   start pose in mm and degrees (default: the image
+//                         center facing right; --oval sets its own)
+//   --speed mm_per_s      speed at a motor speed of 400 (default 600)
+//   --auto-press ms       press the button after standing still this long
+//                         (default 1000, 0 disables)
+//   --trace file.csv      write the pose every 10 ms
+
+#include <stdio.h>
+#include <string.h>
+#include <ZumoTrackSim.h>
+
+static void usage()
+{
+  fprintf(stderr, "usage: sketch [--time s] [--scale mm] [--start x y heading] "
+    "[--speed mm_per_s] [--auto-press ms] [--trace file.csv] (track.pgm | --oval)\n");
+}
+
+int main(int argc, char **argv)
+{
+  float seconds = 60, scale = 1;
+  float startX = 0, startY = 0, startHeading = 0;
+  boolean startGiven = false, oval = false;
+  const char *track = 0, *trace = 0;
+
+  ZumoSim::reset();
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--time") && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+      scale = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--start") && i + 3 < argc)
+    {
+      startX = atof(argv[++i]);
+      startY = atof(argv[++i]);
+      startHeading = atof(argv[++i]);
+      startGiven = true;
+    }
+    else if (!strcmp(argv[i], "--speed") && i + 1 < argc)
+      ZumoTrackSim::robot()->maxSpeed = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--auto-press") && i + 1 < argc)
+      ZumoTrackSim::setAutoPress(atol(argv[++i]));
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      trace = argv[++i];
+    else if (!strcmp(argv[i], "--oval"))
+      oval = true;
+    else if (argv[i][0] != '-' && !track)
+      track = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (oval)
+    ZumoTrackSim::generateOval();
+  else if (!track)
+  {
+    usage();
+    return 2;
+  }
+  else if (!ZumoTrackSim::loadPgm(track, scale))
+  {
+    fprintf(stderr, "could not read PGM image %s\n", track);
+    return 1;
+  }
+
+  if (startGiven)
+    ZumoTrackSim::setStartPose(startX, startY, startHeading);
+
+  FILE *traceFile = 0;
+  if (trace && !(traceFile = fopen(trace, "w")))
+  {
+    fprintf(stderr, "could not write %s\n", trace);
+    return 1;
+  }
+
+  ZumoTrackSim::setTrace(traceFile);
+  ZumoTrackSim::setReportFile(stderr);
+  ZumoTrackSim::begin();
+  ZumoSim::runSketch((unsigned long long)(seconds * 1e6));
+  ZumoTrackSim::printReport();
+
+  if (traceFile)
+    fclose(traceFile);
+  return 0;
+}
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Builds the host benchmarks in ZumoHostSim and runs them: the computation
+# cases of the Benchmark example (filters and compass heading) and the melody
+# parser.  Run it from anywhere.  Set CXX or CXXFLAGS to use a different
+# compiler or options (keep them the same when comparing two versions), and
+# BUILD_DIR to keep the programs it builds.  The times are host nanoseconds,
+# not AVR cycles; run the Benchmark example on a board for those.
+
+set -e
+
+cd "$(dirname "$0")/../.."
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+BUILD_DIR=${BUILD_DIR:-$(mktemp -d)}
+mkdir -p "$BUILD_DIR"
+
+$CXX $CXXFLAGS -Wall -Wextra -IZumoHostSim/include -IZumoFilters -IZumoCompass \
+  ZumoHostSim/src/ZumoBenchmarkMain.cpp ZumoCompass/ZumoCompass.cpp \
+  -o "$BUILD_DIR/ZumoBenchmark"
+$CXX $CXXFLAGS -Wall -Wextra -IZumoHostSim/include -IZumoBuzzer \
+  ZumoHostSim/src/ZumoBuzzerParserCheckMain.cpp ZumoBuzzer/ZumoBuzzerParser.cpp \
+  -o "$BUILD_DIR/ZumoBuzzerParserCheck"
+
+"$BUILD_DIR/ZumoBenchmark"
+"$BUILD_DIR/ZumoBuzzerParserCheck" --bench
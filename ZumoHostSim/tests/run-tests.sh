@@ -0,0 +1,55 @@
+#!/bin/sh
+# Builds the host tools in ZumoHostSim and runs the regression checks that
+# use them.  Run it from anywhere; it exits with a nonzero status if any
+# check fails.  Set CXX or CXXFLAGS to use a different compiler or options
+# (for example, CXXFLAGS="-O1 -g -fsanitize=address,undefined"), and
+# BUILD_DIR to keep the programs it builds.
+
+set -e
+
+cd "$(dirname "$0")/../.."
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+BUILD_DIR=${BUILD_DIR:-$(mktemp -d)}
+mkdir -p "$BUILD_DIR"
+failed=0
+
+check()
+{
+  name=$1
+  shift
+  if "$@"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    failed=1
+  fi
+}
+
+# Runs a command and compares its output with a file, showing the
+# differences.
+same_output()
+{
+  expected=$1
+  shift
+  "$@" | diff -u "$expected" -
+}
+
+# melody parser: golden notes and fuzzing
+$CXX $CXXFLAGS -Wall -Wextra -IZumoHostSim/include -IZumoBuzzer \
+  ZumoHostSim/src/ZumoBuzzerParserCheckMain.cpp ZumoBuzzer/ZumoBuzzerParser.cpp \
+  -o "$BUILD_DIR/ZumoBuzzerParserCheck"
+check buzzer-golden "$BUILD_DIR/ZumoBuzzerParserCheck" ZumoHostSim/tests/buzzer-golden.txt
+check buzzer-fuzz "$BUILD_DIR/ZumoBuzzerParserCheck" --fuzz 100000 1
+
+# collision detector: a synthetic trace with two impacts, with and without
+# the suppression of the Zumo's own acceleration
+$CXX $CXXFLAGS -Wall -Wextra -IZumoHostSim/include -IZumoCollisionDetector \
+  ZumoHostSim/src/ZumoCollisionTraceMain.cpp ZumoCollisionDetector/ZumoCollisionDetector.cpp \
+  -o "$BUILD_DIR/ZumoCollisionTrace"
+check collision-trace same_output ZumoHostSim/tests/collision-trace.expected \
+  "$BUILD_DIR/ZumoCollisionTrace" ZumoHostSim/tests/collision-trace.csv
+check collision-trace-unsuppressed same_output ZumoHostSim/tests/collision-trace-unsuppressed.expected \
+  "$BUILD_DIR/ZumoCollisionTrace" --model 100 1000 1000 ZumoHostSim/tests/collision-trace.csv
+
+exit $failed
@@ -0,0 +1,41 @@
+#include "ZumoErrorRate.h"
+
+// constructor
+ZumoErrorRate::ZumoErrorRate(unsigned int tauMicros)
+{
+  tau = tauMicros;
+  reset();
+}
+
+void ZumoErrorRate::reset()
+{
+  primed = false;
+  lastError = 0;
+  rate = 0;
+}
+
+int ZumoErrorRate::update(int error)
+{
+  unsigned long now = micros();
+  unsigned long dt = now - lastMicros;
+  lastMicros = now;
+
+  if (dt > 0xFFFF)
+    dt = 0xFFFF;
+  return update(error, primed ? dt : 0);
+}
+
+int ZumoErrorRate::update(int error, unsigned int dtMicros)
+{
+  if (primed && dtMicros != 0)
+  {
+    // same first-order filter as the ZumoPID derivative:
+    //   tau * d(rate)/dt + rate = d(error)/dt
+    long r = ((long)tau * rate + 1000L * (error - lastError)) /
+      ((long)tau + dtMicros);
+    rate = constrain(r, -32767L, 32767L);
+  }
+  primed = true;
+  lastError = error;
+  return rate;
+}
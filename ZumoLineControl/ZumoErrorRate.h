@@ -0,0 +1,60 @@
+/*! \file ZumoErrorRate.h
+ *
+ * See the ZumoErrorRate class reference for more information about this
+ * library.
+ *
+ * \class ZumoErrorRate ZumoErrorRate.h
+ * \brief Filtered rate of change of the line error
+ *
+ * ZumoSpeedPlanner, ZumoLineRecovery, and ZumoLineTurn all need to know how
+ * fast the line is moving across the sensor array.  ZumoErrorRate measures
+ * it: each update takes the error (the line position minus the center
+ * position) and the time since the previous update, and passes the change
+ * in error through the same first-order low-pass filter that ZumoPID can
+ * apply to its derivative, so sensor noise does not make it jump around.
+ * The rate is in error units per millisecond and only integer arithmetic is
+ * used.
+ */
+
+#ifndef ZumoErrorRate_h
+#define ZumoErrorRate_h
+
+#include <Arduino.h>
+
+class ZumoErrorRate
+{
+  public:
+
+    // constructor; the filter time constant is in microseconds
+    ZumoErrorRate(unsigned int tauMicros = 10000);
+
+    // clears the error history; the rate is 0 until there have been two
+    // updates
+    void reset();
+
+    // Updates the rate with a new error and returns it.  The first version
+    // measures the time since the previous update with micros(); the second
+    // uses the given time step (in microseconds), and a time step of 0 only
+    // records the error.
+    int update(int error);
+    int update(int error, unsigned int dtMicros);
+
+    // the filtered rate of change, in error units per millisecond
+    int getRate() { return rate; }
+
+    // the error given to the last update (0 after reset())
+    int getLastError() { return lastError; }
+
+    // true once there has been an update since the last reset()
+    boolean isPrimed() { return primed; }
+
+  private:
+
+    unsigned int tau;
+    boolean primed;  // true once there is a previous error
+    int lastError;
+    unsigned long lastMicros;
+    int rate;
+};
+
+#endif
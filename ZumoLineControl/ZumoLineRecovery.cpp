@@ -0,0 +1,138 @@
+#include "ZumoLineRecovery.h"
+#include "ZumoLineSensors.h"
+#include <ZumoMotors.h>
+
+// If the line was last seen at least this far from the center, the side it
+// was on is the side it left from; closer to the center, the direction it
+// was moving in is more reliable.
+#define EDGE_ERROR 1000
+
+// constructor
+ZumoLineRecovery::ZumoLineRecovery()
+{
+  setSearch(400, 250);
+  setLineSensors(6, 200);
+  reset();
+  resetStatistics();
+}
+
+void ZumoLineRecovery::setSearch(int turnSpeed, unsigned int sweepMillis)
+{
+  this->turnSpeed = turnSpeed;
+  this->sweepMillis = sweepMillis;
+}
+
+void ZumoLineRecovery::setLineSensors(unsigned char numSensors, unsigned int threshold)
+{
+  this->numSensors = numSensors;
+  this->threshold = threshold;
+}
+
+void ZumoLineRecovery::reset()
+{
+  state = STATE_FOLLOWING;
+  errorRate.reset();
+  exitSide = -1;
+  exitRate = 0;
+}
+
+void ZumoLineRecovery::resetStatistics()
+{
+  losses = 0;
+  recoveries = 0;
+  failures = 0;
+  lastRecoveryMicros = 0;
+  maxRecoveryMicros = 0;
+  totalRecoveryMicros = 0;
+}
+
+boolean ZumoLineRecovery::update(int error, const unsigned int *sensorValues)
+{
+  boolean visible = ZumoLineSensors::lineVisible(sensorValues, numSensors, threshold);
+
+  // while following, only keep track of how the line is moving
+  if (state == STATE_FOLLOWING && visible)
+  {
+    errorRate.update(error);
+    return false;
+  }
+
+  unsigned long now = micros();
+
+  if (state == STATE_FOLLOWING)
+  {
+    startSearch(now);
+  }
+  else if (visible)
+  {
+    // found it
+    if (state != STATE_GAVE_UP)
+    {
+      recoveries++;
+      lastRecoveryMicros = now - lossMicros;
+      totalRecoveryMicros += lastRecoveryMicros;
+      if (lastRecoveryMicros > maxRecoveryMicros)
+        maxRecoveryMicros = lastRecoveryMicros;
+    }
+    state = STATE_FOLLOWING;
+    errorRate.reset();
+    return false;
+  }
+  else if (state == STATE_SWEEP_EXIT_SIDE &&
+    now - sweepStartMicros >= (unsigned long)sweepMillis * 1000)
+  {
+    state = STATE_SWEEP_OTHER_SIDE;
+    sweepStartMicros = now;
+  }
+  else if (state == STATE_SWEEP_OTHER_SIDE &&
+    now - sweepStartMicros >= (unsigned long)sweepMillis * 2000)
+  {
+    state = STATE_GAVE_UP;
+    failures++;
+  }
+
+  if (state == STATE_SWEEP_EXIT_SIDE)
+    drive(exitSide);
+  else if (state == STATE_SWEEP_OTHER_SIDE)
+    drive(-exitSide);
+  else
+    ZumoMotors::setSpeeds(0, 0);
+
+  return true;
+}
+
+unsigned long ZumoLineRecovery::getTimeSinceLoss()
+{
+  if (state == STATE_FOLLOWING)
+    return 0;
+  return micros() - lossMicros;
+}
+
+unsigned long ZumoLineRecovery::getAverageRecoveryMicros()
+{
+  if (recoveries == 0)
+    return 0;
+  return totalRecoveryMicros / recoveries;
+}
+
+void ZumoLineRecovery::startSearch(unsigned long now)
+{
+  losses++;
+  lossMicros = sweepStartMicros = now;
+  int lastError = errorRate.getLastError();
+  int rate = errorRate.getRate();
+  exitRate = rate;
+
+  if (abs(lastError) >= EDGE_ERROR || rate == 0)
+    exitSide = lastError < 0 ? -1 : 1;
+  else
+    exitSide = rate < 0 ? -1 : 1;
+
+  state = STATE_SWEEP_EXIT_SIDE;
+}
+
+// spins in place toward the given side (1 is right, -1 is left)
+void ZumoLineRecovery::drive(int side)
+{
+  ZumoMotors::setSpeeds(side * turnSpeed, -side * turnSpeed);
+}
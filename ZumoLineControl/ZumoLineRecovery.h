@@ -0,0 +1,128 @@
+/*! \file ZumoLineRecovery.h
+ *
+ * See the ZumoLineRecovery class reference for more information about this
+ * library.
+ *
+ * \class ZumoLineRecovery ZumoLineRecovery.h
+ * \brief Searches for the line after a line follower loses it
+ *
+ * When none of the reflectance sensors can see the line,
+ * `ZumoReflectanceSensorArray::readLine()` returns 0 or 5000 depending on the
+ * side where the line was last seen, and a line follower that keeps steering
+ * with that position swings around at its full speed difference until the
+ * line reappears, which can take a long time and can find the wrong branch
+ * of the course.
+ *
+ * ZumoLineRecovery watches the line position and the calibrated sensor
+ * readings on each loop.  While the line is visible, it only keeps track of
+ * how the line is moving across the array.  When the line disappears, it
+ * records how it left: the side of the array it exited from and how fast it
+ * was moving.  If the line was near the center when it disappeared (for
+ * example, at a gap or a sharp corner), the direction it was moving in picks
+ * the side instead.  It then takes over the motors with a bounded search:
+ *
+ * 1. spin in place toward the exit side for up to the sweep time, which
+ *    brings the front of the Zumo, where the sensors are, back across the
+ *    line;
+ * 2. if the line has not been found, spin the other way for up to twice the
+ *    sweep time, which covers the same angle on the other side of the
+ *    heading where the line was lost;
+ * 3. if the line still has not been found, stop the motors and wait until
+ *    the line is visible again (for example, because the Zumo was put back
+ *    on the course).
+ *
+ * The time from each loss until the line is found again is recorded so that
+ * the time spent off the line can be measured and reduced.
+ */
+
+#ifndef ZumoLineRecovery_h
+#define ZumoLineRecovery_h
+
+#include <Arduino.h>
+#include "ZumoErrorRate.h"
+
+class ZumoLineRecovery
+{
+  public:
+
+    // constructor
+    ZumoLineRecovery();
+
+    // Sets the motor speed for spinning while searching (default 400) and the
+    // time to spin toward the exit side before trying the other side, in
+    // milliseconds (default 250).
+    void setSearch(int turnSpeed, unsigned int sweepMillis);
+
+    // Sets the number of sensor readings passed to update() (default 6) and
+    // the calibrated reading above which a sensor counts as seeing the line
+    // (default 200, the same test readLine() uses).
+    void setLineSensors(unsigned char numSensors, unsigned int threshold);
+
+    // forgets the line history and stops searching
+    void reset();
+
+    // Updates the recovery state with the error (the line position minus the
+    // center position) and the calibrated sensor readings.  Returns true if
+    // the line is lost and the motors are being driven by the search, in
+    // which case the caller should not set them itself.
+    boolean update(int error, const unsigned int *sensorValues);
+
+    // true while searching for the line (or stopped after giving up)
+    boolean isSearching() { return state != STATE_FOLLOWING; }
+
+    // 1 if the line was lost off the right side of the array, -1 if it was
+    // lost off the left side
+    int getExitSide() { return exitSide; }
+
+    // how fast the line was moving across the array when it was lost, in
+    // position units per millisecond (positive is toward the right)
+    int getExitRate() { return exitRate; }
+
+    // time since the line was lost, in microseconds (0 while it is visible)
+    unsigned long getTimeSinceLoss();
+
+    // statistics: the number of losses, how many of them ended with the line
+    // being found by the search and how many ended with giving up, and the
+    // time each successful search took in microseconds
+    unsigned int getLosses() { return losses; }
+    unsigned int getRecoveries() { return recoveries; }
+    unsigned int getFailures() { return failures; }
+    unsigned long getLastRecoveryMicros() { return lastRecoveryMicros; }
+    unsigned long getMaxRecoveryMicros() { return maxRecoveryMicros; }
+    unsigned long getAverageRecoveryMicros();
+    void resetStatistics();
+
+  private:
+
+    enum State
+    {
+      STATE_FOLLOWING,
+      STATE_SWEEP_EXIT_SIDE,
+      STATE_SWEEP_OTHER_SIDE,
+      STATE_GAVE_UP
+    };
+
+    void startSearch(unsigned long now);
+    void drive(int side);
+
+    int turnSpeed;
+    unsigned int sweepMillis;
+    unsigned char numSensors;
+    unsigned int threshold;
+
+    unsigned char state;
+    ZumoErrorRate errorRate;
+    int exitSide;
+    int exitRate;
+    unsigned long lossMicros;
+    unsigned long sweepStartMicros;
+
+    unsigned int losses;
+    unsigned int recoveries;
+    unsigned int failures;
+    unsigned long lastRecoveryMicros;
+    unsigned long maxRecoveryMicros;
+    unsigned long totalRecoveryMicros;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include "ZumoLineSensors.h"
+
+boolean ZumoLineSensors::lineVisible(const unsigned int *sensorValues,
+  unsigned char numSensors, unsigned int threshold)
+{
+  for (unsigned char i = 0; i < numSensors; i++)
+  {
+    if (sensorValues[i] > threshold)
+      return true;
+  }
+  return false;
+}
+
+unsigned char ZumoLineSensors::lineWidth(const unsigned int *sensorValues,
+  unsigned char numSensors, unsigned int threshold)
+{
+  unsigned char width = 0;
+  for (unsigned char i = 0; i < numSensors; i++)
+  {
+    if (sensorValues[i] > threshold)
+      width++;
+  }
+  return width;
+}
@@ -0,0 +1,34 @@
+/*! \file ZumoLineSensors.h
+ *
+ * See the ZumoLineSensors class reference for more information about this
+ * library.
+ *
+ * \class ZumoLineSensors ZumoLineSensors.h
+ * \brief Tests on calibrated reflectance sensor readings
+ *
+ * ZumoSpeedPlanner, ZumoLineRecovery, and ZumoLineTurn all look at the
+ * calibrated readings from `ZumoReflectanceSensorArray::readCalibrated()` or
+ * `readLine()` to decide whether the line is under the array at all and how
+ * wide it looks.  These functions do those tests in one place.  A sensor
+ * sees the line if its reading is above the threshold; `readLine()` uses 200.
+ */
+
+#ifndef ZumoLineSensors_h
+#define ZumoLineSensors_h
+
+#include <Arduino.h>
+
+class ZumoLineSensors
+{
+  public:
+
+    // true if any of the sensors sees the line
+    static boolean lineVisible(const unsigned int *sensorValues,
+      unsigned char numSensors, unsigned int threshold);
+
+    // the number of sensors that see the line
+    static unsigned char lineWidth(const unsigned int *sensorValues,
+      unsigned char numSensors, unsigned int threshold);
+};
+
+#endif
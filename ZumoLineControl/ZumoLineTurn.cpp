@@ -0,0 +1,124 @@
+#include "ZumoLineTurn.h"
+#include "ZumoLineSensors.h"
+#include <ZumoMotors.h>
+
+// the distance from the edge of the array to the center, in units of the
+// line position
+#define HALF_RANGE 2500
+
+// constructor
+ZumoLineTurn::ZumoLineTurn()
+{
+  setSpeeds(400, 100);
+  setTolerance(250, 40);
+  setLineSensors(6, 200);
+  state = STATE_DONE;
+  startMillis = endMillis = 0;
+}
+
+void ZumoLineTurn::setSpeeds(int turnSpeed, int minSpeed)
+{
+  this->turnSpeed = turnSpeed;
+  this->minSpeed = minSpeed;
+}
+
+void ZumoLineTurn::setTolerance(unsigned int tolerance, unsigned int lookAheadMillis)
+{
+  this->tolerance = tolerance;
+  this->lookAheadMillis = lookAheadMillis;
+}
+
+void ZumoLineTurn::setLineSensors(unsigned char numSensors, unsigned int threshold)
+{
+  this->numSensors = numSensors;
+  this->threshold = threshold;
+}
+
+void ZumoLineTurn::start(int direction, unsigned char linesToPass)
+{
+  this->direction = direction < 0 ? -1 : 1;
+  this->linesToPass = linesToPass;
+  state = STATE_LEAVING;
+  errorRate.reset();
+  startMillis = millis();
+}
+
+boolean ZumoLineTurn::update(int error, const unsigned int *sensorValues)
+{
+  if (state == STATE_DONE)
+    return true;
+
+  // A line comes into view under the outermost sensor on the side we are
+  // turning toward.
+  unsigned char leading = direction < 0 ? 0 : numSensors - 1;
+  boolean entering = sensorValues[leading] > threshold;
+  int speed = turnSpeed;
+
+  if (state == STATE_LEAVING)
+  {
+    if (!entering)
+      state = STATE_SEARCHING;
+  }
+  else if (state == STATE_SEARCHING)
+  {
+    if (entering)
+    {
+      if (linesToPass > 0)
+      {
+        linesToPass--;
+        state = STATE_LEAVING;
+      }
+      else
+      {
+        state = STATE_APPROACHING;
+        errorRate.reset();
+      }
+    }
+  }
+
+  if (state == STATE_APPROACHING)
+  {
+    if (!ZumoLineSensors::lineVisible(sensorValues, numSensors, threshold))
+    {
+      // We went past the line and it left the array on the other side, so
+      // turn back toward it.
+      direction = -direction;
+      state = STATE_SEARCHING;
+      speed = minSpeed;
+    }
+    else
+    {
+      int rate = errorRate.update(error);
+
+      // The line enters the array on the side we are turning toward and
+      // moves toward the other side, so this is how far it still has to go
+      // to reach the center.
+      long remaining = (long)error * direction;
+      if (remaining <= (long)tolerance)
+      {
+        state = STATE_DONE;
+        endMillis = millis();
+        ZumoMotors::setSpeeds(0, 0);
+        return true;
+      }
+
+      // Steer for where the line will be after the look-ahead time.  If it
+      // is going to pass the center by then, spin the other way to brake.
+      long predicted = remaining + (long)rate * direction * (long)lookAheadMillis;
+      speed = (long)turnSpeed * predicted / HALF_RANGE;
+      if (speed >= 0 && speed < minSpeed)
+        speed = minSpeed;
+      speed = constrain(speed, -turnSpeed, turnSpeed);
+    }
+  }
+
+  ZumoMotors::setSpeeds(direction * speed, -direction * speed);
+  return false;
+}
+
+unsigned int ZumoLineTurn::getTurnMillis()
+{
+  if (state == STATE_DONE)
+    return endMillis - startMillis;
+  return millis() - startMillis;
+}
@@ -0,0 +1,107 @@
+/*! \file ZumoLineTurn.h
+ *
+ * See the ZumoLineTurn class reference for more information about this
+ * library.
+ *
+ * \class ZumoLineTurn ZumoLineTurn.h
+ * \brief Turns in place onto a line, slowing down as it reaches the center
+ *
+ * A simple way to turn onto a line is to spin at a constant speed until one
+ * of the sensors has crossed it.  The motors cannot stop instantly, though,
+ * so at higher speeds the Zumo overshoots, and the line follower that takes
+ * over afterward has to swing it back to the line before it can drive
+ * straight.
+ *
+ * ZumoLineTurn spins in place at full turning speed until the line it is
+ * turning to comes into view under the outermost sensor on the side it is
+ * turning toward.  From then on, it uses the line position from
+ * `ZumoReflectanceSensorArray::readLine()` on each loop to slow down.  The
+ * speed is proportional to where the line will be after the look-ahead time
+ * at the rate it is moving: how far it still has to go to reach the center
+ * of the array, minus how far it will move by then.  If the line is going to
+ * pass the center, the speed is negative and the motors spin the other way
+ * to brake, so the Zumo starts slowing down before the line gets there.  The
+ * turn is over when the line is within the tolerance of the center, and the
+ * motors are stopped so that a line follower can take over with almost no
+ * error.  If the Zumo overshoots so far that the line leaves the array on
+ * the other side, it turns back.
+ *
+ * The same controller handles 90° and 180° turns: it just needs to know how
+ * many lines to pass before the one it is turning to.  Lines are only
+ * counted as they come in at the leading edge of the array, so a line that
+ * is under the middle of the array when the turn starts (the segment
+ * straight ahead) does not count.
+ */
+
+#ifndef ZumoLineTurn_h
+#define ZumoLineTurn_h
+
+#include <Arduino.h>
+#include "ZumoErrorRate.h"
+
+class ZumoLineTurn
+{
+  public:
+
+    // constructor
+    ZumoLineTurn();
+
+    // Sets the motor speed for spinning toward the line (default 400) and the
+    // slowest speed to spin at as it reaches the center (default 100).
+    void setSpeeds(int turnSpeed, int minSpeed);
+
+    // Sets how close to the center (in units of the line position) the line
+    // has to be for the turn to be over (default 250), and the look-ahead
+    // time in milliseconds for braking (default 40).
+    void setTolerance(unsigned int tolerance, unsigned int lookAheadMillis);
+
+    // Sets the number of sensor readings passed to update() (default 6) and
+    // the calibrated reading above which a sensor counts as seeing the line
+    // (default 200, the same test readLine() uses).
+    void setLineSensors(unsigned char numSensors, unsigned int threshold);
+
+    // Starts a turn toward the given side (1 is right, -1 is left).  For a
+    // 90° turn onto a side branch, linesToPass is 0.  For a 180° turn, it is
+    // 0 at a dead end, or 1 if there is a branch on the side it turns toward
+    // that it has to pass.
+    void start(int direction, unsigned char linesToPass);
+
+    // Updates the turn with the error (the line position minus the center
+    // position) and the calibrated sensor readings, and sets the motor
+    // speeds.  Returns true once the turn is over and the motors have been
+    // stopped.
+    boolean update(int error, const unsigned int *sensorValues);
+
+    // true while a turn is in progress
+    boolean isTurning() { return state != STATE_DONE; }
+
+    // how long the last turn took (or the current one has taken so far), in
+    // milliseconds
+    unsigned int getTurnMillis();
+
+  private:
+
+    enum State
+    {
+      STATE_LEAVING,      // waiting for a line under the leading sensor to pass
+      STATE_SEARCHING,    // spinning at full speed until a line appears
+      STATE_APPROACHING,  // slowing down as the line reaches the center
+      STATE_DONE
+    };
+
+    int turnSpeed;
+    int minSpeed;
+    unsigned int tolerance;
+    unsigned int lookAheadMillis;
+    unsigned char numSensors;
+    unsigned int threshold;
+
+    unsigned char state;
+    int direction;
+    unsigned char linesToPass;
+    unsigned long startMillis;
+    unsigned long endMillis;
+    ZumoErrorRate errorRate;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "ZumoPID.h"
+#include <ZumoMotors.h>
+
+#define MAX_DERIVATIVE_TAU 50000
+
+// constructor
+ZumoPID::ZumoPID(int kp, int ki, int kd)
+{
+  minOutput = -400;
+  maxOutput = 400;
+  derivativeTau = 0;
+  setGains(kp, ki, kd);
+  reset();
+}
+
+void ZumoPID::setGains(int kp, int ki, int kd)
+{
+  this->kp = kp;
+  this->ki = ki;
+  this->kd = kd;
+  updateIntegralLimit();
+}
+
+void ZumoPID::setDerivativeFilter(unsigned int tauMicros)
+{
+  derivativeTau = tauMicros > MAX_DERIVATIVE_TAU ? MAX_DERIVATIVE_TAU : tauMicros;
+}
+
+void ZumoPID::setOutputLimits(int minOutput, int maxOutput)
+{
+  this->minOutput = minOutput;
+  this->maxOutput = maxOutput;
+  updateIntegralLimit();
+}
+
+void ZumoPID::reset()
+{
+  primed = false;
+  integral = 0;
+  derivative = 0;
+  output = 0;
+}
+
+// The integral is limited to the value at which the integral term alone
+// would saturate the output, which also keeps ki * integral from overflowing.
+void ZumoPID::updateIntegralLimit()
+{
+  long limit = max(abs((long)minOutput), abs((long)maxOutput));
+
+  if (ki == 0)
+    integralLimit = 0;
+  else
+    integralLimit = (limit << 8) / abs(ki);
+}
+
+int ZumoPID::update(int error)
+{
+  unsigned long now = micros();
+  unsigned long dt = now - lastMicros;
+  lastMicros = now;
+
+  if (dt > 0xFFFF)
+    dt = 0xFFFF;
+  return update(error, primed ? dt : 0);
+}
+
+int ZumoPID::update(int error, unsigned int dtMicros)
+{
+  long proportional = (long)kp * error;
+  long newIntegral = integral;
+
+  if (primed && dtMicros != 0)
+  {
+    // Backward Euler step of a first-order filter on the derivative:
+    //   tau * d(derivative)/dt + derivative = d(error)/dt
+    // (with tau = 0, this is just the change in error over the time step).
+    // The result is in error units per millisecond.
+    long d = ((long)derivativeTau * derivative + 1000L * (error - lastError)) /
+      ((long)derivativeTau + dtMicros);
+    derivative = constrain(d, -32767L, 32767L);
+
+    newIntegral += ((long)error * dtMicros) >> 10;
+    newIntegral = constrain(newIntegral, -integralLimit, integralLimit);
+  }
+
+  primed = true;
+  lastError = error;
+
+  // each term is scaled down separately so that their sum cannot overflow
+  long derivativeTerm = ((long)kd * derivative) >> 8;
+  long out = (proportional >> 8) + (((long)ki * newIntegral) >> 8) + derivativeTerm;
+
+  // anti-windup: don't let the integral push a saturated output further
+  if (!((out > maxOutput && newIntegral > integral) ||
+        (out < minOutput && newIntegral < integral)))
+  {
+    integral = newIntegral;
+  }
+  out = (proportional >> 8) + (((long)ki * integral) >> 8) + derivativeTerm;
+
+  output = constrain(out, (long)minOutput, (long)maxOutput);
+  return output;
+}
+
+void ZumoPID::steer(int baseSpeed, int minSpeed, int maxSpeed)
+{
+  int left = constrain(baseSpeed + output, minSpeed, maxSpeed);
+  int right = constrain(baseSpeed - output, minSpeed, maxSpeed);
+  ZumoMotors::setSpeeds(left, right);
+}
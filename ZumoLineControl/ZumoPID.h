@@ -0,0 +1,98 @@
+/*! \file ZumoPID.h
+ *
+ * See the ZumoPID class reference for more information about this library.
+ *
+ * \class ZumoPID ZumoPID.h
+ * \brief Fixed-point PID controller for line following
+ *
+ * ZumoPID turns the error between the line position returned by
+ * `ZumoReflectanceSensorArray::readLine()` and the center of the array (for
+ * example, `position - 2500`) into a steering correction that can be applied
+ * to the motors with `steer()`, which calls `ZumoMotors::setSpeeds()`.
+ *
+ * All of the arithmetic is done with integers. The gains are fixed-point
+ * numbers with 8 fractional bits (256 means 1.0) and the time-dependent terms
+ * are scaled by the measured loop time, so the same gains work even if the
+ * loop speeds up or slows down:
+ *
+ * - proportional term: `kp * error / 256`
+ * - integral term: `ki * integral / 256`, where `integral` is the sum of
+ *   `error * dt` in units of error times 1.024 ms
+ * - derivative term: `kd * derivative / 256`, where `derivative` is the rate
+ *   of change of the error in error units per millisecond, optionally passed
+ *   through a first-order low-pass filter to reduce sensor noise
+ *
+ * The output is clamped to the range given to `setOutputLimits()`. While it is
+ * saturated, the integral stops accumulating in the direction that would push
+ * it further into saturation (anti-windup), and the integral is also limited
+ * to the amount that could saturate the output by itself.
+ *
+ * For example, the proportional and derivative terms used by the original
+ * LineFollower example, `error / 4 + 6 * (error - lastError)`, correspond to
+ * a kp of 64 and a kd of about 6 * 256 * T, where T is the loop time in
+ * milliseconds.
+ */
+
+#ifndef ZumoPID_h
+#define ZumoPID_h
+
+#include <Arduino.h>
+
+class ZumoPID
+{
+  public:
+
+    // constructor; gains are fixed-point with 8 fractional bits (256 = 1.0)
+    ZumoPID(int kp = 0, int ki = 0, int kd = 0);
+
+    void setGains(int kp, int ki, int kd);
+
+    // Sets the time constant of the derivative low-pass filter in
+    // microseconds (0, the default, disables the filter; the maximum is
+    // 50000).
+    void setDerivativeFilter(unsigned int tauMicros);
+
+    // limits the output (and therefore the integral); the default is
+    // -400 to 400, the full range of ZumoMotors speeds
+    void setOutputLimits(int minOutput, int maxOutput);
+
+    // clears the integral and derivative state; the next update() will not
+    // have a derivative term since there is no previous error to compare to
+    void reset();
+
+    // Updates the controller with a new error and returns the new output.
+    // The first version measures the time since the previous update with
+    // micros(); the second uses the given time step (in microseconds).
+    int update(int error);
+    int update(int error, unsigned int dtMicros);
+
+    // the output of the last update
+    int getOutput() { return output; }
+
+    // Drives the motors with the last output as a steering correction:
+    // the left motor gets baseSpeed + output and the right motor gets
+    // baseSpeed - output, each limited to between minSpeed and maxSpeed.
+    void steer(int baseSpeed, int minSpeed, int maxSpeed);
+
+    // internal state, for debugging and tuning
+    long getIntegral() { return integral; }
+    int getDerivative() { return derivative; }
+
+  private:
+
+    void updateIntegralLimit();
+
+    int kp, ki, kd;
+    unsigned int derivativeTau;
+    int minOutput, maxOutput;
+
+    boolean primed;  // true once there is a previous error
+    int lastError;
+    unsigned long lastMicros;
+    long integral;
+    long integralLimit;
+    int derivative;
+    int output;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "ZumoSpeedPlanner.h"
+#include "ZumoLineSensors.h"
+
+// constructor
+ZumoSpeedPlanner::ZumoSpeedPlanner(int minSpeed, int maxSpeed)
+{
+  setSpeedLimits(minSpeed, maxSpeed);
+  setAcceleration(800, 8000);
+  setCurvatureRange(2500, 20);
+  setLineSensors(6, 500, 3);
+  reset(minSpeed);
+}
+
+void ZumoSpeedPlanner::setSpeedLimits(int minSpeed, int maxSpeed)
+{
+  this->minSpeed = minSpeed;
+  this->maxSpeed = maxSpeed;
+}
+
+void ZumoSpeedPlanner::setAcceleration(unsigned int acceleration, unsigned int deceleration)
+{
+  this->acceleration = acceleration;
+  this->deceleration = deceleration;
+}
+
+void ZumoSpeedPlanner::setCurvatureRange(unsigned int fullCurvature, unsigned int lookAheadMillis)
+{
+  this->fullCurvature = fullCurvature == 0 ? 1 : fullCurvature;
+  this->lookAheadMillis = lookAheadMillis;
+}
+
+void ZumoSpeedPlanner::setLineSensors(unsigned char numSensors, unsigned int threshold,
+  unsigned char maxLineWidth)
+{
+  this->numSensors = numSensors;
+  this->threshold = threshold;
+  this->maxLineWidth = maxLineWidth;
+}
+
+void ZumoSpeedPlanner::reset(int speed)
+{
+  errorRate.reset();
+  curvature = 0;
+  confident = true;
+  targetSpeed = speed;
+  this->speed = (long)speed << 8;
+}
+
+int ZumoSpeedPlanner::update(int error, const unsigned int *sensorValues)
+{
+  unsigned long now = micros();
+  unsigned long dt = now - lastMicros;
+  lastMicros = now;
+
+  if (dt > 0xFFFF)
+    dt = 0xFFFF;
+  return update(error, sensorValues, errorRate.isPrimed() ? dt : 0);
+}
+
+int ZumoSpeedPlanner::update(int error, const unsigned int *sensorValues, unsigned int dtMicros)
+{
+  int rate = errorRate.update(error, dtMicros);
+
+  // the curvature estimate is where the error will be after the look-ahead
+  // time if it keeps changing at the current rate
+  long c = abs((long)error) + abs((long)rate) * lookAheadMillis;
+  curvature = c > 0xFFFF ? 0xFFFF : c;
+
+  // The line position is trustworthy if at least one sensor sees the line
+  // and not too many of them do.
+  confident = true;
+  if (sensorValues)
+  {
+    unsigned char width = ZumoLineSensors::lineWidth(sensorValues, numSensors, threshold);
+    confident = width != 0 && width <= maxLineWidth;
+  }
+
+  if (!confident || curvature >= fullCurvature)
+    targetSpeed = minSpeed;
+  else
+    targetSpeed = maxSpeed - (long)(maxSpeed - minSpeed) * curvature / fullCurvature;
+
+  // Move toward the target speed, but no faster than the acceleration or
+  // deceleration limit allows.  The speed is kept with 8 fractional bits so
+  // that small steps at short loop times are not lost.
+  long target = (long)targetSpeed << 8;
+  if (target > speed)
+  {
+    long step = ((unsigned long)acceleration * dtMicros) / 3906;  // * 256 / 1000000
+    speed = (target - speed > step) ? speed + step : target;
+  }
+  else
+  {
+    long step = ((unsigned long)deceleration * dtMicros) / 3906;
+    speed = (speed - target > step) ? speed - step : target;
+  }
+
+  return speed >> 8;
+}
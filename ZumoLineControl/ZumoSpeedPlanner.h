@@ -0,0 +1,104 @@
+/*! \file ZumoSpeedPlanner.h
+ *
+ * See the ZumoSpeedPlanner class reference for more information about this
+ * library.
+ *
+ * \class ZumoSpeedPlanner ZumoSpeedPlanner.h
+ * \brief Curvature-aware base speed for line following
+ *
+ * A line follower that always drives at its top speed has to be tuned for
+ * the tightest curve on the course, and one that is slowed down until it can
+ * handle that curve wastes time on the straights.  ZumoSpeedPlanner picks the
+ * base speed for each loop instead: it goes fast while the line stays near
+ * the center of the array and slows down as soon as it starts to move away.
+ *
+ * Each update takes the same error that is given to the steering controller
+ * (the line position from `ZumoReflectanceSensorArray::readLine()` minus
+ * 2500) and, optionally, the calibrated sensor readings.  From these it
+ * estimates:
+ *
+ * - the curvature ahead: the magnitude of the error plus how fast the error
+ *   is changing, multiplied by a look-ahead time.  The line moves across the
+ *   array quickly when the Zumo enters a curve, so the rate term lets it
+ *   brake before the error itself gets large;
+ * - the confidence in the line position: if no sensor sees the line well, or
+ *   the line is much wider than expected (at an intersection or a blob of
+ *   tape), the position is not trustworthy and the Zumo slows down to its
+ *   minimum speed.
+ *
+ * The target speed falls linearly from the maximum speed, with no
+ * curvature, to the minimum speed when the curvature estimate reaches the
+ * value set with `setCurvatureRange()`.  The base speed then follows the
+ * target, but never changes faster than the acceleration and deceleration
+ * limits, so the motors do not slip or jerk the sensor array off the line.
+ */
+
+#ifndef ZumoSpeedPlanner_h
+#define ZumoSpeedPlanner_h
+
+#include <Arduino.h>
+#include "ZumoErrorRate.h"
+
+class ZumoSpeedPlanner
+{
+  public:
+
+    // constructor; speeds are ZumoMotors speeds (0 to 400)
+    ZumoSpeedPlanner(int minSpeed = 200, int maxSpeed = 400);
+
+    void setSpeedLimits(int minSpeed, int maxSpeed);
+
+    // Sets how fast the base speed may rise and fall, in speed units per
+    // second (the defaults are 800 and 8000).
+    void setAcceleration(unsigned int acceleration, unsigned int deceleration);
+
+    // Sets the curvature estimate at which the target speed reaches the
+    // minimum speed (default 2500, in units of the line position) and the
+    // look-ahead time in milliseconds for the rate of change of the error
+    // (default 20).
+    void setCurvatureRange(unsigned int fullCurvature, unsigned int lookAheadMillis);
+
+    // Sets the number of sensor readings passed to update() (default 6), the
+    // calibrated reading at which a sensor counts as seeing the line
+    // (default 500), and the number of such sensors above which the line is
+    // considered too wide to trust (default 3).
+    void setLineSensors(unsigned char numSensors, unsigned int threshold,
+      unsigned char maxLineWidth);
+
+    // sets the base speed and clears the error history
+    void reset(int speed);
+
+    // Updates the planner with a new error (and optionally the calibrated
+    // sensor readings) and returns the new base speed.  The first version
+    // measures the time since the previous update with micros(); the second
+    // uses the given time step (in microseconds).
+    int update(int error, const unsigned int *sensorValues = 0);
+    int update(int error, const unsigned int *sensorValues, unsigned int dtMicros);
+
+    // the base speed returned by the last update
+    int getSpeed() { return speed >> 8; }
+
+    // internal state, for debugging and tuning
+    int getTargetSpeed() { return targetSpeed; }
+    unsigned int getCurvature() { return curvature; }
+    boolean isConfident() { return confident; }
+
+  private:
+
+    int minSpeed, maxSpeed;
+    unsigned int acceleration, deceleration;
+    unsigned int fullCurvature;
+    unsigned int lookAheadMillis;
+    unsigned char numSensors;
+    unsigned int threshold;
+    unsigned char maxLineWidth;
+
+    ZumoErrorRate errorRate;
+    unsigned long lastMicros;
+    unsigned int curvature;
+    boolean confident;
+    int targetSpeed;
+    long speed;              // base speed with 8 fractional bits
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "ZumoIntersectionDetector.h"
+
+// the number of steps in the outer sensor history (one per bit)
+#define HISTORY_STEPS 16
+
+// counts the steps in a history where the sensor saw the line
+static unsigned char countSteps(unsigned int history)
+{
+  unsigned char count = 0;
+  for (; history; history >>= 1)
+    count += history & 1;
+  return count;
+}
+
+// constructor
+ZumoIntersectionDetector::ZumoIntersectionDetector()
+{
+  setThreshold(300);
+  setLineWidth(64);
+  reset();
+}
+
+void ZumoIntersectionDetector::setThreshold(unsigned int threshold)
+{
+  this->threshold = threshold;
+}
+
+void ZumoIntersectionDetector::setLineWidth(unsigned int width)
+{
+  lineWidth = width;
+}
+
+void ZumoIntersectionDetector::reset()
+{
+  state = STATE_FOLLOWING;
+  armed = false;
+  left = straight = right = false;
+  finish = false;
+  segmentLength = 0;
+  lastOuterDistance = 0;
+  leftHistory = rightHistory = 0;
+}
+
+boolean ZumoIntersectionDetector::update(const unsigned int *sensorValues, unsigned int distance)
+{
+  if (state == STATE_DONE)
+    return true;
+
+  boolean outerLeft = above(sensorValues, 0);
+  boolean outerRight = above(sensorValues, 5);
+  boolean inner = false;
+  for (unsigned char i = 1; i <= 4; i++)
+  {
+    if (above(sensorValues, i))
+      inner = true;
+  }
+
+  // Lines under the outer sensors right after reset() belong to the
+  // intersection the Zumo is leaving.
+  if (!outerLeft && !outerRight)
+    armed = true;
+
+  // An outer sensor seeing the line starts an intersection (even if the line
+  // had disappeared for a moment).
+  if (armed && state != STATE_CROSSING && (outerLeft || outerRight))
+  {
+    state = STATE_CROSSING;
+    segmentLength = distance;
+  }
+
+  if (state == STATE_FOLLOWING)
+  {
+    if (!inner && !outerLeft && !outerRight)
+    {
+      state = STATE_LOST;
+      segmentLength = distance;
+    }
+    return false;
+  }
+
+  if (state == STATE_LOST)
+  {
+    if (inner)
+      state = STATE_FOLLOWING;  // just a gap in the line
+    else if (distance - segmentLength >= lineWidth / 2)
+      state = STATE_DONE;       // dead end
+    return state == STATE_DONE;
+  }
+
+  // crossing an intersection
+  unsigned int traveled = distance - segmentLength;
+  unsigned char step = traveled / (lineWidth / 4 + 1);
+  if (step >= HISTORY_STEPS)
+    step = HISTORY_STEPS - 1;
+
+  if (outerLeft)
+    leftHistory |= 1U << step;
+  if (outerRight)
+    rightHistory |= 1U << step;
+  if (outerLeft || outerRight)
+    lastOuterDistance = distance;
+
+  if (traveled >= lineWidth + lineWidth / 2)
+  {
+    // Too wide to be an intersection.
+    finish = true;
+    for (unsigned char i = 1; i <= 4; i++)
+    {
+      if (!above(sensorValues, i))
+        finish = false;
+    }
+    if (finish)
+    {
+      state = STATE_DONE;
+      return true;
+    }
+  }
+
+  if (distance - lastOuterDistance < lineWidth / 8 + 1)
+    return false;
+
+  // The outer sensors have passed the line.  If neither saw it for two steps,
+  // it was not an exit (for example, a sharp curve brushing an outer sensor),
+  // so the segment goes on.
+  if (countSteps(leftHistory) < 2 && countSteps(rightHistory) < 2)
+  {
+    state = STATE_FOLLOWING;
+    leftHistory = rightHistory = 0;
+    return false;
+  }
+
+  finishCrossing(sensorValues);
+  return true;
+}
+
+boolean ZumoIntersectionDetector::above(const unsigned int *sensorValues, unsigned char i)
+{
+  return sensorValues[i] > threshold;
+}
+
+void ZumoIntersectionDetector::finishCrossing(const unsigned int *sensorValues)
+{
+  left = countSteps(leftHistory) >= 2;
+  right = countSteps(rightHistory) >= 2;
+  for (unsigned char i = 1; i <= 4; i++)
+  {
+    if (above(sensorValues, i))
+      straight = true;
+  }
+
+  // Average the distance over which the outer sensors saw the line into the
+  // line width, unless that was too long to be a measurement of it.
+  unsigned int width = lastOuterDistance - segmentLength;
+  if ((left || right) && width < 2 * lineWidth)
+    lineWidth = (3 * (unsigned long)lineWidth + width + 2) / 4;
+
+  state = STATE_DONE;
+}
@@ -0,0 +1,123 @@
+/*! \file ZumoIntersectionDetector.h
+ *
+ * See the ZumoIntersectionDetector class reference for more information
+ * about this library.
+ *
+ * \class ZumoIntersectionDetector ZumoIntersectionDetector.h
+ * \brief Classifies the end of a line maze segment while driving through it
+ *
+ * A maze solver has to find out what is at the end of each segment: exits to
+ * the left, straight ahead, and to the right, a dead end, or the finish.  The
+ * usual way is to stop following the line when the outer sensors see
+ * something, drive ahead blind for a fixed time, and read the sensors again.
+ * ZumoIntersectionDetector instead looks at every reading of the Zumo's six
+ * reflectance sensors while the Zumo keeps driving, and decides as soon as
+ * the readings are enough to tell.
+ *
+ * Each reading is given with the distance the Zumo has traveled since the
+ * start of the segment, in any units that are proportional to distance (for
+ * example, milliseconds of driving at a fixed speed).  Lines seen by the outer
+ * sensors (0 and 5) before they have both been clear once are ignored, since
+ * they belong to the intersection the Zumo is just turning out of.  Once an
+ * outer sensor sees a line, the detector records which outer sensors see the
+ * line in a short history indexed by the distance traveled since then, in
+ * steps of a quarter of the line width.  The intersection has been crossed
+ * when neither outer sensor has seen the line for an eighth of the line
+ * width.  At that point:
+ *
+ * - there is an exit to the left or right if the corresponding outer sensor
+ *   saw the line for at least two steps of the history;
+ * - there is an exit straight ahead if one of the four inner sensors sees
+ *   the line.
+ *
+ * If neither outer sensor saw the line for two steps (a single noisy reading,
+ * or the corner of a sharp curve brushing the sensor), it was not an
+ * intersection: the history is cleared and the detector goes back to
+ * following the segment, so the segment does not end there and isCrossing()
+ * is false again.
+ *
+ * If the outer sensors still see the line one and a half line widths after
+ * they first saw it, the line is too wide to be an intersection; if all of
+ * the inner sensors see it too, it is the finish (otherwise the detector
+ * keeps waiting for the outer sensors to pass it).  If no sensor sees the
+ * line for half of the line width before an outer sensor has seen one, the
+ * segment ended in a dead end; a shorter gap in the line is ignored.
+ *
+ * The line width is learned: each time an intersection is crossed, the
+ * distance over which the outer sensors saw the line is averaged into it.
+ */
+
+#ifndef ZumoIntersectionDetector_h
+#define ZumoIntersectionDetector_h
+
+#include <Arduino.h>
+
+class ZumoIntersectionDetector
+{
+  public:
+
+    // constructor
+    ZumoIntersectionDetector();
+
+    // Sets the calibrated reading above which a sensor counts as seeing the
+    // line (default 300).
+    void setThreshold(unsigned int threshold);
+
+    // Sets the first estimate of the line width, in the same units as the
+    // distance passed to update() (default 64).
+    void setLineWidth(unsigned int width);
+
+    // starts looking for the end of a new segment
+    void reset();
+
+    // Updates the detector with the six calibrated sensor readings and the
+    // distance traveled since reset().  Returns true once the end of the
+    // segment has been classified; the results below are then valid until
+    // the next reset().
+    boolean update(const unsigned int *sensorValues, unsigned int distance);
+
+    // True while the Zumo is crossing an intersection or has lost the line,
+    // when the line position from the sensors is meaningless and the Zumo
+    // should drive straight ahead instead of following it.
+    boolean isCrossing() { return state != STATE_FOLLOWING; }
+
+    boolean foundLeft() { return left; }
+    boolean foundStraight() { return straight; }
+    boolean foundRight() { return right; }
+    boolean isDeadEnd() { return state == STATE_DONE && !left && !straight && !right && !finish; }
+    boolean isFinish() { return finish; }
+
+    // the distance from reset() to where the end of the segment was first
+    // seen
+    unsigned int getSegmentLength() { return segmentLength; }
+
+    // the current estimate of the line width
+    unsigned int getLineWidth() { return lineWidth; }
+
+  private:
+
+    enum State
+    {
+      STATE_FOLLOWING,
+      STATE_LOST,
+      STATE_CROSSING,
+      STATE_DONE
+    };
+
+    boolean above(const unsigned int *sensorValues, unsigned char i);
+    void finishCrossing(const unsigned int *sensorValues);
+
+    unsigned int threshold;
+    unsigned int lineWidth;
+
+    unsigned char state;
+    boolean armed;                   // true once both outer sensors have been clear
+    boolean left, straight, right;
+    boolean finish;
+    unsigned int segmentLength;
+    unsigned int lastOuterDistance;  // where an outer sensor last saw the line
+    unsigned int leftHistory;        // bit n is set if sensor 0 saw the line in step n
+    unsigned int rightHistory;       // the same for sensor 5
+};
+
+#endif
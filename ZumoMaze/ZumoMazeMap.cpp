@@ -0,0 +1,384 @@
+#include "ZumoMazeMap.h"
+
+// flags in the via[] array used by searchFrom(); the low two bits are the
+// direction of the last step into the node
+#define VIA_REACHED 0x40
+#define VIA_DONE    0x80
+
+static const signed char dx[4] = { 0, 1, 0, -1 };
+static const signed char dy[4] = { 1, 0, -1, 0 };
+
+// turns relative to the heading, indexed by (new heading - heading) & 3
+static const char turnNames[4] = { 'S', 'R', 'B', 'L' };
+
+// constructor
+ZumoMazeMap::ZumoMazeMap()
+{
+  matchDistance = 100;
+  reset();
+}
+
+void ZumoMazeMap::setMatchDistance(unsigned int distance)
+{
+  matchDistance = distance;
+}
+
+void ZumoMazeMap::reset()
+{
+  nodeCount = 0;
+  routeLength = 0;
+  finish = ZUMO_MAZE_UNEXPLORED;
+  lastExits = 0;
+  atDeadEnd = false;
+  full = false;
+  x = y = 0;
+  heading = ZUMO_MAZE_NORTH;
+  current = addNode(1 << ZUMO_MAZE_NORTH);
+}
+
+boolean ZumoMazeMap::arrive(unsigned int length, boolean left, boolean straight, boolean right)
+{
+  unsigned char back = (heading + 2) & 3;
+
+  lastExits = (left ? 1 : 0) | (straight ? 2 : 0) | (right ? 4 : 0);
+  if (full)
+    return false;
+
+  x += dx[heading] * (int)length;
+  y += dy[heading] * (int)length;
+
+  // coming back from a dead end to the intersection we left
+  if (atDeadEnd)
+  {
+    atDeadEnd = false;
+    x = nodes[current].x;
+    y = nodes[current].y;
+    return true;
+  }
+
+  unsigned char n = nodes[current].neighbor[heading];
+  if (n < nodeCount)
+  {
+    // a segment we have driven before
+    unsigned int average = (nodes[current].length[heading] + (unsigned long)length) / 2;
+    nodes[current].length[heading] = average;
+    nodes[n].length[back] = average;
+  }
+  else
+  {
+    if (lastExits == 0)
+    {
+      nodes[current].neighbor[heading] = ZUMO_MAZE_DEAD_END;
+      nodes[current].length[heading] = length;
+      atDeadEnd = true;
+      return true;
+    }
+
+    unsigned char exits = 1 << back;
+    if (left)
+      exits |= 1 << ((heading + 3) & 3);
+    if (straight)
+      exits |= 1 << heading;
+    if (right)
+      exits |= 1 << ((heading + 1) & 3);
+
+    // If this is an intersection we have seen before, we went around a loop.
+    n = findNode(exits, back);
+    if (n == ZUMO_MAZE_UNEXPLORED)
+      n = addNode(exits);
+    if (n == ZUMO_MAZE_UNEXPLORED)
+      return false;
+    link(n, length);
+  }
+
+  current = n;
+  x = nodes[n].x;
+  y = nodes[n].y;
+  return true;
+}
+
+boolean ZumoMazeMap::arriveAtFinish(unsigned int length)
+{
+  if (full)
+    return false;
+
+  x += dx[heading] * (int)length;
+  y += dy[heading] * (int)length;
+
+  unsigned char n = nodes[current].neighbor[heading];
+  if (n >= nodeCount)
+  {
+    n = addNode(1 << ((heading + 2) & 3));
+    if (n == ZUMO_MAZE_UNEXPLORED)
+      return false;
+    link(n, length);
+  }
+
+  finish = current = n;
+  return true;
+}
+
+char ZumoMazeMap::selectTurn()
+{
+  if (full)
+    return leftHandTurn();
+  if (atDeadEnd)
+    return 'B';
+
+  // Take the leftmost unexplored exit, if there is one.
+  static const unsigned char order[3] = { 3, 0, 1 };
+  for (unsigned char i = 0; i < 3; i++)
+  {
+    unsigned char dir = (heading + order[i]) & 3;
+    if ((nodes[current].exits & (1 << dir)) &&
+      nodes[current].neighbor[dir] == ZUMO_MAZE_UNEXPLORED)
+    {
+      return turnNames[order[i]];
+    }
+  }
+
+  // Otherwise, head for the closest intersection that has one.
+  unsigned int distance[ZUMO_MAZE_MAX_NODES];
+  unsigned char via[ZUMO_MAZE_MAX_NODES];
+  searchFrom(current, distance, via);
+
+  unsigned char target = ZUMO_MAZE_UNEXPLORED;
+  for (unsigned char n = 0; n < nodeCount; n++)
+  {
+    if ((via[n] & VIA_REACHED) && hasUnexplored(n) &&
+      (target == ZUMO_MAZE_UNEXPLORED || distance[n] < distance[target]))
+    {
+      target = n;
+    }
+  }
+  if (target == ZUMO_MAZE_UNEXPLORED)
+    return 0;
+
+  // Walk back to find the first step.
+  unsigned char dir = via[target] & 3;
+  for (unsigned char n = target; n != current; )
+  {
+    dir = via[n] & 3;
+    n = nodes[n].neighbor[(dir + 2) & 3];
+  }
+  return turnNames[(dir - heading) & 3];
+}
+
+void ZumoMazeMap::turn(char dir)
+{
+  switch (dir)
+  {
+    case 'L':
+      heading = (heading + 3) & 3;
+      break;
+    case 'R':
+      heading = (heading + 1) & 3;
+      break;
+    case 'B':
+      heading = (heading + 2) & 3;
+      break;
+  }
+}
+
+boolean ZumoMazeMap::findRoute()
+{
+  routeLength = 0;
+  if (finish == ZUMO_MAZE_UNEXPLORED)
+    return false;
+
+  unsigned int distance[ZUMO_MAZE_MAX_NODES];
+  unsigned char via[ZUMO_MAZE_MAX_NODES];
+  searchFrom(0, distance, via);
+  if (!(via[finish] & VIA_REACHED))
+    return false;
+
+  // Count the intersections between the start and the finish.
+  unsigned char turns = 0;
+  unsigned char n = nodes[finish].neighbor[((via[finish] & 3) + 2) & 3];
+  while (n != 0)
+  {
+    turns++;
+    n = nodes[n].neighbor[((via[n] & 3) + 2) & 3];
+  }
+  if (turns > ZUMO_MAZE_MAX_ROUTE)
+    return false;
+
+  // Walk back from the finish again, storing the turn at each intersection
+  // as a two-bit code.
+  unsigned char out = via[finish] & 3;
+  n = nodes[finish].neighbor[(out + 2) & 3];
+  for (unsigned char i = turns; i > 0; i--)
+  {
+    unsigned char in = via[n] & 3;
+    unsigned char code = (out - in) & 3;
+    unsigned char shift = ((i - 1) & 3) * 2;
+    route[(i - 1) >> 2] = (route[(i - 1) >> 2] & ~(3 << shift)) | (code << shift);
+    out = in;
+    n = nodes[n].neighbor[(in + 2) & 3];
+  }
+
+  routeLength = turns;
+  return true;
+}
+
+char ZumoMazeMap::getRouteTurn(unsigned char i)
+{
+  if (i >= routeLength)
+    return 0;
+  return turnNames[routeCode(i)];
+}
+
+unsigned int ZumoMazeMap::getRouteSegmentLength(unsigned char i)
+{
+  if (i > routeLength)
+    return 0;
+
+  // Follow the route from the start.
+  unsigned char node = 0;
+  unsigned char dir = ZUMO_MAZE_NORTH;
+  for (unsigned char j = 0; j < i; j++)
+  {
+    node = nodes[node].neighbor[dir];
+    dir = (dir + routeCode(j)) & 3;
+  }
+  return nodes[node].length[dir];
+}
+
+unsigned char ZumoMazeMap::getNeighbor(unsigned char node, unsigned char dir)
+{
+  return nodes[node].neighbor[dir & 3];
+}
+
+unsigned int ZumoMazeMap::getSegmentLength(unsigned char node, unsigned char dir)
+{
+  return nodes[node].length[dir & 3];
+}
+
+unsigned char ZumoMazeMap::routeCode(unsigned char i)
+{
+  return (route[i >> 2] >> ((i & 3) * 2)) & 3;
+}
+
+// Looks for a known intersection near the estimated position with the same
+// exits and nothing connected yet to the exit we arrived on.
+unsigned char ZumoMazeMap::findNode(unsigned char exits, unsigned char from)
+{
+  unsigned char best = ZUMO_MAZE_UNEXPLORED;
+  unsigned int bestDistance = 0;
+
+  for (unsigned char n = 0; n < nodeCount; n++)
+  {
+    if (nodes[n].exits != exits || nodes[n].neighbor[from] != ZUMO_MAZE_UNEXPLORED)
+      continue;
+
+    unsigned int distanceX = abs(x - nodes[n].x);
+    unsigned int distanceY = abs(y - nodes[n].y);
+    if (distanceX > matchDistance || distanceY > matchDistance)
+      continue;
+
+    if (best == ZUMO_MAZE_UNEXPLORED || distanceX + distanceY < bestDistance)
+    {
+      best = n;
+      bestDistance = distanceX + distanceY;
+    }
+  }
+  return best;
+}
+
+unsigned char ZumoMazeMap::addNode(unsigned char exits)
+{
+  if (nodeCount >= ZUMO_MAZE_MAX_NODES)
+  {
+    full = true;
+    return ZUMO_MAZE_UNEXPLORED;
+  }
+
+  Node *node = &nodes[nodeCount];
+  node->x = x;
+  node->y = y;
+  node->exits = exits;
+  for (unsigned char i = 0; i < 4; i++)
+  {
+    node->neighbor[i] = ZUMO_MAZE_UNEXPLORED;
+    node->length[i] = 0;
+  }
+  return nodeCount++;
+}
+
+// connects the exit of the current node we just drove along to node n
+void ZumoMazeMap::link(unsigned char n, unsigned int length)
+{
+  unsigned char back = (heading + 2) & 3;
+
+  nodes[current].neighbor[heading] = n;
+  nodes[current].length[heading] = length;
+  nodes[n].neighbor[back] = current;
+  nodes[n].length[back] = length;
+}
+
+// Dijkstra's algorithm: finds the length of the shortest known route from
+// the start node to every node.  via[n] gets VIA_REACHED if there is a route
+// to n, and the direction of the last step of that route.
+void ZumoMazeMap::searchFrom(unsigned char start, unsigned int *distance, unsigned char *via)
+{
+  for (unsigned char n = 0; n < nodeCount; n++)
+    via[n] = 0;
+  distance[start] = 0;
+  via[start] = VIA_REACHED;
+
+  while (1)
+  {
+    unsigned char u = ZUMO_MAZE_UNEXPLORED;
+    for (unsigned char n = 0; n < nodeCount; n++)
+    {
+      if ((via[n] & (VIA_REACHED | VIA_DONE)) == VIA_REACHED &&
+        (u == ZUMO_MAZE_UNEXPLORED || distance[n] < distance[u]))
+      {
+        u = n;
+      }
+    }
+    if (u == ZUMO_MAZE_UNEXPLORED)
+      return;
+    via[u] |= VIA_DONE;
+
+    for (unsigned char dir = 0; dir < 4; dir++)
+    {
+      unsigned char v = nodes[u].neighbor[dir];
+      if (v >= nodeCount || (via[v] & VIA_DONE))
+        continue;
+
+      unsigned int d = distance[u] + nodes[u].length[dir];
+      if (d < distance[u])
+        d = 0xFFFF;  // saturate instead of overflowing
+      if (!(via[v] & VIA_REACHED) || d < distance[v])
+      {
+        distance[v] = d;
+        via[v] = VIA_REACHED | dir;
+      }
+    }
+  }
+}
+
+boolean ZumoMazeMap::hasUnexplored(unsigned char node)
+{
+  for (unsigned char dir = 0; dir < 4; dir++)
+  {
+    if ((nodes[node].exits & (1 << dir)) && nodes[node].neighbor[dir] == ZUMO_MAZE_UNEXPLORED)
+      return true;
+  }
+  return false;
+}
+
+// the "left hand on the wall" choice among the exits found at the last
+// intersection, for when the map is full
+char ZumoMazeMap::leftHandTurn()
+{
+  if (lastExits & 1)
+    return 'L';
+  else if (lastExits & 2)
+    return 'S';
+  else if (lastExits & 4)
+    return 'R';
+  else
+    return 'B';
+}
@@ -0,0 +1,153 @@
+/*! \file ZumoMazeMap.h
+ *
+ * See the ZumoMazeMap class reference for more information about this
+ * library.
+ *
+ * \class ZumoMazeMap ZumoMazeMap.h
+ * \brief Map of a line maze as a graph of intersections
+ *
+ * ZumoMazeMap records a line maze while a Zumo explores it: each
+ * intersection is a node, and each segment between two intersections is an
+ * edge with a length (in whatever units the sketch measures, for example the
+ * milliseconds it took to drive along it).  If a segment is driven again
+ * while exploring, its length is averaged with the new measurement.  The
+ * Zumo's heading is tracked as one of four directions as it turns, and its
+ * position is estimated from the headings and lengths of the segments it
+ * drives, so when it arrives at an intersection it has already visited by a
+ * different route, the map recognizes it and closes the loop instead of
+ * adding a new node.  This lets it handle mazes with loops, which a recorded
+ * list of turns cannot.
+ *
+ * Dead ends are not stored as nodes; the exit leading to one is just marked
+ * as a dead end.
+ *
+ * While exploring, selectTurn() picks the leftmost exit at the current
+ * intersection that has not been explored yet (like the "left hand on the
+ * wall" strategy when there are no loops), or if there is none, the first
+ * turn of the shortest known way to an intersection that still has an
+ * unexplored exit.  Once the finish has been found, findRoute() finds the
+ * shortest known route from the start to the finish with Dijkstra's
+ * algorithm and stores it as a list of turns, two bits each.
+ *
+ * All of the storage is allocated inside the object, so the RAM it uses is
+ * fixed: about 17 bytes for each of the ZUMO_MAZE_MAX_NODES nodes, plus one
+ * byte for every four turns of ZUMO_MAZE_MAX_ROUTE, plus a few bytes of
+ * state.  With the defaults (24 nodes and 64 turns), that is about 430
+ * bytes.  Searching the map uses another 3 bytes of stack per node.  Define
+ * either macro before including this file (or with a compiler option) to
+ * change it.
+ */
+
+#ifndef ZumoMazeMap_h
+#define ZumoMazeMap_h
+
+#include <Arduino.h>
+
+#ifndef ZUMO_MAZE_MAX_NODES
+#define ZUMO_MAZE_MAX_NODES 24
+#endif
+
+#ifndef ZUMO_MAZE_MAX_ROUTE
+#define ZUMO_MAZE_MAX_ROUTE 64
+#endif
+
+// neighbor values that are not node numbers
+#define ZUMO_MAZE_UNEXPLORED 0xFF
+#define ZUMO_MAZE_DEAD_END   0xFE
+
+// directions; the Zumo starts out facing ZUMO_MAZE_NORTH
+#define ZUMO_MAZE_NORTH 0
+#define ZUMO_MAZE_EAST  1
+#define ZUMO_MAZE_SOUTH 2
+#define ZUMO_MAZE_WEST  3
+
+class ZumoMazeMap
+{
+  public:
+
+    // constructor
+    ZumoMazeMap();
+
+    // Sets how close (in length units, in both x and y) the estimated
+    // position has to be to a known intersection for it to be recognized as
+    // the same one (default 100).
+    void setMatchDistance(unsigned int distance);
+
+    // Forgets the maze.  The start is node 0, and the Zumo is on the segment
+    // leaving it, facing north.
+    void reset();
+
+    // Records arriving at the end of a segment of the given length and the
+    // exits found there.  With no exits, this is a dead end.  Returns false
+    // if there is no room left in the map for a new intersection; the map
+    // then stops recording, and selectTurn() falls back to the "left hand on
+    // the wall" strategy.
+    boolean arrive(unsigned int length, boolean left, boolean straight, boolean right);
+
+    // records arriving at the finish after a segment of the given length
+    boolean arriveAtFinish(unsigned int length);
+
+    // Picks the next turn to make while exploring: 'L', 'S', 'R', or 'B'.
+    // Returns 0 if every reachable exit has been explored.
+    char selectTurn();
+
+    // records a turn ('L', 'S', 'R', or 'B') at the current intersection
+    void turn(char dir);
+
+    // Finds the shortest known route from the start to the finish.  Returns
+    // false if the finish has not been found or the route is too long.
+    boolean findRoute();
+
+    // the number of turns in the route and each of them ('L', 'S', or 'R')
+    unsigned char getRouteLength() { return routeLength; }
+    char getRouteTurn(unsigned char i);
+
+    // The length of segment i of the route: segment 0 goes from the start to
+    // the first turn, and segment getRouteLength() ends at the finish.
+    unsigned int getRouteSegmentLength(unsigned char i);
+
+    boolean foundFinish() { return finish != ZUMO_MAZE_UNEXPLORED; }
+    boolean isFull() { return full; }
+    unsigned char getNodeCount() { return nodeCount; }
+    unsigned char getCurrentNode() { return current; }
+    unsigned char getHeading() { return heading; }
+
+    // The node at the other end of the given exit of a node (or
+    // ZUMO_MAZE_UNEXPLORED or ZUMO_MAZE_DEAD_END), and the length of the
+    // segment.
+    unsigned char getNeighbor(unsigned char node, unsigned char dir);
+    unsigned int getSegmentLength(unsigned char node, unsigned char dir);
+
+  private:
+
+    struct Node
+    {
+      int x, y;
+      unsigned char exits;  // bit n is set if there is an exit in direction n
+      unsigned char neighbor[4];
+      unsigned int length[4];
+    };
+
+    unsigned char routeCode(unsigned char i);
+    unsigned char findNode(unsigned char exits, unsigned char from);
+    unsigned char addNode(unsigned char exits);
+    void link(unsigned char node, unsigned int length);
+    void searchFrom(unsigned char start, unsigned int *distance, unsigned char *via);
+    boolean hasUnexplored(unsigned char node);
+    char leftHandTurn();
+
+    Node nodes[ZUMO_MAZE_MAX_NODES];
+    unsigned char route[(ZUMO_MAZE_MAX_ROUTE + 3) / 4];
+    unsigned char routeLength;
+    unsigned char nodeCount;
+    unsigned char current;     // the node the Zumo is at or last left
+    unsigned char heading;
+    unsigned char finish;
+    unsigned char lastExits;   // exits found at the last arrival, relative
+    boolean atDeadEnd;
+    boolean full;
+    int x, y;                  // estimated position
+    unsigned int matchDistance;
+};
+
+#endif
@@ -5,8 +5,62 @@
 #define DIR_L 8
 #define DIR_R 7
 
-#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined (__AVR_ATmega32U4__)
-  #define USE_20KHZ_PWM
+#if ZUMO_MOTORS_PWM_BACKEND != ZUMO_MOTORS_PWM_ANALOGWRITE
+  #if !defined(__AVR_ATmega168__) && !defined(__AVR_ATmega328P__) && !defined (__AVR_ATmega32U4__)
+    #error "The Timer1 PWM backends are only available on the ATmega168, ATmega328P, and ATmega32U4."
+  #endif
+
+  #if ZUMO_MOTORS_PWM_PRESCALER == 1
+    #define PWM_CS1 0b001
+  #elif ZUMO_MOTORS_PWM_PRESCALER == 8
+    #define PWM_CS1 0b010
+  #else
+    #error "ZUMO_MOTORS_PWM_PRESCALER must be 1 or 8."
+  #endif
+
+  // direction pins are written directly through their port registers;
+  // both PORTB and PORTD/PORTE are in the bit-addressable I/O space, so
+  // these compile to single sbi/cbi instructions
+  #if defined(__AVR_ATmega32U4__)
+    #define DIR_L_PORT  PORTB   // digital pin 8 = PB4
+    #define DIR_L_BIT   (1 << PORTB4)
+    #define DIR_R_PORT  PORTE   // digital pin 7 = PE6
+    #define DIR_R_BIT   (1 << PORTE6)
+  #else
+    #define DIR_L_PORT  PORTB   // digital pin 8 = PB0
+    #define DIR_L_BIT   (1 << PORTB0)
+    #define DIR_R_PORT  PORTD   // digital pin 7 = PD7
+    #define DIR_R_BIT   (1 << PORTD7)
+  #endif
+
+  #define SET_DIR_L(high) do { if (high) DIR_L_PORT |= DIR_L_BIT; else DIR_L_PORT &= ~DIR_L_BIT; } while (0)
+  #define SET_DIR_R(high) do { if (high) DIR_R_PORT |= DIR_R_BIT; else DIR_R_PORT &= ~DIR_R_BIT; } while (0)
+
+  // Maps a speed between 0 and 400 to a rounded compare value between 0 and
+  // TOP.  With the default TOP of 400 this is the identity; otherwise, it is
+  // a multiply by a constant 16.16 fixed-point scale factor and a shift (no
+  // division).  The scale factor is rounded up, so 400 * PWM_SCALE is at
+  // least TOP * 65536 but less than TOP * 65536 + 400: full speed gives
+  // exactly TOP (100% duty), even after rounding, and no speed goes past it.
+  #if ZUMO_MOTORS_PWM_TOP == 400
+    #define SPEED_TO_DUTY(speed) (speed)
+  #else
+    #define PWM_SCALE (((unsigned long)ZUMO_MOTORS_PWM_TOP * 65536 + 399) / 400)
+    #define SPEED_TO_DUTY(speed) ((unsigned int)(((unsigned long)(speed) * PWM_SCALE + 32768) >> 16))
+  #endif
+#else
+  #if defined(ARDUINO_ARCH_SAM) || defined(ARDUINO_ARCH_SAMD)
+    #define USE_ANALOGWRITE_RESOLUTION
+    #define ANALOGWRITE_MAX ((1UL << ZUMO_MOTORS_ANALOGWRITE_BITS) - 1)
+  #else
+    #define ANALOGWRITE_MAX 255UL
+  #endif
+
+  #define SET_DIR_L(high) digitalWrite(DIR_L, (high) ? HIGH : LOW)
+  #define SET_DIR_R(high) digitalWrite(DIR_R, (high) ? HIGH : LOW)
+
+  // maps a speed between 0 and 400 to a rounded analogWrite() value
+  #define SPEED_TO_DUTY(speed) ((int)(((unsigned long)(speed) * ANALOGWRITE_MAX + 200) / 400))
 #endif
 
 static boolean flipLeft = false;
@@ -17,7 +71,8 @@ ZumoMotors::ZumoMotors()
 {
 }
 
-// initialize timer1 to generate the proper PWM outputs to the motor drivers
+// initialize the PWM backend to generate the proper PWM outputs to the
+// motor drivers
 void ZumoMotors::init2()
 {
   pinMode(PWM_L,  OUTPUT);
@@ -25,18 +80,32 @@ void ZumoMotors::init2()
   pinMode(DIR_L, OUTPUT);
   pinMode(DIR_R, OUTPUT);
 
-#ifdef USE_20KHZ_PWM
+#if ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1
   // Timer 1 configuration
-  // prescaler: clockI/O / 1
+  // prescaler: clockI/O / ZUMO_MOTORS_PWM_PRESCALER
   // outputs enabled
   // phase-correct PWM
-  // top of 400
+  // top of ZUMO_MOTORS_PWM_TOP
   //
-  // PWM frequency calculation
+  // PWM frequency calculation (with the defaults)
   // 16MHz / 1 (prescaler) / 2 (phase-correct) / 400 (top) = 20kHz
   TCCR1A = 0b10100000;
-  TCCR1B = 0b00010001;
-  ICR1 = 400;
+  TCCR1B = 0b00010000 | PWM_CS1;
+  ICR1 = ZUMO_MOTORS_PWM_TOP;
+#elif ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1_FAST
+  // Timer 1 configuration
+  // prescaler: clockI/O / ZUMO_MOTORS_PWM_PRESCALER
+  // outputs enabled when the speed is nonzero (see setLeftSpeed())
+  // fast PWM, mode 14 (TOP = ICR1)
+  // top of ZUMO_MOTORS_PWM_TOP
+  //
+  // PWM frequency calculation (with the defaults)
+  // 16MHz / 1 (prescaler) / 800 (top + 1) = 20kHz
+  TCCR1A = 0b00000010;
+  TCCR1B = 0b00011000 | PWM_CS1;
+  ICR1 = ZUMO_MOTORS_PWM_TOP;
+#elif defined(USE_ANALOGWRITE_RESOLUTION)
+  analogWriteResolution(ZUMO_MOTORS_ANALOGWRITE_BITS);
 #endif
 }
 
@@ -67,16 +136,21 @@ void ZumoMotors::setLeftSpeed(int speed)
   if (speed > 400)  // Max 
     speed = 400;
     
-#ifdef USE_20KHZ_PWM
-  OCR1B = speed;
+#if ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1
+  OCR1B = SPEED_TO_DUTY(speed);
+#elif ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1_FAST
+  // fast PWM still produces a one-clock pulse with a compare value of 0, so
+  // disconnect the output (leaving the pin low) to fully stop the motor
+  if (speed == 0)
+    TCCR1A &= ~(1 << COM1B1);
+  else
+    TCCR1A |= (1 << COM1B1);
+  OCR1B = SPEED_TO_DUTY(speed);
 #else
-  analogWrite(PWM_L, speed * 51 / 80); // default to using analogWrite, mapping 400 to 255
+  analogWrite(PWM_L, SPEED_TO_DUTY(speed)); // map 400 to the maximum analogWrite() value
 #endif 
 
-  if (reverse ^ flipLeft) // flip if speed was negative or flipLeft setting is active, but not both
-    digitalWrite(DIR_L, HIGH);
-  else
-    digitalWrite(DIR_L, LOW);
+  SET_DIR_L(reverse ^ flipLeft); // flip if speed was negative or flipLeft setting is active, but not both
 }
 
 // set speed for right motor; speed is a number between -400 and 400
@@ -94,16 +168,21 @@ void ZumoMotors::setRightSpeed(int speed)
   if (speed > 400)  // Max PWM dutycycle
     speed = 400;
     
-#ifdef USE_20KHZ_PWM
-  OCR1A = speed;
+#if ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1
+  OCR1A = SPEED_TO_DUTY(speed);
+#elif ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1_FAST
+  // fast PWM still produces a one-clock pulse with a compare value of 0, so
+  // disconnect the output (leaving the pin low) to fully stop the motor
+  if (speed == 0)
+    TCCR1A &= ~(1 << COM1A1);
+  else
+    TCCR1A |= (1 << COM1A1);
+  OCR1A = SPEED_TO_DUTY(speed);
 #else
-  analogWrite(PWM_R, speed * 51 / 80); // default to using analogWrite, mapping 400 to 255
+  analogWrite(PWM_R, SPEED_TO_DUTY(speed)); // map 400 to the maximum analogWrite() value
 #endif
 
-  if (reverse ^ flipRight) // flip if speed was negative or flipRight setting is active, but not both
-    digitalWrite(DIR_R, HIGH);
-  else
-    digitalWrite(DIR_R, LOW);
+  SET_DIR_R(reverse ^ flipRight); // flip if speed was negative or flipRight setting is active, but not both
 }
 
 // set speed for both motors
@@ -111,4 +190,35 @@ void ZumoMotors::setSpeeds(int leftSpeed, int rightSpeed)
 {
   setLeftSpeed(leftSpeed);
   setRightSpeed(rightSpeed);
-}
\ No newline at end of file
+}
+
+// Set forward speed and turn rate for both motors.  speed is the average of
+// the two motor speeds and turnRate is half of their difference (right minus
+// left), both in the same units as setSpeeds(), so a positive turnRate turns
+// the Zumo to the left (counterclockwise):
+//
+//   left = speed - turnRate,  right = speed + turnRate
+//
+// If the result would exceed 400 on either side, the forward speed is reduced
+// until both motors are within range, so the requested turn rate is preserved
+// at the expense of forward speed (the turn rate itself is limited to +/-400,
+// which spins the Zumo in place at full speed).  This makes it suitable for
+// controllers that regulate heading or line position, which would otherwise
+// lose turning authority when one motor saturates.
+void ZumoMotors::setVelocity(int speed, int turnRate)
+{
+  if (turnRate > 400)
+    turnRate = 400;
+  else if (turnRate < -400)
+    turnRate = -400;
+
+  // largest forward speed that leaves room for the turn on both sides
+  int speedLimit = 400 - (turnRate < 0 ? -turnRate : turnRate);
+
+  if (speed > speedLimit)
+    speed = speedLimit;
+  else if (speed < -speedLimit)
+    speed = -speedLimit;
+
+  setSpeeds(speed - turnRate, speed + turnRate);
+}
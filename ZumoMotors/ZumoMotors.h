@@ -5,6 +5,49 @@
  * \class ZumoMotors ZumoMotors.h
  * \brief Control motor speed and direction
  * 
+ * The PWM signals for the motors are generated by one of several backends,
+ * selected at compile time with `ZUMO_MOTORS_PWM_BACKEND`. All backends
+ * present the same -400 to 400 speed range through `setSpeeds()`,
+ * `setLeftSpeed()`, and `setRightSpeed()`; they differ only in how that range
+ * is mapped onto the hardware. To select a backend or change its settings,
+ * define the macros below before this header is compiled (for example, by
+ * editing the defaults here or by passing `-D` options to the compiler).
+ *
+ * <table>
+ * <tr><th>Backend</th><th>Boards</th><th>PWM frequency (16 MHz)</th>
+ *     <th>Effective resolution</th><th>ISR cost</th></tr>
+ * <tr><td>`ZUMO_MOTORS_PWM_TIMER1` (default)</td>
+ *     <td>ATmega168/328P/32U4</td>
+ *     <td>F_CPU / PRESCALER / 2 / TOP (20 kHz with the default TOP of 400)</td>
+ *     <td>TOP + 1 steps (~8.6 bits with TOP = 400)</td>
+ *     <td>none</td></tr>
+ * <tr><td>`ZUMO_MOTORS_PWM_TIMER1_FAST`</td>
+ *     <td>ATmega168/328P/32U4</td>
+ *     <td>F_CPU / PRESCALER / (TOP + 1) (20 kHz with TOP = 799)</td>
+ *     <td>TOP + 1 steps (~9.6 bits with TOP = 799)</td>
+ *     <td>none</td></tr>
+ * <tr><td>`ZUMO_MOTORS_PWM_ANALOGWRITE`</td>
+ *     <td>any</td>
+ *     <td>core dependent (~490 Hz on AVR)</td>
+ *     <td>2^`ZUMO_MOTORS_ANALOGWRITE_BITS` steps, capped at 401</td>
+ *     <td>none</td></tr>
+ * </table>
+ *
+ * The Timer1 backends use phase-correct PWM (symmetric, so the motor current
+ * ripple is centered in each period) or fast PWM (twice the resolution at the
+ * same frequency) with `ICR1` as TOP. Lowering the PWM frequency with a larger
+ * TOP or a prescaler of 8 reduces switching losses in the DRV8835, at the cost
+ * of audible motor whine below about 20 kHz. Timer1 drives the same PWM pins
+ * (9 and 10) on the ATmega32U4 as on the ATmega328P/168, so both Timer1
+ * backends work unchanged on it; the only 32U4-specific code is the mapping
+ * of the direction pins to port bits. On these boards, the direction pins
+ * are written directly through their port registers instead of with
+ * `digitalWrite()`.
+ *
+ * The analogWrite backend is the fallback for all other boards. If the core
+ * provides `analogWriteResolution()` (for example, the Arduino Due and Zero),
+ * it is used to get `ZUMO_MOTORS_ANALOGWRITE_BITS` of resolution (12 by
+ * default); otherwise the standard 8-bit `analogWrite()` is used.
  */
 
 #ifndef ZumoMotors_h
@@ -12,6 +55,38 @@
 
 #include <Arduino.h>
 
+#define ZUMO_MOTORS_PWM_ANALOGWRITE  0
+#define ZUMO_MOTORS_PWM_TIMER1       1
+#define ZUMO_MOTORS_PWM_TIMER1_FAST  2
+
+#ifndef ZUMO_MOTORS_PWM_BACKEND
+  #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined (__AVR_ATmega32U4__)
+    #define ZUMO_MOTORS_PWM_BACKEND ZUMO_MOTORS_PWM_TIMER1
+  #else
+    #define ZUMO_MOTORS_PWM_BACKEND ZUMO_MOTORS_PWM_ANALOGWRITE
+  #endif
+#endif
+
+// Timer1 clock prescaler (1 or 8)
+#ifndef ZUMO_MOTORS_PWM_PRESCALER
+  #define ZUMO_MOTORS_PWM_PRESCALER 1
+#endif
+
+// Timer1 TOP value (ICR1); the full speed of 400 is mapped to this value
+#ifndef ZUMO_MOTORS_PWM_TOP
+  #if ZUMO_MOTORS_PWM_BACKEND == ZUMO_MOTORS_PWM_TIMER1_FAST
+    #define ZUMO_MOTORS_PWM_TOP 799
+  #else
+    #define ZUMO_MOTORS_PWM_TOP 400
+  #endif
+#endif
+
+// analogWrite() resolution to request on cores that support
+// analogWriteResolution()
+#ifndef ZUMO_MOTORS_ANALOGWRITE_BITS
+  #define ZUMO_MOTORS_ANALOGWRITE_BITS 12
+#endif
+
 class ZumoMotors
 {
   public:  
@@ -28,6 +103,9 @@ class ZumoMotors
     static void setRightSpeed(int speed);
     static void setSpeeds(int leftSpeed, int rightSpeed);
     
+    // set forward speed and turn rate for both motors; see ZumoMotors.cpp
+    static void setVelocity(int speed, int turnRate);
+
   private:
 
     static inline void init()
@@ -41,7 +119,7 @@ class ZumoMotors
       }
     }
     
-    // initializes timer1 for proper PWM generation
+    // initializes the PWM backend for proper PWM generation
     static void init2();
 };
 